@@ -0,0 +1,415 @@
+#include "VoCommon/Public/AllocationTracker.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Utilities/Interfaces/ILog.h"
+#include "Utilities/Interfaces/IThread.h"
+
+#include "Utilities/Interfaces/IMemory.h" // Must be the last include in a cpp file
+
+// Both tables are allocated once in initAllocationTracker, nothing here allocates per call.
+static const uint32_t gLiveTableSize = 1u << 16; // power of two
+static const uint32_t gSiteTableSize = 256;      // power of two
+static const uint32_t gSummarySiteCount = 4;
+
+static void* const gTombstone = (void*)(uintptr_t)1;
+
+struct LiveAllocation
+{
+	void*    ptr;
+	uint64_t mSize;
+};
+
+struct AllocationTracker
+{
+	Mutex                     mMutex;
+	AllocationTrackerSettings mSettings;
+	LiveAllocation*           pLive;
+	uint32_t                  mLiveCount;
+	uint32_t                  mTombstoneCount;
+	uint32_t                  mSkippedInserts; // blocks left untracked because the live table was full
+	AllocationSiteStats*      pSites;
+	AllocationSiteStats       mOtherSite; // table full
+
+	AllocationFrameStats mCurrent;
+	AllocationFrameStats mLastFrame;
+	uint32_t             mFramesSinceWarmupStart;
+	bool                 mInitialized;
+	bool                 mInFrame;
+	bool                 mFailed;
+
+	char mSummary[1024];
+};
+
+static AllocationTracker gTracker = {};
+
+static uint32_t hashPointer(const void* ptr) { return (uint32_t)(((uintptr_t)ptr >> 4) * 2654435761u); }
+
+static uint32_t hashSite(const char* pFile, uint32_t line) { return (uint32_t)(((uintptr_t)pFile >> 3) * 2654435761u) ^ (line * 40503u); }
+
+// Mutex held for all helpers below
+
+// Drops the tombstones without allocating: they become empty slots, then every live entry is placed again from its
+// home slot. The pass starts right after an empty slot, so no probe sequence wraps past its start and every entry is
+// placed after all the slots it may move into, which never move again.
+static void rebuildLive()
+{
+	uint32_t start = 0;
+	for (uint32_t slot = 0; slot < gLiveTableSize; ++slot)
+	{
+		if (gTracker.pLive[slot].ptr == gTombstone)
+			gTracker.pLive[slot].ptr = NULL;
+		if (!gTracker.pLive[slot].ptr)
+			start = slot;
+	}
+
+	for (uint32_t i = 1; i <= gLiveTableSize; ++i)
+	{
+		const uint32_t slot = (start + i) & (gLiveTableSize - 1);
+		if (!gTracker.pLive[slot].ptr)
+			continue;
+
+		const LiveAllocation live = gTracker.pLive[slot];
+		gTracker.pLive[slot].ptr = NULL;
+		uint32_t target = hashPointer(live.ptr) & (gLiveTableSize - 1);
+		while (gTracker.pLive[target].ptr)
+			target = (target + 1) & (gLiveTableSize - 1);
+		gTracker.pLive[target] = live;
+	}
+	gTracker.mTombstoneCount = 0;
+}
+
+static void insertLive(void* ptr, uint64_t size)
+{
+	// Keep the probe sequences short: tombstones are dropped once they push the table past the load limit, blocks past
+	// the limit are simply untracked
+	const uint32_t maxLoad = gLiveTableSize / 4 * 3;
+	if (gTracker.mLiveCount + gTracker.mTombstoneCount >= maxLoad)
+	{
+		if (gTracker.mTombstoneCount)
+			rebuildLive();
+		if (gTracker.mLiveCount >= maxLoad)
+		{
+			++gTracker.mSkippedInserts;
+			return;
+		}
+	}
+
+	uint32_t slot = hashPointer(ptr) & (gLiveTableSize - 1);
+	uint32_t tombstone = UINT32_MAX;
+	for (uint32_t probe = 0; probe < gLiveTableSize && gTracker.pLive[slot].ptr; ++probe)
+	{
+		if (gTracker.pLive[slot].ptr == ptr)
+		{
+			gTracker.pLive[slot].mSize = size;
+			return;
+		}
+		if (gTracker.pLive[slot].ptr == gTombstone && tombstone == UINT32_MAX)
+			tombstone = slot;
+		slot = (slot + 1) & (gLiveTableSize - 1);
+	}
+
+	// Reuse the first tombstone of the sequence, otherwise slot is the empty one that ended it
+	if (tombstone != UINT32_MAX)
+	{
+		slot = tombstone;
+		--gTracker.mTombstoneCount;
+	}
+	++gTracker.mLiveCount;
+	gTracker.pLive[slot].ptr = ptr;
+	gTracker.pLive[slot].mSize = size;
+}
+
+// Returns the size recorded for ptr and forgets it, 0 if unknown
+static uint64_t removeLive(void* ptr)
+{
+	uint32_t slot = hashPointer(ptr) & (gLiveTableSize - 1);
+	for (uint32_t probe = 0; probe < gLiveTableSize && gTracker.pLive[slot].ptr; ++probe)
+	{
+		if (gTracker.pLive[slot].ptr == ptr)
+		{
+			const uint64_t size = gTracker.pLive[slot].mSize;
+			gTracker.pLive[slot].ptr = gTombstone;
+			--gTracker.mLiveCount;
+			++gTracker.mTombstoneCount;
+			return size;
+		}
+		slot = (slot + 1) & (gLiveTableSize - 1);
+	}
+	return 0;
+}
+
+static AllocationSiteStats* findSite(const char* pFile, int line, const char* pFunction)
+{
+	uint32_t slot = hashSite(pFile, (uint32_t)line) & (gSiteTableSize - 1);
+	for (uint32_t probe = 0; probe < gSiteTableSize; ++probe)
+	{
+		AllocationSiteStats* pSite = &gTracker.pSites[slot];
+		if (!pSite->pFile)
+		{
+			pSite->pFile = pFile;
+			pSite->pFunction = pFunction;
+			pSite->mLine = (uint32_t)line;
+			return pSite;
+		}
+		if (pSite->pFile == pFile && pSite->mLine == (uint32_t)line)
+			return pSite;
+		slot = (slot + 1) & (gSiteTableSize - 1);
+	}
+	return &gTracker.mOtherSite;
+}
+
+static bool isCounting() { return gTracker.mInFrame && gTracker.mSettings.mEnabled; }
+
+static void recordAllocLocked(void* ptr, uint64_t size, const char* pFile, int line, const char* pFunction)
+{
+	insertLive(ptr, size);
+	if (isCounting())
+	{
+		AllocationSiteStats* pSite = findSite(pFile, line, pFunction);
+		++pSite->mAllocCount;
+		pSite->mAllocBytes += size;
+		++gTracker.mCurrent.mAllocCount;
+		gTracker.mCurrent.mAllocBytes += size;
+	}
+}
+
+static void recordFreeLocked(void* ptr, const char* pFile, int line, const char* pFunction)
+{
+	const uint64_t size = removeLive(ptr);
+	if (isCounting())
+	{
+		++findSite(pFile, line, pFunction)->mFreeCount;
+		++gTracker.mCurrent.mFreeCount;
+		gTracker.mCurrent.mFreeBytes += size;
+	}
+}
+
+static void recordAlloc(void* ptr, uint64_t size, const char* pFile, int line, const char* pFunction)
+{
+	if (!gTracker.mInitialized || !ptr)
+		return;
+
+	acquireMutex(&gTracker.mMutex);
+	recordAllocLocked(ptr, size, pFile, line, pFunction);
+	releaseMutex(&gTracker.mMutex);
+}
+
+static void recordFree(void* ptr, const char* pFile, int line, const char* pFunction)
+{
+	if (!gTracker.mInitialized || !ptr)
+		return;
+
+	acquireMutex(&gTracker.mMutex);
+	recordFreeLocked(ptr, pFile, line, pFunction);
+	releaseMutex(&gTracker.mMutex);
+}
+
+void* voTrackedMalloc(size_t size, const char* pFile, int line, const char* pFunction)
+{
+	void* ptr = tf_malloc_internal(size, pFile, line, pFunction);
+	recordAlloc(ptr, size, pFile, line, pFunction);
+	return ptr;
+}
+
+void* voTrackedMemalign(size_t align, size_t size, const char* pFile, int line, const char* pFunction)
+{
+	void* ptr = tf_memalign_internal(align, size, pFile, line, pFunction);
+	recordAlloc(ptr, size, pFile, line, pFunction);
+	return ptr;
+}
+
+void* voTrackedCalloc(size_t count, size_t size, const char* pFile, int line, const char* pFunction)
+{
+	void* ptr = tf_calloc_internal(count, size, pFile, line, pFunction);
+	recordAlloc(ptr, count * size, pFile, line, pFunction);
+	return ptr;
+}
+
+void* voTrackedCallocMemalign(size_t count, size_t align, size_t size, const char* pFile, int line, const char* pFunction)
+{
+	void* ptr = tf_calloc_memalign_internal(count, align, size, pFile, line, pFunction);
+	recordAlloc(ptr, count * size, pFile, line, pFunction);
+	return ptr;
+}
+
+void* voTrackedRealloc(void* ptr, size_t size, const char* pFile, int line, const char* pFunction)
+{
+	if (!gTracker.mInitialized)
+		return tf_realloc_internal(ptr, size, pFile, line, pFunction);
+
+	// The mutex is held across the call: once the old block is released another thread may get its address, and
+	// that thread's record has to come after ours.
+	acquireMutex(&gTracker.mMutex);
+	void* pNew = tf_realloc_internal(ptr, size, pFile, line, pFunction);
+	// On failure the old block is still allocated and stays recorded. Otherwise it counts as a free of the old block
+	// plus an allocation, even when the allocator grows in place.
+	if (pNew)
+	{
+		if (ptr)
+			recordFreeLocked(ptr, pFile, line, pFunction);
+		recordAllocLocked(pNew, size, pFile, line, pFunction);
+	}
+	releaseMutex(&gTracker.mMutex);
+	return pNew;
+}
+
+void voTrackedFree(void* ptr, const char* pFile, int line, const char* pFunction)
+{
+	recordFree(ptr, pFile, line, pFunction);
+	tf_free_internal(ptr, pFile, line, pFunction);
+}
+
+static const char* fileName(const char* pPath)
+{
+	const char* pName = pPath;
+	for (const char* c = pPath; *c; ++c)
+	{
+		if (*c == '/' || *c == '\\')
+			pName = c + 1;
+	}
+	return pName;
+}
+
+// Mutex held
+static void updateSummary()
+{
+	const AllocationFrameStats& stats = gTracker.mLastFrame;
+	int                         length = snprintf(gTracker.mSummary, sizeof(gTracker.mSummary),
+												  "%s%u allocs (%llu B), %u frees, %u frames over budget, %u untracked blocks%s",
+												  stats.mWarm ? "" : "[warm-up] ", stats.mAllocCount, (unsigned long long)stats.mAllocBytes,
+												  stats.mFreeCount, stats.mOverBudgetFrames, gTracker.mSkippedInserts,
+												  stats.mOverBudget ? "  OVER BUDGET" : "");
+
+	// Busiest sites by allocation count, selection over the small site table
+	const AllocationSiteStats* pTop[gSummarySiteCount] = {};
+	for (uint32_t i = 0; i <= gSiteTableSize; ++i)
+	{
+		const AllocationSiteStats* pSite = i < gSiteTableSize ? &gTracker.pSites[i] : &gTracker.mOtherSite;
+		if (!pSite->mAllocCount)
+			continue;
+		for (uint32_t t = 0; t < gSummarySiteCount; ++t)
+		{
+			if (!pTop[t] || pSite->mAllocCount > pTop[t]->mAllocCount)
+			{
+				memmove(&pTop[t + 1], &pTop[t], (gSummarySiteCount - t - 1) * sizeof(pTop[0]));
+				pTop[t] = pSite;
+				break;
+			}
+		}
+	}
+
+	for (uint32_t t = 0; t < gSummarySiteCount && pTop[t] && length > 0 && length < (int)sizeof(gTracker.mSummary); ++t)
+	{
+		length += snprintf(gTracker.mSummary + length, sizeof(gTracker.mSummary) - length, "\n    %s:%u %s: %u allocs, %llu B",
+						   pTop[t]->pFile ? fileName(pTop[t]->pFile) : "other", pTop[t]->mLine,
+						   pTop[t]->pFunction ? pTop[t]->pFunction : "", pTop[t]->mAllocCount, (unsigned long long)pTop[t]->mAllocBytes);
+	}
+}
+
+void initAllocationTracker(const AllocationTrackerSettings* pSettings)
+{
+	ASSERT(pSettings);
+	ASSERT(!gTracker.mInitialized);
+
+	initMutex(&gTracker.mMutex);
+	gTracker.mSettings = *pSettings;
+	gTracker.pLive = (LiveAllocation*)tf_calloc(gLiveTableSize, sizeof(LiveAllocation));
+	gTracker.pSites = (AllocationSiteStats*)tf_calloc(gSiteTableSize, sizeof(AllocationSiteStats));
+	gTracker.mInitialized = true;
+}
+
+bool exitAllocationTracker()
+{
+	if (!gTracker.mInitialized)
+		return true;
+
+	const bool passed = !gTracker.mFailed;
+	if (gTracker.mSettings.mFailOnAllocation)
+		LOGF(passed ? LogLevel::eINFO : LogLevel::eERROR, "Allocation guard %s", passed ? "passed" : "FAILED");
+
+	gTracker.mInitialized = false;
+	tf_free(gTracker.pLive);
+	tf_free(gTracker.pSites);
+	exitMutex(&gTracker.mMutex);
+	gTracker = {};
+	return passed;
+}
+
+AllocationTrackerSettings* getAllocationTrackerSettings() { return &gTracker.mSettings; }
+
+void allocationTrackerBeginFrame()
+{
+	if (!gTracker.mInitialized)
+		return;
+
+	acquireMutex(&gTracker.mMutex);
+	const uint32_t overBudgetFrames = gTracker.mCurrent.mOverBudgetFrames;
+	gTracker.mCurrent = {};
+	gTracker.mCurrent.mOverBudgetFrames = overBudgetFrames;
+	for (uint32_t i = 0; i < gSiteTableSize; ++i)
+	{
+		gTracker.pSites[i].mAllocCount = 0;
+		gTracker.pSites[i].mFreeCount = 0;
+		gTracker.pSites[i].mAllocBytes = 0;
+	}
+	gTracker.mOtherSite = {};
+	gTracker.mInFrame = true;
+	releaseMutex(&gTracker.mMutex);
+}
+
+void allocationTrackerEndFrame()
+{
+	if (!gTracker.mInitialized)
+		return;
+
+	acquireMutex(&gTracker.mMutex);
+	gTracker.mInFrame = false;
+
+	const AllocationTrackerSettings& settings = gTracker.mSettings;
+	AllocationFrameStats&            stats = gTracker.mCurrent;
+	stats.mWarm = gTracker.mFramesSinceWarmupStart >= settings.mWarmupFrames;
+	if (!stats.mWarm)
+		++gTracker.mFramesSinceWarmupStart;
+
+	if (settings.mEnabled && stats.mWarm)
+	{
+		stats.mOverBudget = stats.mAllocCount > settings.mBudgetAllocCount || stats.mAllocBytes > settings.mBudgetBytes;
+		if (stats.mOverBudget)
+			++stats.mOverBudgetFrames;
+
+		if (settings.mFailOnAllocation && stats.mAllocCount && !gTracker.mFailed)
+		{
+			gTracker.mFailed = true;
+			LOGF(LogLevel::eERROR, "Allocation guard: %u allocations (%llu bytes) after warm-up", stats.mAllocCount,
+				 (unsigned long long)stats.mAllocBytes);
+			for (uint32_t i = 0; i <= gSiteTableSize; ++i)
+			{
+				const AllocationSiteStats* pSite = i < gSiteTableSize ? &gTracker.pSites[i] : &gTracker.mOtherSite;
+				if (pSite->mAllocCount)
+					LOGF(LogLevel::eERROR, "    %s(%u) %s: %u allocations, %llu bytes", pSite->pFile ? pSite->pFile : "other",
+						 pSite->mLine, pSite->pFunction ? pSite->pFunction : "", pSite->mAllocCount,
+						 (unsigned long long)pSite->mAllocBytes);
+			}
+		}
+	}
+
+	gTracker.mLastFrame = stats;
+	if (settings.mEnabled)
+		updateSummary();
+	releaseMutex(&gTracker.mMutex);
+}
+
+void allocationTrackerRestartWarmup()
+{
+	acquireMutex(&gTracker.mMutex);
+	gTracker.mFramesSinceWarmupStart = 0;
+	releaseMutex(&gTracker.mMutex);
+}
+
+const AllocationFrameStats* getAllocationFrameStats() { return &gTracker.mLastFrame; }
+
+const char* getAllocationTrackerSummary() { return gTracker.mSummary; }
+
+bool allocationTrackerFailed() { return gTracker.mFailed; }
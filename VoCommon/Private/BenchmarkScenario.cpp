@@ -0,0 +1,188 @@
+#include "VoCommon/Public/BenchmarkScenario.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Utilities/Interfaces/IFileSystem.h"
+#include "Utilities/Interfaces/ILog.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+static const size_t gMaxScenarioFileSize = 8 * 1024;
+
+static char* trimScenarioText(char* pText)
+{
+	while (*pText == ' ' || *pText == '\t')
+		++pText;
+	char* pEnd = pText + strlen(pText);
+	while (pEnd > pText && (pEnd[-1] == ' ' || pEnd[-1] == '\t' || pEnd[-1] == '\r'))
+		*--pEnd = '\0';
+	return pText;
+}
+
+// Reads a whole text file into pBuffer (NUL terminated), false if missing or too large.
+static bool readScenarioFile(ResourceDirectory directory, const char* pFileName, char* pBuffer, size_t bufferSize)
+{
+	FileStream stream = {};
+	if (!fsOpenStreamFromPath(directory, pFileName, FM_READ, &stream))
+		return false;
+	const ssize_t size = fsGetStreamFileSize(&stream);
+	const bool    fits = size >= 0 && (size_t)size < bufferSize;
+	if (fits)
+		pBuffer[fsReadFromStream(&stream, pBuffer, (size_t)size)] = '\0';
+	fsCloseStream(&stream);
+	return fits;
+}
+
+bool loadBenchmarkScenario(const char* pFileName, BenchmarkScenario* pScenario)
+{
+	*pScenario = {};
+	snprintf(pScenario->mName, sizeof(pScenario->mName), "%s", pFileName);
+	char* pExtension = strrchr(pScenario->mName, '.');
+	if (pExtension)
+		*pExtension = '\0';
+
+	char text[gMaxScenarioFileSize];
+	if (!readScenarioFile(RD_SCRIPTS, pFileName, text, sizeof(text)))
+	{
+		LOGF(LogLevel::eERROR, "Could not read benchmark scenario '%s'", pFileName);
+		return false;
+	}
+
+	for (char* pLine = strtok(text, "\n"); pLine; pLine = strtok(NULL, "\n"))
+	{
+		char* pComment = strchr(pLine, '#');
+		if (pComment)
+			*pComment = '\0';
+		char* pEquals = strchr(pLine, '=');
+		if (!pEquals)
+			continue;
+		*pEquals = '\0';
+		if (pScenario->mKeyCount == BENCHMARK_MAX_SCENARIO_KEYS)
+		{
+			LOGF(LogLevel::eWARNING, "Benchmark scenario '%s' has more than %u keys, ignoring the rest", pFileName,
+				 BENCHMARK_MAX_SCENARIO_KEYS);
+			break;
+		}
+		const uint32_t key = pScenario->mKeyCount++;
+		snprintf(pScenario->mKeys[key], sizeof(pScenario->mKeys[key]), "%s", trimScenarioText(pLine));
+		snprintf(pScenario->mValues[key], sizeof(pScenario->mValues[key]), "%s", trimScenarioText(pEquals + 1));
+	}
+
+	pScenario->mWarmupFrames = getScenarioUint(pScenario, "warmup", 120);
+	pScenario->mFrames = getScenarioUint(pScenario, "frames", 600);
+	pScenario->mTolerance = 0.1;
+	for (uint32_t i = 0; i < pScenario->mKeyCount; ++i)
+	{
+		if (strcmp(pScenario->mKeys[i], "tolerance") == 0)
+			pScenario->mTolerance = atof(pScenario->mValues[i]);
+	}
+	pScenario->mActive = pScenario->mFrames > 0;
+
+	LOGF(LogLevel::eINFO, "Benchmark scenario '%s': %u warm-up frames, %u measured, %.1f%% tolerance", pScenario->mName,
+		 pScenario->mWarmupFrames, pScenario->mFrames, pScenario->mTolerance * 100.0);
+	return true;
+}
+
+uint32_t getScenarioUint(const BenchmarkScenario* pScenario, const char* pKey, uint32_t defaultValue)
+{
+	for (uint32_t i = 0; i < pScenario->mKeyCount; ++i)
+	{
+		if (strcmp(pScenario->mKeys[i], pKey) != 0)
+			continue;
+		char*               pEnd = NULL;
+		const unsigned long value = strtoul(pScenario->mValues[i], &pEnd, 10);
+		if (pEnd != pScenario->mValues[i] && *pEnd == '\0')
+			return (uint32_t)value;
+		LOGF(LogLevel::eWARNING, "Benchmark scenario '%s': '%s' is not a number, using %u", pScenario->mName, pKey, defaultValue);
+	}
+	return defaultValue;
+}
+
+uint32_t addBenchmarkMetric(BenchmarkScenario* pScenario, const char* pName)
+{
+	ASSERT(pScenario->mMetricCount < BENCHMARK_MAX_METRICS);
+	const uint32_t metric = pScenario->mMetricCount++;
+	snprintf(pScenario->mMetrics[metric].mName, sizeof(pScenario->mMetrics[metric].mName), "%s", pName);
+	return metric;
+}
+
+bool advanceBenchmarkScenario(BenchmarkScenario* pScenario)
+{
+	if (!pScenario->mActive)
+		return false;
+	return ++pScenario->mFrame >= pScenario->mWarmupFrames + pScenario->mFrames;
+}
+
+// Baseline average of pName, negative if the baseline has no such metric.
+static double findBaselineValue(const char* pBaseline, const char* pName)
+{
+	const size_t nameLength = strlen(pName);
+	for (const char* pLine = pBaseline; pLine && *pLine; pLine = strchr(pLine, '\n'), pLine = pLine ? pLine + 1 : NULL)
+	{
+		if (strncmp(pLine, pName, nameLength) == 0 && pLine[nameLength] == ',')
+			return atof(pLine + nameLength + 1);
+	}
+	return -1.0;
+}
+
+bool finishBenchmarkScenario(BenchmarkScenario* pScenario)
+{
+	pScenario->mActive = false;
+
+	char fileName[96];
+	snprintf(fileName, sizeof(fileName), "%s.results.csv", pScenario->mName);
+	FileStream stream = {};
+	const bool writeResults = fsOpenStreamFromPath(RD_DEBUG, fileName, FM_WRITE, &stream);
+	if (!writeResults)
+		LOGF(LogLevel::eWARNING, "Could not write benchmark results '%s'", fileName);
+	else
+		fsWriteToStream(&stream, "metric,value\n", 13);
+
+	char       baseline[gMaxScenarioFileSize];
+	char       baselineName[96];
+	snprintf(baselineName, sizeof(baselineName), "%s.baseline.csv", pScenario->mName);
+	const bool hasBaseline = readScenarioFile(RD_SCRIPTS, baselineName, baseline, sizeof(baseline));
+
+	LOGF(LogLevel::eINFO, "Benchmark scenario '%s' over %u frames:", pScenario->mName, pScenario->mFrames);
+	uint32_t regressionCount = 0;
+	for (uint32_t i = 0; i < pScenario->mMetricCount; ++i)
+	{
+		const BenchmarkMetric* pMetric = &pScenario->mMetrics[i];
+		if (!pMetric->mSampleCount)
+			continue;
+		const double average = pMetric->mSum / pMetric->mSampleCount;
+		if (writeResults)
+		{
+			char      line[96];
+			const int length = snprintf(line, sizeof(line), "%s,%.6f\n", pMetric->mName, average);
+			fsWriteToStream(&stream, line, (size_t)length);
+		}
+
+		const double baselineValue = hasBaseline ? findBaselineValue(baseline, pMetric->mName) : -1.0;
+		if (baselineValue <= 0.0)
+		{
+			LOGF(LogLevel::eINFO, "  %-24s %14.4f", pMetric->mName, average);
+			continue;
+		}
+		const double change = average / baselineValue - 1.0;
+		const bool   regressed = change > pScenario->mTolerance;
+		regressionCount += regressed ? 1 : 0;
+		LOGF(regressed ? LogLevel::eERROR : LogLevel::eINFO, "  %-24s %14.4f  baseline %14.4f  %+7.2f%%%s", pMetric->mName, average,
+			 baselineValue, change * 100.0, regressed ? "  REGRESSION" : "");
+	}
+	if (writeResults)
+		fsCloseStream(&stream);
+
+	if (!hasBaseline)
+	{
+		LOGF(LogLevel::eERROR, "Benchmark scenario '%s': no baseline '%s' in Scripts, nothing was checked. Copy Debug/%s there to make "
+			 "these results the baseline.", pScenario->mName, baselineName, fileName);
+		return false;
+	}
+	if (regressionCount)
+		LOGF(LogLevel::eERROR, "Benchmark scenario '%s': %u metrics regressed by more than %.1f%%", pScenario->mName, regressionCount,
+			 pScenario->mTolerance * 100.0);
+	return regressionCount == 0;
+}
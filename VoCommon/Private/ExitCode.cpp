@@ -0,0 +1,15 @@
+#include "VoCommon/Public/ExitCode.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+static int gShutdownExitCode = 0;
+
+void setShutdownExitCode(int exitCode)
+{
+	if (!gShutdownExitCode)
+		gShutdownExitCode = exitCode;
+}
+
+int getShutdownExitCode() { return gShutdownExitCode; }
+
+int applyShutdownExitCode(int platformExitCode) { return platformExitCode ? platformExitCode : gShutdownExitCode; }
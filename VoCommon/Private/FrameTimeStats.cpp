@@ -0,0 +1,307 @@
+#include "VoCommon/Public/FrameTimeStats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Utilities/Interfaces/IFileSystem.h"
+#include "Utilities/Interfaces/ILog.h"
+#include "Utilities/Interfaces/ITime.h"
+
+#include "VoCommon/Public/FrameTrace.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+// Bin b covers [gMinMs * gBinGrowth^b, gMinMs * gBinGrowth^(b + 1)); the first bin also takes everything below that, the
+// last everything above 1 s.
+static const double   gMinMs = 0.01;
+static const double   gBinGrowth = 1.01;
+static const uint32_t gBinCount = 1158;
+static const uint32_t gMaxLoggedHitches = 64;
+
+static const char* gFrameTimeMetricNames[FRAME_TIME_METRIC_COUNT] = { "cpu_frame", "gpu_frame", "fence_wait", "present" };
+static const char* gFrameTimeMetricLabels[FRAME_TIME_METRIC_COUNT] = { "CPU frame", "GPU frame", "Fence wait", "Present" };
+
+// Readouts in the UI and the CSV
+static const uint32_t gPercentileCount = 3;
+static const double   gPercentiles[gPercentileCount] = { 0.5, 0.99, 0.999 };
+
+struct FrameTimeHistogram
+{
+	uint32_t mBins[gBinCount];
+	uint32_t mCount;
+	double   mSumMs;
+};
+
+struct FrameTimeMetricStats
+{
+	FrameTimeHistogram mWindow;
+	FrameTimeHistogram mRun;
+	double             mRunMaxMs;
+	uint32_t           mRunOverThreshold;
+
+	float    mWindowMs[FRAME_TIME_MAX_WINDOW_FRAMES]; // ring, the oldest sample is at mWindowNext once full
+	uint32_t mWindowNext;
+
+	double mFrameMs;
+	double mLastFrameMs; // of the last completed frame, 0 if it had no sample
+	bool   mHasSample;
+};
+
+struct FrameTimeStats
+{
+	FrameTimeStatsSettings mSettings;
+	FrameTimeMetricStats   mMetrics[FRAME_TIME_METRIC_COUNT];
+	uint32_t               mWindowFrames; // fixed at init
+	HiresTimer             mCpuFrameTimer;
+	uint32_t               mFramesSinceWarmupStart;
+	uint32_t               mRecordedFrames;
+	uint32_t               mHitchCount;
+	bool                   mInitialized;
+
+	char mLastHitch[256];
+	char mSummary[1024];
+};
+
+static FrameTimeStats gFrameTimeStats = {};
+
+static uint32_t frameTimeBin(double ms)
+{
+	if (ms <= gMinMs)
+		return 0;
+	const double bin = log(ms / gMinMs) / log(gBinGrowth);
+	return bin >= (double)(gBinCount - 1) ? gBinCount - 1 : (uint32_t)bin;
+}
+
+// Geometric middle of the bin
+static double frameTimeBinMs(uint32_t bin) { return gMinMs * pow(gBinGrowth, bin + 0.5); }
+
+static void addHistogramSample(FrameTimeHistogram* pHistogram, double ms)
+{
+	++pHistogram->mBins[frameTimeBin(ms)];
+	++pHistogram->mCount;
+	pHistogram->mSumMs += ms;
+}
+
+static void removeHistogramSample(FrameTimeHistogram* pHistogram, double ms)
+{
+	--pHistogram->mBins[frameTimeBin(ms)];
+	--pHistogram->mCount;
+	pHistogram->mSumMs -= ms;
+}
+
+// All gPercentiles in one pass over the bins, nearest rank
+static void getHistogramPercentiles(const FrameTimeHistogram* pHistogram, double* pResults)
+{
+	uint32_t percentile = 0;
+	uint32_t seen = 0;
+	for (uint32_t bin = 0; bin < gBinCount && percentile < gPercentileCount; ++bin)
+	{
+		seen += pHistogram->mBins[bin];
+		while (percentile < gPercentileCount && seen && seen >= (uint32_t)ceil(gPercentiles[percentile] * pHistogram->mCount))
+			pResults[percentile++] = frameTimeBinMs(bin);
+	}
+	for (; percentile < gPercentileCount; ++percentile)
+		pResults[percentile] = 0.0;
+}
+
+static double getHistogramAverage(const FrameTimeHistogram* pHistogram)
+{
+	return pHistogram->mCount ? pHistogram->mSumMs / pHistogram->mCount : 0.0;
+}
+
+static void recordFrameTimeSample(FrameTimeMetricStats* pMetric, double ms)
+{
+	if (pMetric->mWindow.mCount == gFrameTimeStats.mWindowFrames)
+		removeHistogramSample(&pMetric->mWindow, pMetric->mWindowMs[pMetric->mWindowNext]);
+	// Removal subtracts the stored float, so the window sum is built from the same values
+	pMetric->mWindowMs[pMetric->mWindowNext] = (float)ms;
+	addHistogramSample(&pMetric->mWindow, pMetric->mWindowMs[pMetric->mWindowNext]);
+	pMetric->mWindowNext = (pMetric->mWindowNext + 1) % gFrameTimeStats.mWindowFrames;
+
+	addHistogramSample(&pMetric->mRun, ms);
+	if (ms > pMetric->mRunMaxMs)
+		pMetric->mRunMaxMs = ms;
+	if (ms > gFrameTimeStats.mSettings.mHitchThresholdMs)
+		++pMetric->mRunOverThreshold;
+}
+
+// Logs the frame's samples and, for a CPU hitch, its main thread scopes, keeping the slowest scope for the summary. The
+// slowest nested scope says more than "Draw", so top level scopes only count when nothing is nested. The GPU frame time
+// comes from the profiler, frames in flight behind this CPU frame, so these scopes would blame the wrong frame for a
+// GPU-only hitch.
+static void reportHitch(bool cpuHitch)
+{
+	const FrameTimeMetricStats* pMetrics = gFrameTimeStats.mMetrics;
+	const bool                  log = gFrameTimeStats.mHitchCount <= gMaxLoggedHitches;
+	if (log)
+		LOGF(LogLevel::eWARNING, "Hitch in frame %u: CPU frame %.2f ms, GPU frame %.2f ms, fence wait %.2f ms, present %.2f ms",
+			 gFrameTimeStats.mRecordedFrames, pMetrics[FRAME_TIME_CPU_FRAME].mFrameMs, pMetrics[FRAME_TIME_GPU_FRAME].mFrameMs,
+			 pMetrics[FRAME_TIME_FENCE_WAIT].mFrameMs, pMetrics[FRAME_TIME_PRESENT].mFrameMs);
+	if (log && !cpuHitch)
+		LOGF(LogLevel::eWARNING, "    GPU only, the GPU frame time is of an earlier frame: no CPU scope breakdown");
+
+	uint32_t                   scopeCount = 0;
+	const FrameTraceScopeTime* pScopes = cpuHitch ? getFrameTraceScopeTimes(&scopeCount) : NULL;
+	const FrameTraceScopeTime* pSlowest = NULL;
+	for (uint32_t i = 0; i < scopeCount; ++i)
+	{
+		const FrameTraceScopeTime* pScope = &pScopes[i];
+		if (log)
+		{
+			if (pScope->mCount > 1)
+				LOGF(LogLevel::eWARNING, "    %*s%s %.2f ms (%u times)", pScope->mDepth * 2, "", pScope->pName, pScope->mMs,
+					 pScope->mCount);
+			else
+				LOGF(LogLevel::eWARNING, "    %*s%s %.2f ms", pScope->mDepth * 2, "", pScope->pName, pScope->mMs);
+		}
+		if (!pSlowest || (pScope->mDepth > 0 && pSlowest->mDepth == 0) ||
+			((pScope->mDepth > 0) == (pSlowest->mDepth > 0) && pScope->mMs > pSlowest->mMs))
+			pSlowest = pScope;
+	}
+	if (log && gFrameTimeStats.mHitchCount == gMaxLoggedHitches)
+		LOGF(LogLevel::eWARNING, "%u hitches logged, further ones are only counted", gMaxLoggedHitches);
+
+	const int length = snprintf(gFrameTimeStats.mLastHitch, sizeof(gFrameTimeStats.mLastHitch),
+								"Last hitch: frame %u, CPU %.2f ms, GPU %.2f ms", gFrameTimeStats.mRecordedFrames,
+								pMetrics[FRAME_TIME_CPU_FRAME].mFrameMs, pMetrics[FRAME_TIME_GPU_FRAME].mFrameMs);
+	if (pSlowest && length > 0 && (size_t)length < sizeof(gFrameTimeStats.mLastHitch))
+		snprintf(gFrameTimeStats.mLastHitch + length, sizeof(gFrameTimeStats.mLastHitch) - length, ", slowest scope %s %.2f ms",
+				 pSlowest->pName, pSlowest->mMs);
+}
+
+static void updateSummary()
+{
+	const FrameTimeStats& stats = gFrameTimeStats;
+	int                   length = stats.mFramesSinceWarmupStart < stats.mSettings.mWarmupFrames
+									   ? snprintf(gFrameTimeStats.mSummary, sizeof(gFrameTimeStats.mSummary), "[warm-up %u/%u] ",
+												  stats.mFramesSinceWarmupStart, stats.mSettings.mWarmupFrames)
+									   : 0;
+	length += snprintf(gFrameTimeStats.mSummary + length, sizeof(gFrameTimeStats.mSummary) - length,
+					   "%u hitches over %.1f ms in %u frames", stats.mHitchCount, stats.mSettings.mHitchThresholdMs,
+					   stats.mRecordedFrames);
+
+	for (uint32_t i = 0; i < FRAME_TIME_METRIC_COUNT && length > 0 && length < (int)sizeof(gFrameTimeStats.mSummary); ++i)
+	{
+		const FrameTimeHistogram* pWindow = &stats.mMetrics[i].mWindow;
+		if (!pWindow->mCount)
+			continue;
+		double percentiles[gPercentileCount];
+		getHistogramPercentiles(pWindow, percentiles);
+		length += snprintf(gFrameTimeStats.mSummary + length, sizeof(gFrameTimeStats.mSummary) - length,
+						   "\n    %-10s avg %6.2f  p50 %6.2f  p99 %6.2f  p99.9 %6.2f ms", gFrameTimeMetricLabels[i],
+						   getHistogramAverage(pWindow), percentiles[0], percentiles[1], percentiles[2]);
+	}
+
+	if (stats.mLastHitch[0] && length > 0 && length < (int)sizeof(gFrameTimeStats.mSummary))
+		snprintf(gFrameTimeStats.mSummary + length, sizeof(gFrameTimeStats.mSummary) - length, "\n%s", stats.mLastHitch);
+}
+
+void initFrameTimeStats(const FrameTimeStatsSettings* pSettings)
+{
+	ASSERT(!gFrameTimeStats.mInitialized);
+	memset(&gFrameTimeStats, 0, sizeof(gFrameTimeStats));
+	gFrameTimeStats.mSettings = *pSettings;
+	const uint32_t windowFrames = pSettings->mWindowFrames;
+	gFrameTimeStats.mWindowFrames = windowFrames == 0 || windowFrames > FRAME_TIME_MAX_WINDOW_FRAMES ? FRAME_TIME_MAX_WINDOW_FRAMES
+																									 : windowFrames;
+	initHiresTimer(&gFrameTimeStats.mCpuFrameTimer);
+	gFrameTimeStats.mInitialized = true;
+	updateSummary();
+}
+
+void exitFrameTimeStats(const char* pCsvFileName)
+{
+	if (!gFrameTimeStats.mInitialized)
+		return;
+
+	LOGF(LogLevel::eINFO, "Frame times: %u frames recorded, %u hitches over %.1f ms", gFrameTimeStats.mRecordedFrames,
+		 gFrameTimeStats.mHitchCount, gFrameTimeStats.mSettings.mHitchThresholdMs);
+
+	FileStream stream = {};
+	if (pCsvFileName && fsOpenStreamFromPath(RD_DEBUG, pCsvFileName, FM_WRITE, &stream))
+	{
+		static const char header[] = "metric,frames,avg_ms,p50_ms,p99_ms,p99_9_ms,max_ms,over_threshold\n";
+		fsWriteToStream(&stream, header, sizeof(header) - 1);
+		for (uint32_t i = 0; i < FRAME_TIME_METRIC_COUNT; ++i)
+		{
+			const FrameTimeMetricStats* pMetric = &gFrameTimeStats.mMetrics[i];
+			if (!pMetric->mRun.mCount)
+				continue;
+			// A bin's middle can lie past the largest sample in it
+			double percentiles[gPercentileCount];
+			getHistogramPercentiles(&pMetric->mRun, percentiles);
+			for (uint32_t p = 0; p < gPercentileCount; ++p)
+				percentiles[p] = percentiles[p] > pMetric->mRunMaxMs ? pMetric->mRunMaxMs : percentiles[p];
+
+			char      line[256];
+			const int length = snprintf(line, sizeof(line), "%s,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%u\n", gFrameTimeMetricNames[i],
+										pMetric->mRun.mCount, getHistogramAverage(&pMetric->mRun), percentiles[0], percentiles[1],
+										percentiles[2], pMetric->mRunMaxMs, pMetric->mRunOverThreshold);
+			fsWriteToStream(&stream, line, (size_t)length);
+		}
+		fsCloseStream(&stream);
+		LOGF(LogLevel::eINFO, "Frame time summary written to '%s'", pCsvFileName);
+	}
+	else if (pCsvFileName)
+	{
+		LOGF(LogLevel::eERROR, "Could not write frame time summary '%s'", pCsvFileName);
+	}
+
+	memset(&gFrameTimeStats, 0, sizeof(gFrameTimeStats));
+}
+
+FrameTimeStatsSettings* getFrameTimeStatsSettings() { return &gFrameTimeStats.mSettings; }
+
+void addFrameTimeSample(FrameTimeMetric metric, double ms)
+{
+	FrameTimeMetricStats* pMetric = &gFrameTimeStats.mMetrics[metric];
+	pMetric->mFrameMs = ms;
+	pMetric->mHasSample = true;
+}
+
+void frameTimeStatsEndFrame()
+{
+	if (!gFrameTimeStats.mInitialized)
+		return;
+
+	addFrameTimeSample(FRAME_TIME_CPU_FRAME, getHiresTimerUSec(&gFrameTimeStats.mCpuFrameTimer, true) / 1000.0);
+
+	FrameTimeMetricStats* pMetrics = gFrameTimeStats.mMetrics;
+	if (gFrameTimeStats.mFramesSinceWarmupStart < gFrameTimeStats.mSettings.mWarmupFrames)
+	{
+		++gFrameTimeStats.mFramesSinceWarmupStart;
+	}
+	else
+	{
+		++gFrameTimeStats.mRecordedFrames;
+		for (uint32_t i = 0; i < FRAME_TIME_METRIC_COUNT; ++i)
+		{
+			if (pMetrics[i].mHasSample)
+				recordFrameTimeSample(&pMetrics[i], pMetrics[i].mFrameMs);
+		}
+
+		const double threshold = gFrameTimeStats.mSettings.mHitchThresholdMs;
+		const bool   cpuHitch = pMetrics[FRAME_TIME_CPU_FRAME].mHasSample && pMetrics[FRAME_TIME_CPU_FRAME].mFrameMs > threshold;
+		const bool   gpuHitch = pMetrics[FRAME_TIME_GPU_FRAME].mHasSample && pMetrics[FRAME_TIME_GPU_FRAME].mFrameMs > threshold;
+		if (cpuHitch || gpuHitch)
+		{
+			++gFrameTimeStats.mHitchCount;
+			reportHitch(cpuHitch);
+		}
+	}
+
+	for (uint32_t i = 0; i < FRAME_TIME_METRIC_COUNT; ++i)
+	{
+		pMetrics[i].mLastFrameMs = pMetrics[i].mFrameMs;
+		pMetrics[i].mFrameMs = 0.0;
+		pMetrics[i].mHasSample = false;
+	}
+	updateSummary();
+}
+
+void frameTimeStatsRestartWarmup() { gFrameTimeStats.mFramesSinceWarmupStart = 0; }
+
+double getLastFrameTimeMs(FrameTimeMetric metric) { return gFrameTimeStats.mMetrics[metric].mLastFrameMs; }
+
+const char* getFrameTimeStatsSummary() { return gFrameTimeStats.mSummary; }
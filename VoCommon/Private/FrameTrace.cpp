@@ -0,0 +1,462 @@
+#include "VoCommon/Public/FrameTrace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Graphics/Interfaces/IGraphics.h"
+#include "Utilities/Interfaces/IFileSystem.h"
+#include "Utilities/Interfaces/ILog.h"
+#include "Utilities/Interfaces/IThread.h"
+#include "Utilities/Interfaces/ITime.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+static const uint32_t gMaxFrameTraceEvents = 1u << 16;
+static const uint32_t gMaxFrameTraceFrames = 1024;
+static const uint32_t gMaxFrameTraceThreads = 64;
+static const uint32_t gMaxFrameTraceSlots = 4;
+static const uint64_t gGpuThread = ~0ull;
+static const uint32_t gMaxOpenMainScopes = 16;
+static const uint32_t gWorkerScopeBit = 0x80000000u; // handle holds an event index, main thread handles are open scope slots
+
+struct FrameTraceEvent
+{
+	const char* pName;
+	double      mBeginUSec; // CPU clock, or GPU clock until the capture is written
+	double      mEndUSec;
+	uint64_t    mThread; // gGpuThread for GPU ranges
+	uint32_t    mFrame;  // relative to the first captured frame
+};
+
+// One per frame in flight
+struct GpuFrameSlot
+{
+	QueryPool*  pQueryPool;
+	const char* pNames[FRAME_TRACE_MAX_GPU_RANGES];
+	uint32_t    mRangeCount;
+	uint32_t    mOpen[FRAME_TRACE_MAX_GPU_RANGES];
+	uint32_t    mOpenCount;
+	uint32_t    mFrame;
+	bool        mRecording; // holds ranges of a captured frame, not read back yet
+};
+
+// Open main thread scope, the handle is its slot
+struct OpenMainScope
+{
+	uint32_t mScopeTime; // index into mScopeTimes, FRAME_TRACE_NO_SCOPE when the breakdown is full
+	uint32_t mEvent;
+	double   mBeginUSec;
+};
+
+// Per captured frame, for the GPU clock alignment
+struct GpuFrameClock
+{
+	double mSubmitUSec;
+	double mFirstGpuUSec;
+	bool   mValid;
+};
+
+struct FrameTrace
+{
+	Mutex            mMutex; // event appends
+	HiresTimer       mTimer;
+	FrameTraceEvent* pEvents;
+	uint32_t         mEventCount;
+	GpuFrameClock*   pClocks;
+	uint64_t         mMainThread;
+
+	FrameTraceScopeTime mScopeTimes[FRAME_TRACE_MAX_FRAME_SCOPES];
+	uint32_t            mScopeTimeCount;
+	OpenMainScope       mOpenScopes[gMaxOpenMainScopes];
+	uint32_t            mOpenScopeCount;
+
+	Renderer*    pRenderer;
+	double       mTimestampFrequency; // 0 without timestamp queries
+	GpuFrameSlot mSlots[gMaxFrameTraceSlots];
+	uint32_t     mSlotCount;
+	uint32_t     mCurrentSlot;
+
+	char     mFileName[64];
+	uint32_t mRequestedFrames;
+	uint32_t mFrame;            // frames since init
+	uint32_t mFirstFrame;       // of the capture
+	uint32_t mFrameCount;       // of the capture
+	uint32_t mFrameEvent;       // open "Frame" event
+	uint32_t mPendingGpuFrames; // captured frames whose ranges are not read back yet
+	bool     mCapturing;        // from the first captured frame until the file is written
+	bool     mRecording;        // inside the frame window
+	bool     mInitialized;
+};
+
+static FrameTrace gFrameTrace = {};
+
+static double frameTraceNow() { return (double)getHiresTimerUSec(&gFrameTrace.mTimer, false); }
+
+static uint32_t addFrameTraceEvent(const char* pName, uint64_t thread, double beginUSec)
+{
+	acquireMutex(&gFrameTrace.mMutex);
+	uint32_t event = FRAME_TRACE_NO_SCOPE;
+	if (gFrameTrace.mRecording && gFrameTrace.mEventCount < gMaxFrameTraceEvents)
+	{
+		event = gFrameTrace.mEventCount++;
+		FrameTraceEvent* pEvent = &gFrameTrace.pEvents[event];
+		pEvent->pName = pName;
+		pEvent->mBeginUSec = beginUSec;
+		pEvent->mEndUSec = beginUSec;
+		pEvent->mThread = thread;
+		pEvent->mFrame = gFrameTrace.mFrame - gFrameTrace.mFirstFrame;
+	}
+	releaseMutex(&gFrameTrace.mMutex);
+	return event;
+}
+
+void initFrameTrace(Renderer* pRenderer, Queue* pQueue, uint32_t gpuFrameCount)
+{
+	ASSERT(!gFrameTrace.mInitialized);
+	ASSERT(gpuFrameCount <= gMaxFrameTraceSlots);
+
+	gFrameTrace = {};
+	initMutex(&gFrameTrace.mMutex);
+	initHiresTimer(&gFrameTrace.mTimer);
+	gFrameTrace.pEvents = (FrameTraceEvent*)tf_calloc(gMaxFrameTraceEvents, sizeof(FrameTraceEvent));
+	gFrameTrace.pClocks = (GpuFrameClock*)tf_calloc(gMaxFrameTraceFrames, sizeof(GpuFrameClock));
+	gFrameTrace.mMainThread = (uint64_t)getCurrentThreadID();
+	gFrameTrace.mFrameEvent = FRAME_TRACE_NO_SCOPE;
+	gFrameTrace.pRenderer = pRenderer;
+	gFrameTrace.mSlotCount = gpuFrameCount;
+
+	if (pRenderer->pGpu->mTimestampQueries)
+	{
+		getTimestampFrequency(pQueue, &gFrameTrace.mTimestampFrequency);
+		QueryPoolDesc poolDesc = {};
+		poolDesc.mQueryCount = FRAME_TRACE_MAX_GPU_RANGES;
+		poolDesc.mType = QUERY_TYPE_TIMESTAMP;
+		for (uint32_t i = 0; i < gpuFrameCount; ++i)
+			initQueryPool(pRenderer, &poolDesc, &gFrameTrace.mSlots[i].pQueryPool);
+	}
+	gFrameTrace.mInitialized = true;
+}
+
+void exitFrameTrace()
+{
+	if (!gFrameTrace.mInitialized)
+		return;
+	if (gFrameTrace.mCapturing)
+		LOGF(LogLevel::eWARNING, "Frame trace '%s' was still capturing at exit, nothing written", gFrameTrace.mFileName);
+
+	for (uint32_t i = 0; i < gFrameTrace.mSlotCount; ++i)
+	{
+		if (gFrameTrace.mSlots[i].pQueryPool)
+			exitQueryPool(gFrameTrace.pRenderer, gFrameTrace.mSlots[i].pQueryPool);
+	}
+	tf_free(gFrameTrace.pEvents);
+	tf_free(gFrameTrace.pClocks);
+	exitMutex(&gFrameTrace.mMutex);
+	gFrameTrace = {};
+}
+
+void requestFrameTraceCapture(uint32_t frameCount, const char* pFileName)
+{
+	if (!gFrameTrace.mInitialized || gFrameTrace.mCapturing || !frameCount)
+		return;
+	gFrameTrace.mRequestedFrames = frameCount < gMaxFrameTraceFrames ? frameCount : gMaxFrameTraceFrames;
+	snprintf(gFrameTrace.mFileName, sizeof(gFrameTrace.mFileName), "%s", pFileName);
+}
+
+bool isFrameTraceCapturing() { return gFrameTrace.mCapturing || gFrameTrace.mRequestedFrames; }
+
+// Offset from the GPU clock to the CPU clock, see the header
+static double getGpuClockOffset()
+{
+	double offset = 0.0;
+	bool   found = false;
+	for (uint32_t i = 0; i < gFrameTrace.mFrameCount; ++i)
+	{
+		const GpuFrameClock* pClock = &gFrameTrace.pClocks[i];
+		if (!pClock->mValid)
+			continue;
+		const double frameOffset = pClock->mSubmitUSec - pClock->mFirstGpuUSec;
+		offset = !found || frameOffset > offset ? frameOffset : offset;
+		found = true;
+	}
+	return offset;
+}
+
+// Chrome trace thread id of a CPU thread, GPU ranges are tid 0 and the main thread tid 1
+static uint32_t getTraceThreadIndex(uint64_t* pThreads, uint32_t* pThreadCount, uint64_t thread)
+{
+	if (thread == gGpuThread)
+		return 0;
+	for (uint32_t i = 0; i < *pThreadCount; ++i)
+	{
+		if (pThreads[i] == thread)
+			return i + 1;
+	}
+	if (*pThreadCount == gMaxFrameTraceThreads)
+		return gMaxFrameTraceThreads;
+	pThreads[*pThreadCount] = thread;
+	return ++*pThreadCount;
+}
+
+// Complete ("X") events, GPU ranges on their own thread
+static const char* gFrameTraceEventFormat =
+	",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}";
+
+static void writeFrameTraceJson()
+{
+	FileStream stream = {};
+	if (!fsOpenStreamFromPath(RD_DEBUG, gFrameTrace.mFileName, FM_WRITE, &stream))
+	{
+		LOGF(LogLevel::eWARNING, "Could not write frame trace '%s'", gFrameTrace.mFileName);
+		return;
+	}
+
+	uint64_t threads[gMaxFrameTraceThreads] = { gFrameTrace.mMainThread };
+	uint32_t threadCount = 1;
+	char     line[256];
+	int      length = snprintf(line, sizeof(line),
+							   "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+							   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU (graphics queue)\"}},\n"
+							   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"Main thread\"}}");
+	fsWriteToStream(&stream, line, (size_t)length);
+
+	const double gpuOffset = getGpuClockOffset();
+	for (uint32_t i = 0; i < gFrameTrace.mEventCount; ++i)
+	{
+		const FrameTraceEvent* pEvent = &gFrameTrace.pEvents[i];
+		const bool             gpu = pEvent->mThread == gGpuThread;
+		const double           offset = gpu ? gpuOffset : 0.0;
+		const uint32_t         tid = getTraceThreadIndex(threads, &threadCount, pEvent->mThread);
+		length = snprintf(line, sizeof(line), gFrameTraceEventFormat, pEvent->pName, gpu ? "gpu" : "cpu", tid, pEvent->mBeginUSec + offset,
+						  pEvent->mEndUSec - pEvent->mBeginUSec, pEvent->mFrame);
+		fsWriteToStream(&stream, line, (size_t)length);
+	}
+	for (uint32_t i = 1; i < threadCount; ++i)
+	{
+		length = snprintf(line, sizeof(line),
+						  ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Worker %u\"}}", i + 1, i);
+		fsWriteToStream(&stream, line, (size_t)length);
+	}
+	fsWriteToStream(&stream, "\n]}\n", 4);
+	fsCloseStream(&stream);
+
+	LOGF(LogLevel::eINFO, "Frame trace: %u frames, %u events, %u threads written to '%s'%s", gFrameTrace.mFrameCount,
+		 gFrameTrace.mEventCount, threadCount, gFrameTrace.mFileName,
+		 gFrameTrace.mEventCount == gMaxFrameTraceEvents ? " (event buffer full, later events dropped)" : "");
+}
+
+void frameTraceBeginFrame()
+{
+	if (!gFrameTrace.mInitialized)
+		return;
+
+	if (gFrameTrace.mFrameEvent != FRAME_TRACE_NO_SCOPE)
+		gFrameTrace.pEvents[gFrameTrace.mFrameEvent].mEndUSec = frameTraceNow();
+	gFrameTrace.mFrameEvent = FRAME_TRACE_NO_SCOPE;
+	gFrameTrace.mScopeTimeCount = 0;
+	gFrameTrace.mOpenScopeCount = 0;
+	++gFrameTrace.mFrame;
+
+	if (gFrameTrace.mRequestedFrames && !gFrameTrace.mCapturing)
+	{
+		gFrameTrace.mCapturing = true;
+		gFrameTrace.mFirstFrame = gFrameTrace.mFrame;
+		gFrameTrace.mFrameCount = gFrameTrace.mRequestedFrames;
+		gFrameTrace.mRequestedFrames = 0;
+		gFrameTrace.mEventCount = 0;
+		gFrameTrace.mPendingGpuFrames = 0;
+		memset(gFrameTrace.pClocks, 0, gMaxFrameTraceFrames * sizeof(GpuFrameClock));
+	}
+	if (!gFrameTrace.mCapturing)
+		return;
+
+	acquireMutex(&gFrameTrace.mMutex);
+	gFrameTrace.mRecording = gFrameTrace.mFrame - gFrameTrace.mFirstFrame < gFrameTrace.mFrameCount;
+	releaseMutex(&gFrameTrace.mMutex);
+
+	if (gFrameTrace.mRecording)
+		gFrameTrace.mFrameEvent = addFrameTraceEvent("Frame", gFrameTrace.mMainThread, frameTraceNow());
+	else if (!gFrameTrace.mPendingGpuFrames)
+	{
+		writeFrameTraceJson();
+		gFrameTrace.mCapturing = false;
+	}
+}
+
+static uint32_t findFrameScopeTime(const char* pName)
+{
+	for (uint32_t i = 0; i < gFrameTrace.mScopeTimeCount; ++i)
+	{
+		if (gFrameTrace.mScopeTimes[i].pName == pName || strcmp(gFrameTrace.mScopeTimes[i].pName, pName) == 0)
+			return i;
+	}
+	return FRAME_TRACE_NO_SCOPE;
+}
+
+uint32_t frameTraceBeginCpuScope(const char* pName)
+{
+	const uint64_t thread = (uint64_t)getCurrentThreadID();
+	if (!gFrameTrace.mInitialized || thread != gFrameTrace.mMainThread)
+	{
+		// Unlocked early out, addFrameTraceEvent() checks again under the lock
+		if (!gFrameTrace.mRecording)
+			return FRAME_TRACE_NO_SCOPE;
+		const uint32_t event = addFrameTraceEvent(pName, thread, frameTraceNow());
+		return event == FRAME_TRACE_NO_SCOPE ? FRAME_TRACE_NO_SCOPE : event | gWorkerScopeBit;
+	}
+
+	if (gFrameTrace.mOpenScopeCount == gMaxOpenMainScopes)
+		return FRAME_TRACE_NO_SCOPE;
+	uint32_t scopeTime = findFrameScopeTime(pName);
+	if (scopeTime == FRAME_TRACE_NO_SCOPE && gFrameTrace.mScopeTimeCount < FRAME_TRACE_MAX_FRAME_SCOPES)
+	{
+		scopeTime = gFrameTrace.mScopeTimeCount++;
+		gFrameTrace.mScopeTimes[scopeTime] = { pName, 0.0, 0, gFrameTrace.mOpenScopeCount };
+	}
+
+	const uint32_t slot = gFrameTrace.mOpenScopeCount++;
+	OpenMainScope* pOpen = &gFrameTrace.mOpenScopes[slot];
+	pOpen->mScopeTime = scopeTime;
+	pOpen->mBeginUSec = frameTraceNow();
+	pOpen->mEvent = gFrameTrace.mRecording ? addFrameTraceEvent(pName, thread, pOpen->mBeginUSec) : FRAME_TRACE_NO_SCOPE;
+	return slot;
+}
+
+void frameTraceEndCpuScope(uint32_t scope)
+{
+	if (scope == FRAME_TRACE_NO_SCOPE)
+		return;
+	const double now = frameTraceNow();
+	if (scope & gWorkerScopeBit)
+	{
+		gFrameTrace.pEvents[scope & ~gWorkerScopeBit].mEndUSec = now;
+		return;
+	}
+
+	// Scopes nest, so this closes everything opened after it as well (normally nothing)
+	if (scope >= gFrameTrace.mOpenScopeCount)
+		return;
+	const OpenMainScope* pOpen = &gFrameTrace.mOpenScopes[scope];
+	gFrameTrace.mOpenScopeCount = scope;
+	if (pOpen->mScopeTime != FRAME_TRACE_NO_SCOPE)
+	{
+		FrameTraceScopeTime* pTime = &gFrameTrace.mScopeTimes[pOpen->mScopeTime];
+		pTime->mMs += (now - pOpen->mBeginUSec) / 1000.0;
+		++pTime->mCount;
+	}
+	if (pOpen->mEvent != FRAME_TRACE_NO_SCOPE)
+		gFrameTrace.pEvents[pOpen->mEvent].mEndUSec = now;
+}
+
+const FrameTraceScopeTime* getFrameTraceScopeTimes(uint32_t* pCount)
+{
+	*pCount = gFrameTrace.mScopeTimeCount;
+	return gFrameTrace.mScopeTimes;
+}
+
+double getFrameTraceScopeMs(const char* pName)
+{
+	const uint32_t scopeTime = findFrameScopeTime(pName);
+	return scopeTime == FRAME_TRACE_NO_SCOPE ? 0.0 : gFrameTrace.mScopeTimes[scopeTime].mMs;
+}
+
+// Fence of the slot waited on, the queries are complete
+static void readGpuFrameSlot(GpuFrameSlot* pSlot)
+{
+	const uint32_t frame = pSlot->mFrame - gFrameTrace.mFirstFrame;
+	double         firstUSec = 0.0;
+	bool           found = false;
+	for (uint32_t i = 0; i < pSlot->mRangeCount; ++i)
+	{
+		QueryData data = {};
+		getQueryData(gFrameTrace.pRenderer, pSlot->pQueryPool, i, &data);
+		if (data.mEndTimestamp < data.mBeginTimestamp)
+			continue;
+		const double beginUSec = data.mBeginTimestamp * 1000000.0 / gFrameTrace.mTimestampFrequency;
+		const double endUSec = data.mEndTimestamp * 1000000.0 / gFrameTrace.mTimestampFrequency;
+		firstUSec = !found || beginUSec < firstUSec ? beginUSec : firstUSec;
+		found = true;
+
+		acquireMutex(&gFrameTrace.mMutex);
+		if (gFrameTrace.mEventCount < gMaxFrameTraceEvents)
+		{
+			FrameTraceEvent* pEvent = &gFrameTrace.pEvents[gFrameTrace.mEventCount++];
+			pEvent->pName = pSlot->pNames[i];
+			pEvent->mBeginUSec = beginUSec;
+			pEvent->mEndUSec = endUSec;
+			pEvent->mThread = gGpuThread;
+			pEvent->mFrame = frame;
+		}
+		releaseMutex(&gFrameTrace.mMutex);
+	}
+	gFrameTrace.pClocks[frame].mFirstGpuUSec = firstUSec;
+	gFrameTrace.pClocks[frame].mValid = found;
+}
+
+void frameTraceBeginGpuFrame(Cmd* pCmd, uint32_t frameIndex)
+{
+	if (!gFrameTrace.mInitialized || !gFrameTrace.mTimestampFrequency)
+		return;
+
+	ASSERT(frameIndex < gFrameTrace.mSlotCount);
+	gFrameTrace.mCurrentSlot = frameIndex;
+	GpuFrameSlot* pSlot = &gFrameTrace.mSlots[frameIndex];
+	if (pSlot->mRecording)
+	{
+		readGpuFrameSlot(pSlot);
+		--gFrameTrace.mPendingGpuFrames;
+	}
+
+	pSlot->mRecording = gFrameTrace.mRecording;
+	pSlot->mFrame = gFrameTrace.mFrame;
+	pSlot->mRangeCount = 0;
+	pSlot->mOpenCount = 0;
+	if (pSlot->mRecording)
+	{
+		cmdResetQuery(pCmd, pSlot->pQueryPool, 0, FRAME_TRACE_MAX_GPU_RANGES);
+		++gFrameTrace.mPendingGpuFrames;
+	}
+}
+
+void frameTraceBeginGpuRange(Cmd* pCmd, const char* pName)
+{
+	GpuFrameSlot* pSlot = &gFrameTrace.mSlots[gFrameTrace.mCurrentSlot];
+	if (!pSlot->mRecording || pSlot->mOpenCount == FRAME_TRACE_MAX_GPU_RANGES)
+		return;
+	if (pSlot->mRangeCount == FRAME_TRACE_MAX_GPU_RANGES)
+	{
+		// Out of queries, the matching end closes nothing
+		pSlot->mOpen[pSlot->mOpenCount++] = FRAME_TRACE_NO_SCOPE;
+		return;
+	}
+
+	const uint32_t range = pSlot->mRangeCount++;
+	pSlot->pNames[range] = pName;
+	pSlot->mOpen[pSlot->mOpenCount++] = range;
+	QueryDesc queryDesc = { range };
+	cmdBeginQuery(pCmd, pSlot->pQueryPool, &queryDesc);
+}
+
+void frameTraceEndGpuRange(Cmd* pCmd)
+{
+	GpuFrameSlot* pSlot = &gFrameTrace.mSlots[gFrameTrace.mCurrentSlot];
+	if (!pSlot->mRecording || !pSlot->mOpenCount)
+		return;
+
+	const uint32_t range = pSlot->mOpen[--pSlot->mOpenCount];
+	if (range == FRAME_TRACE_NO_SCOPE)
+		return;
+	QueryDesc queryDesc = { range };
+	cmdEndQuery(pCmd, pSlot->pQueryPool, &queryDesc);
+}
+
+void frameTraceEndGpuFrame(Cmd* pCmd)
+{
+	GpuFrameSlot* pSlot = &gFrameTrace.mSlots[gFrameTrace.mCurrentSlot];
+	if (!pSlot->mRecording)
+		return;
+
+	if (pSlot->mRangeCount)
+		cmdResolveQuery(pCmd, pSlot->pQueryPool, 0, pSlot->mRangeCount);
+	gFrameTrace.pClocks[pSlot->mFrame - gFrameTrace.mFirstFrame].mSubmitUSec = frameTraceNow();
+}
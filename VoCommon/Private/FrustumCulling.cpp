@@ -0,0 +1,165 @@
+#include "VoCommon/Public/FrustumCulling.h"
+
+#include <math.h>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define VO_CULLING_SSE 1
+#else
+#define VO_CULLING_SSE 0
+#endif
+
+#include "Utilities/Interfaces/ILog.h"
+#include "Utilities/Interfaces/ITime.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+static inline uint32_t hashUint(uint32_t seed, uint32_t value)
+{
+	uint32_t h = seed ^ (value * 0x9E3779B9u);
+	h ^= h >> 16;
+	h *= 0x7FEB352Du;
+	h ^= h >> 15;
+	h *= 0x846CA68Bu;
+	h ^= h >> 16;
+	return h;
+}
+
+void extractFrustumPlanes(const float* pViewProjection, FrustumPlanes* pFrustum)
+{
+	// Row r of the column-major matrix is pViewProjection[r], [4 + r], [8 + r], [12 + r]
+	float rows[4][4];
+	for (uint32_t r = 0; r < 4; ++r)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+			rows[r][c] = pViewProjection[c * 4 + r];
+	}
+
+	// -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		pFrustum->mPlanes[0][c] = rows[3][c] + rows[0][c];
+		pFrustum->mPlanes[1][c] = rows[3][c] - rows[0][c];
+		pFrustum->mPlanes[2][c] = rows[3][c] + rows[1][c];
+		pFrustum->mPlanes[3][c] = rows[3][c] - rows[1][c];
+		pFrustum->mPlanes[4][c] = rows[2][c];
+		pFrustum->mPlanes[5][c] = rows[3][c] - rows[2][c];
+	}
+
+	for (uint32_t p = 0; p < 6; ++p)
+	{
+		float*      pPlane = pFrustum->mPlanes[p];
+		const float length = sqrtf(pPlane[0] * pPlane[0] + pPlane[1] * pPlane[1] + pPlane[2] * pPlane[2]);
+		const float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+		for (uint32_t c = 0; c < 4; ++c)
+			pPlane[c] *= invLength;
+	}
+}
+
+static uint32_t cullSpheresScalar(const FrustumPlanes* pFrustum, const float* pCenterX, const float* pCenterY, const float* pCenterZ,
+								  const float* pRadius, uint32_t first, uint32_t end, uint32_t* pVisible)
+{
+	uint32_t visibleCount = 0;
+	for (uint32_t i = first; i < end; ++i)
+	{
+		bool visible = true;
+		for (uint32_t p = 0; p < 6 && visible; ++p)
+		{
+			const float* pPlane = pFrustum->mPlanes[p];
+			visible = pPlane[0] * pCenterX[i] + pPlane[1] * pCenterY[i] + pPlane[2] * pCenterZ[i] + pPlane[3] >= -pRadius[i];
+		}
+		if (visible)
+			pVisible[visibleCount++] = i;
+	}
+	return visibleCount;
+}
+
+uint32_t cullSpheres(const FrustumPlanes* pFrustum, const float* pCenterX, const float* pCenterY, const float* pCenterZ,
+					 const float* pRadius, uint32_t count, uint32_t* pVisible)
+{
+	uint32_t visibleCount = 0;
+	uint32_t i = 0;
+#if VO_CULLING_SSE
+	__m128 planes[6][4];
+	for (uint32_t p = 0; p < 6; ++p)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+			planes[p][c] = _mm_set1_ps(pFrustum->mPlanes[p][c]);
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(pCenterX + i);
+		const __m128 y = _mm_loadu_ps(pCenterY + i);
+		const __m128 z = _mm_loadu_ps(pCenterZ + i);
+		const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(pRadius + i));
+
+		// All six planes, no early out: branching per plane costs more than the arithmetic
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (uint32_t p = 0; p < 6; ++p)
+		{
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+											   _mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+		}
+
+		uint32_t mask = (uint32_t)_mm_movemask_ps(inside);
+		while (mask)
+		{
+			const uint32_t lane = mask & 1 ? 0 : (mask & 2 ? 1 : (mask & 4 ? 2 : 3));
+			pVisible[visibleCount++] = i + lane;
+			mask &= mask - 1;
+		}
+	}
+#endif
+	visibleCount += cullSpheresScalar(pFrustum, pCenterX, pCenterY, pCenterZ, pRadius, i, count, pVisible + visibleCount);
+	return visibleCount;
+}
+
+void benchmarkFrustumCulling()
+{
+	// 90 degree symmetric frustum looking down -z, near 0.1, far 1000, depth [0, w]
+	const float n = 0.1f;
+	const float f = 1000.0f;
+	const float viewProjection[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, f / (n - f), -1, 0, 0, n * f / (n - f), 0 };
+	FrustumPlanes frustum;
+	extractFrustumPlanes(viewProjection, &frustum);
+
+	for (uint32_t count = 1000; count <= 1000000; count *= 10)
+	{
+		const uint32_t iterations = count < 100000 ? 100 : 10;
+		float*         pSpheres = (float*)tf_malloc((size_t)count * 4 * sizeof(float));
+		uint32_t*      pVisible = (uint32_t*)tf_malloc(count * sizeof(uint32_t));
+		float*         pCenterX = pSpheres;
+		float*         pCenterY = pSpheres + count;
+		float*         pCenterZ = pSpheres + count * 2;
+		float*         pRadius = pSpheres + count * 3;
+
+		// Spread around the camera, about a sixth ends up visible
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			pCenterX[i] = float(hashUint(0, i) & 0xFFFF) / 65535.0f * 400.0f - 200.0f;
+			pCenterY[i] = float(hashUint(1, i) & 0xFFFF) / 65535.0f * 400.0f - 200.0f;
+			pCenterZ[i] = float(hashUint(2, i) & 0xFFFF) / 65535.0f * 400.0f - 200.0f;
+			pRadius[i] = float(hashUint(3, i) & 0xFFFF) / 65535.0f * 2.0f;
+		}
+
+		HiresTimer timer;
+		initHiresTimer(&timer);
+		uint32_t scalarVisible = 0;
+		for (uint32_t i = 0; i < iterations; ++i)
+			scalarVisible = cullSpheresScalar(&frustum, pCenterX, pCenterY, pCenterZ, pRadius, 0, count, pVisible);
+		const double scalarMs = getHiresTimerUSec(&timer, true) / 1000.0 / iterations;
+
+		uint32_t visible = 0;
+		for (uint32_t i = 0; i < iterations; ++i)
+			visible = cullSpheres(&frustum, pCenterX, pCenterY, pCenterZ, pRadius, count, pVisible);
+		const double simdMs = getHiresTimerUSec(&timer, true) / 1000.0 / iterations;
+
+		LOGF(LogLevel::eINFO, "Frustum culling %8u spheres: %8u visible, scalar %8.3f ms, SSE %8.3f ms, %7.1f Mspheres/s%s", count, visible,
+			 scalarMs, simdMs, simdMs > 0.0 ? count / (simdMs * 1000.0) : 0.0, visible == scalarVisible ? "" : " MISMATCH");
+
+		tf_free(pVisible);
+		tf_free(pSpheres);
+	}
+}
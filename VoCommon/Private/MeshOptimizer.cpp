@@ -0,0 +1,383 @@
+#include "VoCommon/Public/MeshOptimizer.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Utilities/Interfaces/ILog.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+// Minimum triangles in a soft overdraw cluster, smaller ones cost more cache misses than they save in sorting
+static const uint32_t gMinOverdrawClusterSize = 16;
+
+// FIFO cache simulation shared by the statistics and the overdraw clustering. A vertex is cached while fewer than
+// cacheSize misses happened since it was last transformed.
+struct FifoCache
+{
+	uint32_t* pTimestamps;
+	uint32_t  mTime;
+	uint32_t  mCacheSize;
+};
+
+static void initFifoCache(FifoCache* pCache, uint32_t vertexCount, uint32_t cacheSize)
+{
+	pCache->pTimestamps = (uint32_t*)tf_calloc(vertexCount, sizeof(uint32_t));
+	pCache->mTime = cacheSize + 1;
+	pCache->mCacheSize = cacheSize;
+}
+
+static void exitFifoCache(FifoCache* pCache) { tf_free(pCache->pTimestamps); }
+
+// Forgets every cached vertex without touching the timestamp array.
+static void flushFifoCache(FifoCache* pCache) { pCache->mTime += pCache->mCacheSize + 1; }
+
+// Returns the number of misses (0 to 3) of one triangle.
+static uint32_t fetchTriangle(FifoCache* pCache, const uint32_t* pTriangle)
+{
+	uint32_t misses = 0;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		const uint32_t v = pTriangle[i];
+		if (pCache->mTime - pCache->pTimestamps[v] > pCache->mCacheSize)
+		{
+			pCache->pTimestamps[v] = pCache->mTime++;
+			++misses;
+		}
+	}
+	return misses;
+}
+
+VertexCacheStats analyzeVertexCache(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+	ASSERT(indexCount % 3 == 0);
+
+	VertexCacheStats stats = {};
+	FifoCache        cache = {};
+	initFifoCache(&cache, vertexCount, cacheSize);
+	uint8_t* pReferenced = (uint8_t*)tf_calloc(vertexCount, sizeof(uint8_t));
+	uint32_t referencedCount = 0;
+
+	for (uint32_t i = 0; i < indexCount; i += 3)
+	{
+		stats.mVerticesTransformed += fetchTriangle(&cache, pIndices + i);
+		for (uint32_t j = 0; j < 3; ++j)
+		{
+			referencedCount += pReferenced[pIndices[i + j]] ? 0 : 1;
+			pReferenced[pIndices[i + j]] = 1;
+		}
+	}
+
+	tf_free(pReferenced);
+	exitFifoCache(&cache);
+
+	stats.mAcmr = indexCount ? float(stats.mVerticesTransformed) / float(indexCount / 3) : 0.0f;
+	stats.mAtvr = referencedCount ? float(stats.mVerticesTransformed) / float(referencedCount) : 0.0f;
+	return stats;
+}
+
+struct TipsifyState
+{
+	uint32_t*       pAdjacencyOffsets; // vertexCount + 1, triangles of v are pAdjacency[offsets[v], offsets[v + 1])
+	uint32_t*       pAdjacency;
+	uint32_t*       pLiveTriangles;
+	uint32_t*       pCacheTime;
+	uint8_t*        pEmitted;
+	uint32_t*       pDeadEnd; // stack, each emitted triangle pushes its 3 vertices
+	uint32_t        mDeadEndCount;
+	uint32_t        mCursor; // next vertex to try when the dead end stack is exhausted
+	uint32_t        mVertexCount;
+	uint32_t        mTime;
+	uint32_t        mCacheSize;
+};
+
+static uint32_t skipDeadEnd(TipsifyState* pState)
+{
+	while (pState->mDeadEndCount)
+	{
+		const uint32_t v = pState->pDeadEnd[--pState->mDeadEndCount];
+		if (pState->pLiveTriangles[v])
+			return v;
+	}
+	for (; pState->mCursor < pState->mVertexCount; ++pState->mCursor)
+	{
+		if (pState->pLiveTriangles[pState->mCursor])
+			return pState->mCursor;
+	}
+	return UINT32_MAX;
+}
+
+// Prefers the candidate that is still in the cache after fanning around it, and was cached the longest.
+static uint32_t getNextVertex(TipsifyState* pState, const uint32_t* pCandidates, uint32_t candidateCount)
+{
+	uint32_t best = UINT32_MAX;
+	int64_t  bestPriority = -1;
+	for (uint32_t i = 0; i < candidateCount; ++i)
+	{
+		const uint32_t v = pCandidates[i];
+		if (!pState->pLiveTriangles[v])
+			continue;
+
+		const uint32_t age = pState->mTime - pState->pCacheTime[v];
+		const int64_t  priority = age + 2 * pState->pLiveTriangles[v] <= pState->mCacheSize ? (int64_t)age : 0;
+		if (priority > bestPriority)
+		{
+			best = v;
+			bestPriority = priority;
+		}
+	}
+	return best != UINT32_MAX ? best : skipDeadEnd(pState);
+}
+
+void optimizeVertexCache(uint32_t* pDstIndices, const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+	ASSERT(pDstIndices != pIndices);
+	ASSERT(indexCount % 3 == 0);
+
+	const uint32_t triangleCount = indexCount / 3;
+	if (!triangleCount)
+		return;
+
+	TipsifyState state = {};
+	state.mVertexCount = vertexCount;
+	state.mCacheSize = cacheSize;
+	state.mTime = cacheSize + 1;
+	state.pAdjacencyOffsets = (uint32_t*)tf_calloc(vertexCount + 1, sizeof(uint32_t));
+	state.pAdjacency = (uint32_t*)tf_malloc(indexCount * sizeof(uint32_t));
+	state.pLiveTriangles = (uint32_t*)tf_calloc(vertexCount, sizeof(uint32_t));
+	state.pCacheTime = (uint32_t*)tf_calloc(vertexCount, sizeof(uint32_t));
+	state.pEmitted = (uint8_t*)tf_calloc(triangleCount, sizeof(uint8_t));
+	state.pDeadEnd = (uint32_t*)tf_malloc(indexCount * sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < indexCount; ++i)
+		++state.pLiveTriangles[pIndices[i]];
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		state.pAdjacencyOffsets[v + 1] = state.pAdjacencyOffsets[v] + state.pLiveTriangles[v];
+	// pCacheTime doubles as the fill cursor, it is reset before the reordering starts
+	for (uint32_t i = 0; i < indexCount; ++i)
+	{
+		const uint32_t v = pIndices[i];
+		state.pAdjacency[state.pAdjacencyOffsets[v] + state.pCacheTime[v]++] = i / 3;
+	}
+	memset(state.pCacheTime, 0, vertexCount * sizeof(uint32_t));
+
+	// The candidates of one fan are the vertices of the triangles around a single vertex
+	uint32_t maxValence = 0;
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		maxValence = state.pLiveTriangles[v] > maxValence ? state.pLiveTriangles[v] : maxValence;
+	uint32_t* pCandidates = (uint32_t*)tf_malloc(3 * (size_t)maxValence * sizeof(uint32_t));
+
+	uint32_t* pDst = pDstIndices;
+	uint32_t  fanVertex = skipDeadEnd(&state);
+	while (fanVertex != UINT32_MAX)
+	{
+		uint32_t candidateCount = 0;
+		for (uint32_t a = state.pAdjacencyOffsets[fanVertex]; a < state.pAdjacencyOffsets[fanVertex + 1]; ++a)
+		{
+			const uint32_t triangle = state.pAdjacency[a];
+			if (state.pEmitted[triangle])
+				continue;
+
+			state.pEmitted[triangle] = 1;
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				const uint32_t v = pIndices[triangle * 3 + i];
+				*pDst++ = v;
+				state.pDeadEnd[state.mDeadEndCount++] = v;
+				pCandidates[candidateCount++] = v;
+				--state.pLiveTriangles[v];
+				if (state.mTime - state.pCacheTime[v] > cacheSize)
+					state.pCacheTime[v] = state.mTime++;
+			}
+		}
+		fanVertex = getNextVertex(&state, pCandidates, candidateCount);
+	}
+	ASSERT(pDst == pDstIndices + indexCount);
+
+	tf_free(pCandidates);
+	tf_free(state.pDeadEnd);
+	tf_free(state.pEmitted);
+	tf_free(state.pCacheTime);
+	tf_free(state.pLiveTriangles);
+	tf_free(state.pAdjacency);
+	tf_free(state.pAdjacencyOffsets);
+}
+
+struct OverdrawCluster
+{
+	uint32_t mFirstTriangle;
+	uint32_t mTriangleCount;
+	float    mSortKey;
+};
+
+static int compareOverdrawClusters(const void* pA, const void* pB)
+{
+	const OverdrawCluster* pClusterA = (const OverdrawCluster*)pA;
+	const OverdrawCluster* pClusterB = (const OverdrawCluster*)pB;
+	// Descending key, ties keep the cache order
+	if (pClusterA->mSortKey != pClusterB->mSortKey)
+		return pClusterA->mSortKey > pClusterB->mSortKey ? -1 : 1;
+	return pClusterA->mFirstTriangle < pClusterB->mFirstTriangle ? -1 : 1;
+}
+
+static inline float length3(const float* v) { return sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]); }
+
+static inline const float* getPosition(const void* pPositions, uint32_t positionStride, uint32_t vertex)
+{
+	return (const float*)((const uint8_t*)pPositions + (uint64_t)vertex * positionStride);
+}
+
+// Twice the area weighted normal and three times the area weighted centroid, the constant factors cancel out.
+static void getTriangleMoments(const void* pPositions, uint32_t positionStride, const uint32_t* pTriangle, float* pNormal, float* pCentroid)
+{
+	const float* p0 = getPosition(pPositions, positionStride, pTriangle[0]);
+	const float* p1 = getPosition(pPositions, positionStride, pTriangle[1]);
+	const float* p2 = getPosition(pPositions, positionStride, pTriangle[2]);
+	const float  e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	const float  e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+	pNormal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	pNormal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	pNormal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	for (uint32_t i = 0; i < 3; ++i)
+		pCentroid[i] = p0[i] + p1[i] + p2[i];
+}
+
+void optimizeOverdraw(uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount,
+					  uint32_t cacheSize, float threshold)
+{
+	ASSERT(indexCount % 3 == 0);
+
+	const uint32_t triangleCount = indexCount / 3;
+	if (!triangleCount)
+		return;
+
+	// Hard boundaries: triangles that miss on all three vertices start over anyway, nothing is lost by splitting there
+	FifoCache cache = {};
+	initFifoCache(&cache, vertexCount, cacheSize);
+	uint32_t* pHardStarts = (uint32_t*)tf_malloc((triangleCount + 1) * sizeof(uint32_t));
+	uint32_t  hardCount = 0;
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		if (fetchTriangle(&cache, pIndices + t * 3) == 3 || t == 0)
+			pHardStarts[hardCount++] = t;
+	}
+	pHardStarts[hardCount] = triangleCount;
+
+	// Soft boundaries: split a hard cluster wherever the part since the last split already is within threshold of the
+	// ACMR of the whole cluster, the cache is flushed at each split to account for the lost reuse
+	OverdrawCluster* pClusters = (OverdrawCluster*)tf_malloc(triangleCount * sizeof(OverdrawCluster));
+	uint32_t         clusterCount = 0;
+	for (uint32_t h = 0; h < hardCount; ++h)
+	{
+		const uint32_t begin = pHardStarts[h];
+		const uint32_t end = pHardStarts[h + 1];
+
+		flushFifoCache(&cache);
+		uint32_t hardMisses = 0;
+		for (uint32_t t = begin; t < end; ++t)
+			hardMisses += fetchTriangle(&cache, pIndices + t * 3);
+		const float maxAcmr = threshold * float(hardMisses) / float(end - begin);
+
+		flushFifoCache(&cache);
+		uint32_t softStart = begin;
+		uint32_t softMisses = 0;
+		for (uint32_t t = begin; t < end; ++t)
+		{
+			softMisses += fetchTriangle(&cache, pIndices + t * 3);
+			const uint32_t softCount = t + 1 - softStart;
+			if (t + 1 < end && softCount >= gMinOverdrawClusterSize && float(softMisses) <= maxAcmr * float(softCount))
+			{
+				pClusters[clusterCount++] = { softStart, softCount, 0.0f };
+				softStart = t + 1;
+				softMisses = 0;
+				flushFifoCache(&cache);
+			}
+		}
+		pClusters[clusterCount++] = { softStart, end - softStart, 0.0f };
+	}
+	tf_free(pHardStarts);
+	exitFifoCache(&cache);
+
+	// Sort key: how much the cluster faces away from the mesh center. On a convex-ish mesh the clusters drawn first
+	// are the ones most likely to occlude the rest.
+	float meshArea = 0.0f;
+	float meshCentroid[3] = {};
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		float normal[3], centroid[3];
+		getTriangleMoments(pPositions, positionStride, pIndices + t * 3, normal, centroid);
+		const float area = length3(normal);
+		for (uint32_t i = 0; i < 3; ++i)
+			meshCentroid[i] += centroid[i] * area;
+		meshArea += area;
+	}
+	for (uint32_t i = 0; meshArea > 0.0f && i < 3; ++i)
+		meshCentroid[i] /= 3.0f * meshArea;
+
+	for (uint32_t c = 0; c < clusterCount; ++c)
+	{
+		OverdrawCluster* pCluster = &pClusters[c];
+		float            clusterArea = 0.0f;
+		float            clusterNormal[3] = {};
+		float            clusterCentroid[3] = {};
+		for (uint32_t t = pCluster->mFirstTriangle; t < pCluster->mFirstTriangle + pCluster->mTriangleCount; ++t)
+		{
+			float normal[3], centroid[3];
+			getTriangleMoments(pPositions, positionStride, pIndices + t * 3, normal, centroid);
+			const float area = length3(normal);
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				clusterNormal[i] += normal[i];
+				clusterCentroid[i] += centroid[i] * area;
+			}
+			clusterArea += area;
+		}
+		if (clusterArea <= 0.0f)
+			continue;
+
+		const float normalLength = length3(clusterNormal);
+		const float invNormalLength = normalLength > 0.0f ? 1.0f / normalLength : 0.0f;
+		for (uint32_t i = 0; i < 3; ++i)
+			pCluster->mSortKey += (clusterCentroid[i] / (3.0f * clusterArea) - meshCentroid[i]) * clusterNormal[i] * invNormalLength;
+	}
+
+	qsort(pClusters, clusterCount, sizeof(OverdrawCluster), compareOverdrawClusters);
+
+	uint32_t* pSorted = (uint32_t*)tf_malloc(indexCount * sizeof(uint32_t));
+	uint32_t* pDst = pSorted;
+	for (uint32_t c = 0; c < clusterCount; ++c)
+	{
+		memcpy(pDst, pIndices + pClusters[c].mFirstTriangle * 3, pClusters[c].mTriangleCount * 3 * sizeof(uint32_t));
+		pDst += pClusters[c].mTriangleCount * 3;
+	}
+	memcpy(pIndices, pSorted, indexCount * sizeof(uint32_t));
+
+	tf_free(pSorted);
+	tf_free(pClusters);
+}
+
+void optimizeVertexFetchRemap(uint32_t* pRemap, uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount)
+{
+	memset(pRemap, 0xFF, vertexCount * sizeof(uint32_t));
+
+	uint32_t nextVertex = 0;
+	for (uint32_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t* pNew = &pRemap[pIndices[i]];
+		if (*pNew == UINT32_MAX)
+			*pNew = nextVertex++;
+		pIndices[i] = *pNew;
+	}
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		if (pRemap[v] == UINT32_MAX)
+			pRemap[v] = nextVertex++;
+	}
+}
+
+void remapVertexBuffer(void* pDst, const void* pSrc, uint32_t vertexCount, uint32_t stride, const uint32_t* pRemap)
+{
+	ASSERT(pDst != pSrc);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		memcpy((uint8_t*)pDst + (uint64_t)pRemap[v] * stride, (const uint8_t*)pSrc + (uint64_t)v * stride, stride);
+}
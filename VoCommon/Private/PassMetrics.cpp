@@ -0,0 +1,295 @@
+#include "VoCommon/Public/PassMetrics.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "Graphics/Interfaces/IGraphics.h"
+#include "Utilities/Interfaces/ILog.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+static const uint32_t gMaxPassMetricsSlots = 4;
+// With multi-view (Quest) a pipeline statistics query takes one consecutive query per view, so pass p owns queries
+// p * gPipelineStatsViewCount and up; its numbers are read from the first view's.
+#if defined(QUEST_VR)
+static const uint32_t gPipelineStatsViewCount = 2;
+#else
+static const uint32_t gPipelineStatsViewCount = 1;
+#endif
+static const uint32_t gPipelineStatsQueryCount = PASS_METRICS_MAX_PASSES * gPipelineStatsViewCount;
+
+struct PassMetricsSlot
+{
+	QueryPool* pTimestampPool;
+	QueryPool* pPipelineStatsPool;
+	uint32_t   mRecordedPasses; // bit per pass recorded in the frame the slot holds
+};
+
+struct PassMetricsState
+{
+	Renderer*       pRenderer;
+	PassMetrics     mPasses[PASS_METRICS_MAX_PASSES];
+	uint32_t        mPassCount;
+	PassMetricsSlot mSlots[gMaxPassMetricsSlots];
+	uint32_t        mSlotCount;
+	uint32_t        mCurrentSlot;
+	uint32_t        mSupportedFlags;
+	uint32_t        mOpenStatsPass; // pipeline statistics queries can't overlap
+	double          mTimestampFrequency;
+	bool            mInitialized;
+
+	char mSummary[2048];
+};
+
+static PassMetricsState gPassMetrics = {};
+
+static void readPassMetricsSlot(PassMetricsSlot* pSlot)
+{
+	for (uint32_t pass = 0; pass < gPassMetrics.mPassCount; ++pass)
+	{
+		PassMetrics* pMetrics = &gPassMetrics.mPasses[pass];
+		pMetrics->mUpdated = (pSlot->mRecordedPasses >> pass) & 1;
+		if (!pMetrics->mUpdated)
+			continue;
+
+		QueryData data = {};
+		if (pMetrics->mFlags & PASS_METRICS_TIMESTAMPS)
+		{
+			getQueryData(gPassMetrics.pRenderer, pSlot->pTimestampPool, pass, &data);
+			pMetrics->mGpuMs = data.mEndTimestamp > data.mBeginTimestamp
+								   ? (data.mEndTimestamp - data.mBeginTimestamp) * 1000.0 / gPassMetrics.mTimestampFrequency
+								   : 0.0;
+		}
+		if (pMetrics->mFlags & PASS_METRICS_PIPELINE_STATS)
+		{
+			data = {};
+			getQueryData(gPassMetrics.pRenderer, pSlot->pPipelineStatsPool, pass * gPipelineStatsViewCount, &data);
+			pMetrics->mStats.mIAVertices = data.mPipelineStats.mIAVertices;
+			pMetrics->mStats.mIAPrimitives = data.mPipelineStats.mIAPrimitives;
+			pMetrics->mStats.mVSInvocations = data.mPipelineStats.mVSInvocations;
+			pMetrics->mStats.mCInvocations = data.mPipelineStats.mCInvocations;
+			pMetrics->mStats.mCPrimitives = data.mPipelineStats.mCPrimitives;
+			pMetrics->mStats.mPSInvocations = data.mPipelineStats.mPSInvocations;
+			pMetrics->mStats.mCSInvocations = data.mPipelineStats.mCSInvocations;
+		}
+
+		if (!pMetrics->mFrameCount || pMetrics->mGpuMs < pMetrics->mGpuMsMin)
+			pMetrics->mGpuMsMin = pMetrics->mGpuMs;
+		if (!pMetrics->mFrameCount || pMetrics->mGpuMs > pMetrics->mGpuMsMax)
+			pMetrics->mGpuMsMax = pMetrics->mGpuMs;
+		++pMetrics->mFrameCount;
+		pMetrics->mGpuMsSum += pMetrics->mGpuMs;
+		PassPipelineStats* pSum = &pMetrics->mStatsSum;
+		pSum->mIAVertices += pMetrics->mStats.mIAVertices;
+		pSum->mIAPrimitives += pMetrics->mStats.mIAPrimitives;
+		pSum->mVSInvocations += pMetrics->mStats.mVSInvocations;
+		pSum->mCInvocations += pMetrics->mStats.mCInvocations;
+		pSum->mCPrimitives += pMetrics->mStats.mCPrimitives;
+		pSum->mPSInvocations += pMetrics->mStats.mPSInvocations;
+		pSum->mCSInvocations += pMetrics->mStats.mCSInvocations;
+	}
+	pSlot->mRecordedPasses = 0;
+}
+
+// vsnprintf at the end of the summary, nothing once it's full
+static void appendSummary(int* pLength, const char* pFormat, ...)
+{
+	const int size = (int)sizeof(gPassMetrics.mSummary);
+	if (*pLength < 0 || *pLength >= size)
+		return;
+	va_list args;
+	va_start(args, pFormat);
+	const int length = vsnprintf(gPassMetrics.mSummary + *pLength, (size_t)(size - *pLength), pFormat, args);
+	va_end(args);
+	*pLength = length < 0 ? -1 : *pLength + length;
+}
+
+static void updateSummary()
+{
+	int length = 0;
+	gPassMetrics.mSummary[0] = '\0';
+	for (uint32_t pass = 0; pass < gPassMetrics.mPassCount; ++pass)
+	{
+		const PassMetrics* pMetrics = &gPassMetrics.mPasses[pass];
+		appendSummary(&length, "%s%s:", pass ? "\n" : "", pMetrics->pName);
+		if (!pMetrics->mFlags)
+			appendSummary(&length, " n/a");
+		if (pMetrics->mFlags & PASS_METRICS_TIMESTAMPS)
+			appendSummary(&length, " %.3f ms, avg %.3f ms (min %.3f, max %.3f, %u frames)", pMetrics->mGpuMs,
+						  getPassMetricsAverageGpuMs(pMetrics), pMetrics->mGpuMsMin, pMetrics->mGpuMsMax, pMetrics->mFrameCount);
+		if (pMetrics->mFlags & PASS_METRICS_PIPELINE_STATS)
+		{
+			const PassPipelineStats* pStats = &pMetrics->mStats;
+			appendSummary(&length, "\n    VS %llu, PS %llu, clipper %llu, IA primitives %llu, clipper primitives %llu",
+						  (unsigned long long)pStats->mVSInvocations, (unsigned long long)pStats->mPSInvocations,
+						  (unsigned long long)pStats->mCInvocations, (unsigned long long)pStats->mIAPrimitives,
+						  (unsigned long long)pStats->mCPrimitives);
+		}
+	}
+}
+
+void initPassMetrics(Renderer* pRenderer, Queue* pQueue, uint32_t gpuFrameCount)
+{
+	ASSERT(!gPassMetrics.mInitialized);
+	ASSERT(gpuFrameCount <= gMaxPassMetricsSlots);
+
+	gPassMetrics = {};
+	gPassMetrics.pRenderer = pRenderer;
+	gPassMetrics.mSlotCount = gpuFrameCount;
+	gPassMetrics.mOpenStatsPass = PASS_METRICS_NO_PASS;
+
+	if (pRenderer->pGpu->mTimestampQueries)
+	{
+		gPassMetrics.mSupportedFlags |= PASS_METRICS_TIMESTAMPS;
+		getTimestampFrequency(pQueue, &gPassMetrics.mTimestampFrequency);
+		QueryPoolDesc poolDesc = {};
+		poolDesc.mQueryCount = PASS_METRICS_MAX_PASSES;
+		poolDesc.mType = QUERY_TYPE_TIMESTAMP;
+		for (uint32_t i = 0; i < gpuFrameCount; ++i)
+			initQueryPool(pRenderer, &poolDesc, &gPassMetrics.mSlots[i].pTimestampPool);
+	}
+	if (pRenderer->pGpu->mPipelineStatsQueries)
+	{
+		gPassMetrics.mSupportedFlags |= PASS_METRICS_PIPELINE_STATS;
+		QueryPoolDesc poolDesc = {};
+		poolDesc.mQueryCount = gPipelineStatsQueryCount;
+		poolDesc.mType = QUERY_TYPE_PIPELINE_STATISTICS;
+		for (uint32_t i = 0; i < gpuFrameCount; ++i)
+			initQueryPool(pRenderer, &poolDesc, &gPassMetrics.mSlots[i].pPipelineStatsPool);
+	}
+	gPassMetrics.mInitialized = true;
+}
+
+void exitPassMetrics()
+{
+	if (!gPassMetrics.mInitialized)
+		return;
+	for (uint32_t i = 0; i < gPassMetrics.mSlotCount; ++i)
+	{
+		if (gPassMetrics.mSlots[i].pTimestampPool)
+			exitQueryPool(gPassMetrics.pRenderer, gPassMetrics.mSlots[i].pTimestampPool);
+		if (gPassMetrics.mSlots[i].pPipelineStatsPool)
+			exitQueryPool(gPassMetrics.pRenderer, gPassMetrics.mSlots[i].pPipelineStatsPool);
+	}
+	gPassMetrics = {};
+}
+
+uint32_t addMetricsPass(const char* pName, uint32_t flags)
+{
+	ASSERT(gPassMetrics.mInitialized);
+	if (gPassMetrics.mPassCount == PASS_METRICS_MAX_PASSES)
+	{
+		LOGF(LogLevel::eWARNING, "Pass metrics: no room for pass '%s'", pName);
+		return PASS_METRICS_NO_PASS;
+	}
+	const uint32_t pass = gPassMetrics.mPassCount++;
+	PassMetrics*   pMetrics = &gPassMetrics.mPasses[pass];
+	*pMetrics = {};
+	pMetrics->pName = pName;
+	pMetrics->mFlags = flags & gPassMetrics.mSupportedFlags;
+	updateSummary();
+	return pass;
+}
+
+void passMetricsBeginFrame(Cmd* pCmd, uint32_t frameIndex)
+{
+	if (!gPassMetrics.mInitialized)
+		return;
+
+	ASSERT(frameIndex < gPassMetrics.mSlotCount);
+	gPassMetrics.mCurrentSlot = frameIndex;
+	PassMetricsSlot* pSlot = &gPassMetrics.mSlots[frameIndex];
+	readPassMetricsSlot(pSlot);
+	updateSummary();
+
+	if (pSlot->pTimestampPool)
+		cmdResetQuery(pCmd, pSlot->pTimestampPool, 0, PASS_METRICS_MAX_PASSES);
+	if (pSlot->pPipelineStatsPool)
+		cmdResetQuery(pCmd, pSlot->pPipelineStatsPool, 0, gPipelineStatsQueryCount);
+}
+
+void passMetricsBeginPass(Cmd* pCmd, uint32_t pass)
+{
+	if (!gPassMetrics.mInitialized || pass == PASS_METRICS_NO_PASS)
+		return;
+
+	ASSERT(pass < gPassMetrics.mPassCount);
+	PassMetricsSlot* pSlot = &gPassMetrics.mSlots[gPassMetrics.mCurrentSlot];
+	ASSERT(!((pSlot->mRecordedPasses >> pass) & 1));
+	pSlot->mRecordedPasses |= 1u << pass;
+
+	const uint32_t flags = gPassMetrics.mPasses[pass].mFlags;
+	if (flags & PASS_METRICS_TIMESTAMPS)
+	{
+		QueryDesc queryDesc = { pass };
+		cmdBeginQuery(pCmd, pSlot->pTimestampPool, &queryDesc);
+	}
+	if (flags & PASS_METRICS_PIPELINE_STATS)
+	{
+		ASSERT(gPassMetrics.mOpenStatsPass == PASS_METRICS_NO_PASS);
+		gPassMetrics.mOpenStatsPass = pass;
+		QueryDesc queryDesc = { pass * gPipelineStatsViewCount };
+		cmdBeginQuery(pCmd, pSlot->pPipelineStatsPool, &queryDesc);
+	}
+}
+
+void passMetricsEndPass(Cmd* pCmd, uint32_t pass)
+{
+	if (!gPassMetrics.mInitialized || pass == PASS_METRICS_NO_PASS)
+		return;
+
+	PassMetricsSlot* pSlot = &gPassMetrics.mSlots[gPassMetrics.mCurrentSlot];
+	const uint32_t   flags = gPassMetrics.mPasses[pass].mFlags;
+	if (flags & PASS_METRICS_PIPELINE_STATS)
+	{
+		ASSERT(gPassMetrics.mOpenStatsPass == pass);
+		gPassMetrics.mOpenStatsPass = PASS_METRICS_NO_PASS;
+		QueryDesc queryDesc = { pass * gPipelineStatsViewCount };
+		cmdEndQuery(pCmd, pSlot->pPipelineStatsPool, &queryDesc);
+	}
+	if (flags & PASS_METRICS_TIMESTAMPS)
+	{
+		QueryDesc queryDesc = { pass };
+		cmdEndQuery(pCmd, pSlot->pTimestampPool, &queryDesc);
+	}
+}
+
+void passMetricsEndFrame(Cmd* pCmd)
+{
+	if (!gPassMetrics.mInitialized)
+		return;
+
+	// Only the queries this frame wrote
+	PassMetricsSlot* pSlot = &gPassMetrics.mSlots[gPassMetrics.mCurrentSlot];
+	for (uint32_t pass = 0; pass < gPassMetrics.mPassCount; ++pass)
+	{
+		if (!((pSlot->mRecordedPasses >> pass) & 1))
+			continue;
+		const uint32_t flags = gPassMetrics.mPasses[pass].mFlags;
+		if (flags & PASS_METRICS_TIMESTAMPS)
+			cmdResolveQuery(pCmd, pSlot->pTimestampPool, pass, 1);
+		if (flags & PASS_METRICS_PIPELINE_STATS)
+			cmdResolveQuery(pCmd, pSlot->pPipelineStatsPool, pass * gPipelineStatsViewCount, gPipelineStatsViewCount);
+	}
+}
+
+void resetPassMetrics()
+{
+	for (uint32_t pass = 0; pass < gPassMetrics.mPassCount; ++pass)
+	{
+		PassMetrics* pMetrics = &gPassMetrics.mPasses[pass];
+		pMetrics->mFrameCount = 0;
+		pMetrics->mGpuMsSum = 0.0;
+		pMetrics->mGpuMsMin = 0.0;
+		pMetrics->mGpuMsMax = 0.0;
+		pMetrics->mStatsSum = {};
+	}
+}
+
+const PassMetrics* getPassMetrics(uint32_t pass)
+{
+	ASSERT(pass < gPassMetrics.mPassCount);
+	return &gPassMetrics.mPasses[pass];
+}
+
+const char* getPassMetricsSummary() { return gPassMetrics.mSummary; }
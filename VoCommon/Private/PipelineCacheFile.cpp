@@ -0,0 +1,60 @@
+#include "VoCommon/Public/PipelineCacheFile.h"
+
+#include <stdio.h>
+
+#include "Graphics/Interfaces/IGraphics.h"
+#include "Resources/ResourceLoader/Interfaces/IResourceLoader.h"
+#include "Utilities/Interfaces/IFileSystem.h"
+#include "Utilities/Interfaces/ILog.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+void loadPipelineCacheFile(Renderer* pRenderer, const char* pFileName, bool enabled, PipelineCacheFile* pFile)
+{
+	*pFile = {};
+	snprintf(pFile->mFileName, sizeof(pFile->mFileName), "%s", pFileName);
+	if (!enabled)
+	{
+		LOGF(LogLevel::eINFO, "Pipeline cache '%s' disabled, pipelines are created cold", pFile->mFileName);
+		return;
+	}
+
+	FileStream stream = {};
+	if (fsOpenStreamFromPath(RD_PIPELINE_CACHE, pFile->mFileName, FM_READ, &stream))
+	{
+		pFile->mLoadedFromDisk = fsGetStreamFileSize(&stream) > 0;
+		fsCloseStream(&stream);
+	}
+
+	PipelineCacheLoadDesc loadDesc = {};
+	loadDesc.pFileName = pFile->mFileName;
+	loadPipelineCache(pRenderer, &loadDesc, &pFile->pCache);
+	LOGF(LogLevel::eINFO, "Pipeline cache '%s': %s", pFile->mFileName,
+		 pFile->mLoadedFromDisk ? "loaded from disk" : "none yet, starting empty");
+}
+
+void savePipelineCacheFile(Renderer* pRenderer, PipelineCacheFile* pFile)
+{
+	if (!pFile->pCache)
+		return;
+
+	PipelineCacheSaveDesc saveDesc = {};
+	saveDesc.pFileName = pFile->mFileName;
+	savePipelineCache(pRenderer, pFile->pCache, &saveDesc);
+	removePipelineCache(pRenderer, pFile->pCache);
+	pFile->pCache = NULL;
+}
+
+void logPipelineCreation(PipelineCacheFile* pFile, const char* pName, uint64_t microseconds)
+{
+	const char* pState = "cold, no cache";
+	if (pFile->pCache && pFile->mLoadedFromDisk)
+		pState = "warm, cache from disk";
+	else if (pFile->pCache && pFile->mBatchCount)
+		pState = "warm, cache filled this run";
+	else if (pFile->pCache)
+		pState = "cold, empty cache";
+
+	LOGF(LogLevel::eINFO, "%s pipelines created in %.2f ms (%s)", pName, microseconds / 1000.0, pState);
+	++pFile->mBatchCount;
+}
@@ -0,0 +1,205 @@
+#include "VoCommon/Public/StartupTrace.h"
+
+#include <stdio.h>
+
+#include "Utilities/Interfaces/IFileSystem.h"
+#include "Utilities/Interfaces/ILog.h"
+#include "Utilities/Interfaces/IThread.h"
+#include "Utilities/Interfaces/ITime.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+static const uint32_t gMaxStartupEvents = 256;
+static const uint32_t gMaxStartupDepth = 8;
+static const uint32_t gMaxPendingLoads = 64;
+
+enum StartupLane
+{
+	STARTUP_LANE_MAIN,
+	STARTUP_LANE_LOADS,
+};
+
+struct StartupEvent
+{
+	char     mName[64];
+	uint64_t mStartUSec;
+	uint64_t mEndUSec;
+	uint32_t mDepth;
+	uint32_t mLane;
+};
+
+struct PendingLoad
+{
+	uint32_t  mEvent;
+	SyncToken mToken;
+};
+
+struct StartupTrace
+{
+	HiresTimer   mTimer;
+	StartupEvent mEvents[gMaxStartupEvents];
+	uint32_t     mEventCount;
+	uint32_t     mOpen[gMaxStartupDepth];
+	uint32_t     mDepth;
+	PendingLoad  mPendingLoads[gMaxPendingLoads];
+	uint32_t     mPendingLoadCount;
+	bool         mActive;
+};
+
+static StartupTrace gStartupTrace = {};
+
+static uint64_t startupTraceNow() { return getHiresTimerUSec(&gStartupTrace.mTimer, false); }
+
+// Returns the new event, or NULL when full. The name is sanitized for the JSON output.
+static StartupEvent* addStartupEvent(const char* pName, uint32_t lane)
+{
+	if (gStartupTrace.mEventCount == gMaxStartupEvents)
+		return NULL;
+
+	StartupEvent* pEvent = &gStartupTrace.mEvents[gStartupTrace.mEventCount++];
+	snprintf(pEvent->mName, sizeof(pEvent->mName), "%s", pName);
+	for (char* c = pEvent->mName; *c; ++c)
+	{
+		if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20)
+			*c = '_';
+	}
+	pEvent->mStartUSec = startupTraceNow();
+	pEvent->mEndUSec = pEvent->mStartUSec;
+	pEvent->mDepth = lane == STARTUP_LANE_MAIN ? gStartupTrace.mDepth : 0;
+	pEvent->mLane = lane;
+	return pEvent;
+}
+
+void initStartupTrace()
+{
+	gStartupTrace = {};
+	initHiresTimer(&gStartupTrace.mTimer);
+	gStartupTrace.mActive = true;
+}
+
+void startupTraceBegin(const char* pName)
+{
+	if (!gStartupTrace.mActive || gStartupTrace.mDepth == gMaxStartupDepth)
+		return;
+
+	StartupEvent* pEvent = addStartupEvent(pName, STARTUP_LANE_MAIN);
+	gStartupTrace.mOpen[gStartupTrace.mDepth++] = pEvent ? (uint32_t)(pEvent - gStartupTrace.mEvents) : UINT32_MAX;
+}
+
+void startupTraceEnd()
+{
+	if (!gStartupTrace.mActive || !gStartupTrace.mDepth)
+		return;
+
+	const uint32_t event = gStartupTrace.mOpen[--gStartupTrace.mDepth];
+	if (event != UINT32_MAX)
+		gStartupTrace.mEvents[event].mEndUSec = startupTraceNow();
+}
+
+void startupTraceAddLoad(const char* pName, const SyncToken* pToken)
+{
+	if (!gStartupTrace.mActive || gStartupTrace.mPendingLoadCount == gMaxPendingLoads)
+		return;
+
+	StartupEvent* pEvent = addStartupEvent(pName, STARTUP_LANE_LOADS);
+	if (!pEvent)
+		return;
+	PendingLoad* pLoad = &gStartupTrace.mPendingLoads[gStartupTrace.mPendingLoadCount++];
+	pLoad->mEvent = (uint32_t)(pEvent - gStartupTrace.mEvents);
+	pLoad->mToken = *pToken;
+}
+
+void startupTraceWaitForLoads()
+{
+	startupTraceBegin("waitForAllResourceLoads");
+	// Loads run in parallel and complete in any order: poll all of them and stamp each one the first time it is seen
+	// completed, swapping it out of the pending list
+	while (gStartupTrace.mPendingLoadCount)
+	{
+		for (uint32_t i = 0; i < gStartupTrace.mPendingLoadCount;)
+		{
+			PendingLoad* pLoad = &gStartupTrace.mPendingLoads[i];
+			if (!isTokenCompleted(&pLoad->mToken))
+			{
+				++i;
+				continue;
+			}
+			gStartupTrace.mEvents[pLoad->mEvent].mEndUSec = startupTraceNow();
+			*pLoad = gStartupTrace.mPendingLoads[--gStartupTrace.mPendingLoadCount];
+		}
+		if (gStartupTrace.mPendingLoadCount)
+			threadSleep(0);
+	}
+	waitForAllResourceLoads();
+	startupTraceEnd();
+}
+
+// Complete ("X") events, one thread per lane
+static const char* gStartupEventFormat =
+	",\n{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu,\"dur\":%llu}";
+
+static void writeStartupTraceJson(const char* pFileName)
+{
+	FileStream stream = {};
+	if (!fsOpenStreamFromPath(RD_DEBUG, pFileName, FM_WRITE, &stream))
+	{
+		LOGF(LogLevel::eWARNING, "Could not write startup trace '%s'", pFileName);
+		return;
+	}
+
+	char line[256];
+	int  length = snprintf(line, sizeof(line),
+						   "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+						   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Main thread\"}},\n"
+						   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Resource loads\"}}",
+						   STARTUP_LANE_MAIN, STARTUP_LANE_LOADS);
+	fsWriteToStream(&stream, line, (size_t)length);
+	for (uint32_t i = 0; i < gStartupTrace.mEventCount; ++i)
+	{
+		const StartupEvent* pEvent = &gStartupTrace.mEvents[i];
+		length = snprintf(line, sizeof(line), gStartupEventFormat, pEvent->mName, pEvent->mLane, (unsigned long long)pEvent->mStartUSec,
+						  (unsigned long long)(pEvent->mEndUSec - pEvent->mStartUSec));
+		fsWriteToStream(&stream, line, (size_t)length);
+	}
+	fsWriteToStream(&stream, "\n]}\n", 4);
+	fsCloseStream(&stream);
+}
+
+void finishStartupTrace(const char* pFileName)
+{
+	if (!gStartupTrace.mActive)
+		return;
+	while (gStartupTrace.mDepth)
+		startupTraceEnd();
+	gStartupTrace.mActive = false;
+
+	// Slowest first, insertion sort of at most gMaxStartupEvents indices
+	const uint64_t totalUSec = startupTraceNow();
+	uint32_t       order[gMaxStartupEvents];
+	for (uint32_t i = 0; i < gStartupTrace.mEventCount; ++i)
+	{
+		const StartupEvent* pEvent = &gStartupTrace.mEvents[i];
+		const uint64_t      duration = pEvent->mEndUSec - pEvent->mStartUSec;
+		uint32_t            j = i;
+		for (; j > 0; --j)
+		{
+			const StartupEvent* pOther = &gStartupTrace.mEvents[order[j - 1]];
+			if (pOther->mEndUSec - pOther->mStartUSec >= duration)
+				break;
+			order[j] = order[j - 1];
+		}
+		order[j] = i;
+	}
+
+	LOGF(LogLevel::eINFO, "Startup took %.2f ms, %u phases and loads (nested phases are included in their parents):", totalUSec / 1000.0,
+		 gStartupTrace.mEventCount);
+	for (uint32_t i = 0; i < gStartupTrace.mEventCount; ++i)
+	{
+		const StartupEvent* pEvent = &gStartupTrace.mEvents[order[i]];
+		const uint64_t      duration = pEvent->mEndUSec - pEvent->mStartUSec;
+		LOGF(LogLevel::eINFO, "  %9.2f ms %5.1f%%  %s%*s%s", duration / 1000.0, totalUSec ? 100.0 * duration / totalUSec : 0.0,
+			 pEvent->mLane == STARTUP_LANE_LOADS ? "[load] " : "", (int)pEvent->mDepth * 2, "", pEvent->mName);
+	}
+
+	writeStartupTraceJson(pFileName);
+}
@@ -0,0 +1,105 @@
+#include "VoCommon/Public/TextureStreaming.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Utilities/Interfaces/ILog.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+void initTextureStreamer(TextureStreamer* pStreamer, const uint8_t* pPlaceholderColor)
+{
+	*pStreamer = {};
+	initHiresTimer(&pStreamer->mTimer);
+
+	TextureDesc desc = {};
+	desc.mWidth = 1;
+	desc.mHeight = 1;
+	desc.mDepth = 1;
+	desc.mArraySize = 1;
+	desc.mMipLevels = 1;
+	desc.mFormat = TinyImageFormat_R8G8B8A8_SRGB;
+	desc.mSampleCount = SAMPLE_COUNT_1;
+	desc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+	desc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+	desc.pName = "StreamingPlaceholder";
+
+	TextureLoadDesc loadDesc = {};
+	loadDesc.pDesc = &desc;
+	loadDesc.ppTexture = &pStreamer->pPlaceholder;
+	addResource(&loadDesc, NULL);
+
+	TextureUpdateDesc updateDesc = {};
+	updateDesc.pTexture = pStreamer->pPlaceholder;
+	updateDesc.mMipLevels = 1;
+	updateDesc.mLayerCount = 1;
+	updateDesc.mCurrentState = RESOURCE_STATE_SHADER_RESOURCE;
+	beginUpdateResource(&updateDesc);
+	TextureSubresourceUpdate subresource = updateDesc.getSubresourceUpdateDesc(0, 0);
+	memcpy(subresource.pMappedData, pPlaceholderColor, 4);
+	endUpdateResource(&updateDesc);
+}
+
+void exitTextureStreamer(TextureStreamer* pStreamer)
+{
+	if (pStreamer->mPendingCount)
+		waitForAllResourceLoads();
+
+	for (uint32_t i = 0; i < pStreamer->mTextureCount; ++i)
+	{
+		if (pStreamer->mTextures[i].pTexture)
+			removeResource(pStreamer->mTextures[i].pTexture);
+	}
+	if (pStreamer->pPlaceholder)
+		removeResource(pStreamer->pPlaceholder);
+	*pStreamer = {};
+}
+
+uint32_t requestStreamedTexture(TextureStreamer* pStreamer, const char* pFileName, TextureCreationFlags flags)
+{
+	ASSERT(pStreamer->mTextureCount < TEXTURE_STREAMER_MAX_TEXTURES);
+	const uint32_t   index = pStreamer->mTextureCount++;
+	StreamedTexture* pTexture = &pStreamer->mTextures[index];
+	snprintf(pTexture->mFileName, sizeof(pTexture->mFileName), "%s", pFileName);
+	pTexture->mRequestUSec = getHiresTimerUSec(&pStreamer->mTimer, false);
+	pTexture->mRequestFrame = pStreamer->mFrame;
+
+	TextureLoadDesc loadDesc = {};
+	loadDesc.pFileName = pFileName;
+	loadDesc.ppTexture = &pTexture->pTexture;
+	loadDesc.mCreationFlag = flags;
+	addResource(&loadDesc, &pTexture->mToken);
+	++pStreamer->mPendingCount;
+	return index;
+}
+
+bool updateTextureStreamer(TextureStreamer* pStreamer)
+{
+	const uint32_t frame = pStreamer->mFrame++;
+	if (!pStreamer->mPendingCount)
+		return false;
+
+	// Polled once per frame, so the latency includes up to a frame of slack
+	bool completed = false;
+	for (uint32_t i = 0; i < pStreamer->mTextureCount; ++i)
+	{
+		StreamedTexture* pTexture = &pStreamer->mTextures[i];
+		if (pTexture->mLoaded || !isTokenCompleted(&pTexture->mToken))
+			continue;
+
+		pTexture->mLoaded = true;
+		--pStreamer->mPendingCount;
+		completed = true;
+
+		const double latencyMs = (getHiresTimerUSec(&pStreamer->mTimer, false) - pTexture->mRequestUSec) / 1000.0;
+		if (pTexture->pTexture)
+			LOGF(LogLevel::eINFO, "Streamed texture '%s' in %.2f ms (%u frames with the placeholder)", pTexture->mFileName, latencyMs,
+				 frame - pTexture->mRequestFrame);
+		else
+			LOGF(LogLevel::eERROR, "Failed to stream texture '%s', keeping the placeholder", pTexture->mFileName);
+	}
+
+	if (completed)
+		++pStreamer->mVersion;
+	return completed;
+}
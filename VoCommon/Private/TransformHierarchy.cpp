@@ -0,0 +1,456 @@
+#include "VoCommon/Public/TransformHierarchy.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define VO_TRANSFORM_SSE 1
+#else
+#define VO_TRANSFORM_SSE 0
+#endif
+
+#include "Utilities/Interfaces/ILog.h"
+#include "Utilities/Interfaces/ITime.h"
+
+#include "VoCommon/Public/FrameTrace.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+// Nodes handled by a single task, a multiple of 4. Levels up to this size run on the calling thread.
+static const uint32_t gNodesPerTask = 2048;
+
+static const float gIdentityMatrix[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+// Rotation-scale columns and translation of four local transforms, one lane per node:
+// mColumns[column * 3 + row], mColumns[9 + row] is the translation.
+struct LocalMatrices4
+{
+	float mColumns[12][4];
+};
+
+struct TransformTaskData
+{
+	TransformHierarchy* pHierarchy;
+	uint32_t            mFirstNode;
+	uint32_t            mEndNode;
+};
+
+static inline uint32_t hashUint(uint32_t seed, uint32_t value)
+{
+	uint32_t h = seed ^ (value * 0x9E3779B9u);
+	h ^= h >> 16;
+	h *= 0x7FEB352Du;
+	h ^= h >> 15;
+	h *= 0x846CA68Bu;
+	h ^= h >> 16;
+	return h;
+}
+
+// Standard quaternion to matrix, columns scaled by the uniform scale.
+static inline void computeLocalMatrix(const TransformHierarchy* pHierarchy, uint32_t node, LocalMatrices4* pLocal, uint32_t lane)
+{
+	const float x = pHierarchy->pRotationX[node];
+	const float y = pHierarchy->pRotationY[node];
+	const float z = pHierarchy->pRotationZ[node];
+	const float w = pHierarchy->pRotationW[node];
+	const float s = pHierarchy->pScale[node];
+
+	float(*m)[4] = pLocal->mColumns;
+	m[0][lane] = (1.0f - 2.0f * (y * y + z * z)) * s;
+	m[1][lane] = 2.0f * (x * y + w * z) * s;
+	m[2][lane] = 2.0f * (x * z - w * y) * s;
+	m[3][lane] = 2.0f * (x * y - w * z) * s;
+	m[4][lane] = (1.0f - 2.0f * (x * x + z * z)) * s;
+	m[5][lane] = 2.0f * (y * z + w * x) * s;
+	m[6][lane] = 2.0f * (x * z + w * y) * s;
+	m[7][lane] = 2.0f * (y * z - w * x) * s;
+	m[8][lane] = (1.0f - 2.0f * (x * x + y * y)) * s;
+	m[9][lane] = pHierarchy->pPositionX[node];
+	m[10][lane] = pHierarchy->pPositionY[node];
+	m[11][lane] = pHierarchy->pPositionZ[node];
+}
+
+#if VO_TRANSFORM_SSE
+// Same as computeLocalMatrix for nodes [node, node + 4), straight from the SoA arrays.
+static inline void computeLocalMatrices4(const TransformHierarchy* pHierarchy, uint32_t node, LocalMatrices4* pLocal)
+{
+	const __m128 x = _mm_loadu_ps(pHierarchy->pRotationX + node);
+	const __m128 y = _mm_loadu_ps(pHierarchy->pRotationY + node);
+	const __m128 z = _mm_loadu_ps(pHierarchy->pRotationZ + node);
+	const __m128 w = _mm_loadu_ps(pHierarchy->pRotationW + node);
+	const __m128 s = _mm_loadu_ps(pHierarchy->pScale + node);
+	const __m128 s2 = _mm_add_ps(s, s);
+
+	const __m128 xx = _mm_mul_ps(x, x);
+	const __m128 yy = _mm_mul_ps(y, y);
+	const __m128 zz = _mm_mul_ps(z, z);
+	const __m128 xy = _mm_mul_ps(x, y);
+	const __m128 xz = _mm_mul_ps(x, z);
+	const __m128 yz = _mm_mul_ps(y, z);
+	const __m128 wx = _mm_mul_ps(w, x);
+	const __m128 wy = _mm_mul_ps(w, y);
+	const __m128 wz = _mm_mul_ps(w, z);
+
+	float(*m)[4] = pLocal->mColumns;
+	_mm_storeu_ps(m[0], _mm_sub_ps(s, _mm_mul_ps(s2, _mm_add_ps(yy, zz))));
+	_mm_storeu_ps(m[1], _mm_mul_ps(s2, _mm_add_ps(xy, wz)));
+	_mm_storeu_ps(m[2], _mm_mul_ps(s2, _mm_sub_ps(xz, wy)));
+	_mm_storeu_ps(m[3], _mm_mul_ps(s2, _mm_sub_ps(xy, wz)));
+	_mm_storeu_ps(m[4], _mm_sub_ps(s, _mm_mul_ps(s2, _mm_add_ps(xx, zz))));
+	_mm_storeu_ps(m[5], _mm_mul_ps(s2, _mm_add_ps(yz, wx)));
+	_mm_storeu_ps(m[6], _mm_mul_ps(s2, _mm_add_ps(xz, wy)));
+	_mm_storeu_ps(m[7], _mm_mul_ps(s2, _mm_sub_ps(yz, wx)));
+	_mm_storeu_ps(m[8], _mm_sub_ps(s, _mm_mul_ps(s2, _mm_add_ps(xx, yy))));
+	_mm_storeu_ps(m[9], _mm_loadu_ps(pHierarchy->pPositionX + node));
+	_mm_storeu_ps(m[10], _mm_loadu_ps(pHierarchy->pPositionY + node));
+	_mm_storeu_ps(m[11], _mm_loadu_ps(pHierarchy->pPositionZ + node));
+}
+#endif
+
+// World = parent world * local. The local matrix is affine, so each world column is a combination of the first three
+// parent columns (plus the fourth for the translation).
+static inline void computeWorldMatrix(TransformHierarchy* pHierarchy, uint32_t node, const LocalMatrices4* pLocal, uint32_t lane)
+{
+	const uint32_t parent = pHierarchy->pParents[node];
+	const float*   pParent = parent == TRANSFORM_NO_PARENT ? gIdentityMatrix : pHierarchy->pWorldMatrices + (uint64_t)parent * 16;
+	float*         pWorld = pHierarchy->pWorldMatrices + (uint64_t)node * 16;
+	const float(*m)[4] = pLocal->mColumns;
+
+#if VO_TRANSFORM_SSE
+	const __m128 c0 = _mm_loadu_ps(pParent);
+	const __m128 c1 = _mm_loadu_ps(pParent + 4);
+	const __m128 c2 = _mm_loadu_ps(pParent + 8);
+	const __m128 c3 = _mm_loadu_ps(pParent + 12);
+	for (uint32_t column = 0; column < 3; ++column)
+	{
+		const __m128 r0 = _mm_mul_ps(c0, _mm_set1_ps(m[column * 3][lane]));
+		const __m128 r1 = _mm_mul_ps(c1, _mm_set1_ps(m[column * 3 + 1][lane]));
+		const __m128 r2 = _mm_mul_ps(c2, _mm_set1_ps(m[column * 3 + 2][lane]));
+		_mm_store_ps(pWorld + column * 4, _mm_add_ps(_mm_add_ps(r0, r1), r2));
+	}
+	const __m128 t0 = _mm_mul_ps(c0, _mm_set1_ps(m[9][lane]));
+	const __m128 t1 = _mm_mul_ps(c1, _mm_set1_ps(m[10][lane]));
+	const __m128 t2 = _mm_mul_ps(c2, _mm_set1_ps(m[11][lane]));
+	_mm_store_ps(pWorld + 12, _mm_add_ps(_mm_add_ps(t0, t1), _mm_add_ps(t2, c3)));
+#else
+	for (uint32_t row = 0; row < 4; ++row)
+	{
+		for (uint32_t column = 0; column < 3; ++column)
+			pWorld[column * 4 + row] = pParent[row] * m[column * 3][lane] + pParent[4 + row] * m[column * 3 + 1][lane] +
+									   pParent[8 + row] * m[column * 3 + 2][lane];
+		pWorld[12 + row] = pParent[row] * m[9][lane] + pParent[4 + row] * m[10][lane] + pParent[8 + row] * m[11][lane] + pParent[12 + row];
+	}
+#endif
+}
+
+// A node is recomputed when its own local transform or its parent's world matrix changed. Parents are on the level
+// above, so their flag is final by the time a level runs.
+static inline uint32_t updateChangedFlag(TransformHierarchy* pHierarchy, uint32_t node)
+{
+	const uint32_t parent = pHierarchy->pParents[node];
+	const uint8_t  changed = pHierarchy->pDirty[node] | (parent == TRANSFORM_NO_PARENT ? 0 : pHierarchy->pChanged[parent]);
+	pHierarchy->pChanged[node] = changed;
+	pHierarchy->pDirty[node] = 0;
+	return changed;
+}
+
+static void updateNodes(TransformHierarchy* pHierarchy, uint32_t firstNode, uint32_t endNode)
+{
+	LocalMatrices4 local;
+	uint32_t       node = firstNode;
+#if VO_TRANSFORM_SSE
+	for (; node + 4 <= endNode; node += 4)
+	{
+		uint32_t changedMask = 0;
+		for (uint32_t lane = 0; lane < 4; ++lane)
+			changedMask |= updateChangedFlag(pHierarchy, node + lane) << lane;
+		if (!changedMask)
+			continue;
+
+		computeLocalMatrices4(pHierarchy, node, &local);
+		for (uint32_t lane = 0; lane < 4; ++lane)
+		{
+			if (changedMask & (1u << lane))
+				computeWorldMatrix(pHierarchy, node + lane, &local, lane);
+		}
+	}
+#endif
+	for (; node < endNode; ++node)
+	{
+		if (!updateChangedFlag(pHierarchy, node))
+			continue;
+		computeLocalMatrix(pHierarchy, node, &local, 0);
+		computeWorldMatrix(pHierarchy, node, &local, 0);
+	}
+}
+
+static void updateTransformTask(void* pUser, uint64_t index)
+{
+	const TransformTaskData* pData = (const TransformTaskData*)pUser;
+	const uint32_t           firstNode = pData->mFirstNode + (uint32_t)index * gNodesPerTask;
+	const uint32_t           endNode = firstNode + gNodesPerTask < pData->mEndNode ? firstNode + gNodesPerTask : pData->mEndNode;
+	const uint32_t           scope = frameTraceBeginCpuScope("Transform Task");
+	updateNodes(pData->pHierarchy, firstNode, endNode);
+	frameTraceEndCpuScope(scope);
+}
+
+void initTransformHierarchy(const TransformHierarchyDesc* pDesc, TransformHierarchy* pHierarchy)
+{
+	ASSERT(pDesc && pHierarchy);
+
+	const uint32_t count = pDesc->mNodeCount;
+	*pHierarchy = {};
+	pHierarchy->mNodeCount = count;
+	pHierarchy->mThreadSystem = pDesc->mThreadSystem;
+	pHierarchy->pSortedIndices = (uint32_t*)tf_malloc(count * sizeof(uint32_t));
+	pHierarchy->pNodeIds = (uint32_t*)tf_malloc(count * sizeof(uint32_t));
+	pHierarchy->pParents = (uint32_t*)tf_malloc(count * sizeof(uint32_t));
+
+	// Depth of every node; parents may come after their children in caller order, so unknown chains are walked up to
+	// the first known ancestor and assigned on the way back.
+	uint32_t* pDepths = (uint32_t*)tf_malloc(count * sizeof(uint32_t));
+	uint32_t* pChain = (uint32_t*)tf_malloc(count * sizeof(uint32_t));
+	memset(pDepths, 0xFF, count * sizeof(uint32_t));
+	uint32_t levelCount = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t chainLength = 0;
+		uint32_t node = i;
+		while (node != TRANSFORM_NO_PARENT && pDepths[node] == TRANSFORM_NO_PARENT)
+		{
+			ASSERT(chainLength < count && "Transform hierarchy has a cycle");
+			pChain[chainLength++] = node;
+			node = pDesc->pParents[node];
+		}
+		uint32_t depth = node == TRANSFORM_NO_PARENT ? 0 : pDepths[node] + 1;
+		while (chainLength)
+			pDepths[pChain[--chainLength]] = depth++;
+		levelCount = pDepths[i] + 1 > levelCount ? pDepths[i] + 1 : levelCount;
+	}
+
+	// Counting sort by depth, stable in caller order
+	pHierarchy->mLevelCount = levelCount;
+	pHierarchy->pLevelStarts = (uint32_t*)tf_calloc(levelCount + 1, sizeof(uint32_t));
+	for (uint32_t i = 0; i < count; ++i)
+		++pHierarchy->pLevelStarts[pDepths[i] + 1];
+	for (uint32_t level = 0; level < levelCount; ++level)
+		pHierarchy->pLevelStarts[level + 1] += pHierarchy->pLevelStarts[level];
+	memcpy(pChain, pHierarchy->pLevelStarts, levelCount * sizeof(uint32_t));
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		pHierarchy->pSortedIndices[i] = pChain[pDepths[i]]++;
+		pHierarchy->pNodeIds[pHierarchy->pSortedIndices[i]] = i;
+	}
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t parent = pDesc->pParents[i];
+		pHierarchy->pParents[pHierarchy->pSortedIndices[i]] = parent == TRANSFORM_NO_PARENT ? parent : pHierarchy->pSortedIndices[parent];
+	}
+	tf_free(pChain);
+	tf_free(pDepths);
+
+	float** ppComponents[] = { &pHierarchy->pPositionX, &pHierarchy->pPositionY, &pHierarchy->pPositionZ, &pHierarchy->pRotationX,
+							   &pHierarchy->pRotationY, &pHierarchy->pRotationZ, &pHierarchy->pRotationW, &pHierarchy->pScale };
+	for (uint32_t i = 0; i < sizeof(ppComponents) / sizeof(ppComponents[0]); ++i)
+		*ppComponents[i] = (float*)tf_calloc(count, sizeof(float));
+	pHierarchy->pWorldMatrices = (float*)tf_memalign(16, (size_t)count * 16 * sizeof(float));
+	pHierarchy->pDirty = (uint8_t*)tf_malloc(count);
+	pHierarchy->pChanged = (uint8_t*)tf_calloc(count, 1);
+	pHierarchy->pChangedNodes = (uint32_t*)tf_malloc(count * sizeof(uint32_t));
+	markTransformHierarchyDirty(pHierarchy);
+
+	// Identity locals
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		pHierarchy->pRotationW[i] = 1.0f;
+		pHierarchy->pScale[i] = 1.0f;
+		memcpy(pHierarchy->pWorldMatrices + (uint64_t)i * 16, gIdentityMatrix, sizeof(gIdentityMatrix));
+	}
+}
+
+void exitTransformHierarchy(TransformHierarchy* pHierarchy)
+{
+	tf_free(pHierarchy->pLevelStarts);
+	tf_free(pHierarchy->pSortedIndices);
+	tf_free(pHierarchy->pNodeIds);
+	tf_free(pHierarchy->pParents);
+	tf_free(pHierarchy->pPositionX);
+	tf_free(pHierarchy->pPositionY);
+	tf_free(pHierarchy->pPositionZ);
+	tf_free(pHierarchy->pRotationX);
+	tf_free(pHierarchy->pRotationY);
+	tf_free(pHierarchy->pRotationZ);
+	tf_free(pHierarchy->pRotationW);
+	tf_free(pHierarchy->pScale);
+	tf_free(pHierarchy->pWorldMatrices);
+	tf_free(pHierarchy->pDirty);
+	tf_free(pHierarchy->pChanged);
+	tf_free(pHierarchy->pChangedNodes);
+	*pHierarchy = {};
+}
+
+void setTransformLocal(TransformHierarchy* pHierarchy, uint32_t nodeId, const float* pPosition, const float* pRotation, float scale)
+{
+	const uint32_t node = pHierarchy->pSortedIndices[nodeId];
+	if (pHierarchy->pPositionX[node] == pPosition[0] && pHierarchy->pPositionY[node] == pPosition[1] &&
+		pHierarchy->pPositionZ[node] == pPosition[2] && pHierarchy->pRotationX[node] == pRotation[0] &&
+		pHierarchy->pRotationY[node] == pRotation[1] && pHierarchy->pRotationZ[node] == pRotation[2] &&
+		pHierarchy->pRotationW[node] == pRotation[3] && pHierarchy->pScale[node] == scale)
+		return;
+
+	pHierarchy->pDirty[node] = 1;
+	pHierarchy->pPositionX[node] = pPosition[0];
+	pHierarchy->pPositionY[node] = pPosition[1];
+	pHierarchy->pPositionZ[node] = pPosition[2];
+	pHierarchy->pRotationX[node] = pRotation[0];
+	pHierarchy->pRotationY[node] = pRotation[1];
+	pHierarchy->pRotationZ[node] = pRotation[2];
+	pHierarchy->pRotationW[node] = pRotation[3];
+	pHierarchy->pScale[node] = scale;
+}
+
+void markTransformHierarchyDirty(TransformHierarchy* pHierarchy) { memset(pHierarchy->pDirty, 1, pHierarchy->mNodeCount); }
+
+void updateTransformHierarchy(TransformHierarchy* pHierarchy)
+{
+	for (uint32_t level = 0; level < pHierarchy->mLevelCount; ++level)
+	{
+		TransformTaskData data = {};
+		data.pHierarchy = pHierarchy;
+		data.mFirstNode = pHierarchy->pLevelStarts[level];
+		data.mEndNode = pHierarchy->pLevelStarts[level + 1];
+		const uint32_t taskCount = (data.mEndNode - data.mFirstNode + gNodesPerTask - 1) / gNodesPerTask;
+
+		// Each level waits for the one above, its parents must be final
+		if (pHierarchy->mThreadSystem && taskCount > 1)
+		{
+			threadSystemAddTaskGroup(pHierarchy->mThreadSystem, updateTransformTask, taskCount, &data);
+			threadSystemWaitIdle(pHierarchy->mThreadSystem);
+		}
+		else
+		{
+			updateNodes(pHierarchy, data.mFirstNode, data.mEndNode);
+		}
+	}
+
+	// Change list, eight flags at a time so mostly static hierarchies scan quickly
+	const uint32_t count = pHierarchy->mNodeCount;
+	uint32_t       changedCount = 0;
+	uint32_t       node = 0;
+	for (; node + 8 <= count; node += 8)
+	{
+		uint64_t flags;
+		memcpy(&flags, pHierarchy->pChanged + node, sizeof(flags));
+		if (!flags)
+			continue;
+		for (uint32_t i = node; i < node + 8; ++i)
+		{
+			if (pHierarchy->pChanged[i])
+				pHierarchy->pChangedNodes[changedCount++] = pHierarchy->pNodeIds[i];
+		}
+	}
+	for (; node < count; ++node)
+	{
+		if (pHierarchy->pChanged[node])
+			pHierarchy->pChangedNodes[changedCount++] = pHierarchy->pNodeIds[node];
+	}
+	pHierarchy->mChangedCount = changedCount;
+}
+
+// Random forest in caller order: every 64th node on average is a root, the others hang off a random earlier node, which
+// gives a depth in the order of ln(count).
+static void initRandomTransforms(TransformHierarchy* pHierarchy, uint32_t* pParents, uint32_t count, ThreadSystem threadSystem)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t h = hashUint(0x2545F491u, i);
+		pParents[i] = (i == 0 || (h & 63) == 0) ? TRANSFORM_NO_PARENT : (h >> 6) % i;
+	}
+
+	TransformHierarchyDesc desc = {};
+	desc.mNodeCount = count;
+	desc.pParents = pParents;
+	desc.mThreadSystem = threadSystem;
+	initTransformHierarchy(&desc, pHierarchy);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		float value[8];
+		for (uint32_t c = 0; c < 8; ++c)
+			value[c] = float(hashUint(c, i) & 0xFFFF) / 32767.5f - 1.0f;
+		const float invLength = 1.0f / sqrtf(value[3] * value[3] + value[4] * value[4] + value[5] * value[5] + value[6] * value[6] + 1e-6f);
+		const float rotation[4] = { value[3] * invLength, value[4] * invLength, value[5] * invLength, value[6] * invLength };
+		setTransformLocal(pHierarchy, i, value, rotation, 1.0f + 0.1f * value[7]);
+	}
+}
+
+void benchmarkTransformHierarchy(ThreadSystem threadSystem)
+{
+	for (uint32_t count = 1000; count <= 1000000; count *= 10)
+	{
+		const uint32_t iterations = count < 100000 ? 100 : 10;
+		uint32_t*      pParents = (uint32_t*)tf_malloc(count * sizeof(uint32_t));
+
+		HiresTimer timer;
+		initHiresTimer(&timer);
+		TransformHierarchy hierarchy;
+		initRandomTransforms(&hierarchy, pParents, count, NULL);
+		const double initMs = getHiresTimerUSec(&timer, true) / 1000.0;
+
+		// First update touches every world matrix page once. Full updates flag every node first.
+		updateTransformHierarchy(&hierarchy);
+		getHiresTimerUSec(&timer, true);
+		for (uint32_t i = 0; i < iterations; ++i)
+		{
+			markTransformHierarchyDirty(&hierarchy);
+			updateTransformHierarchy(&hierarchy);
+		}
+		const double singleMs = getHiresTimerUSec(&timer, true) / 1000.0 / iterations;
+
+		hierarchy.mThreadSystem = threadSystem;
+		for (uint32_t i = 0; i < iterations; ++i)
+		{
+			markTransformHierarchyDirty(&hierarchy);
+			updateTransformHierarchy(&hierarchy);
+		}
+		const double pooledMs = getHiresTimerUSec(&timer, true) / 1000.0 / iterations;
+
+		LOGF(LogLevel::eINFO, "Transform hierarchy %8u nodes, %2u levels: init %8.2f ms, 1 thread %8.3f ms, pool %8.3f ms, %7.1f Mnodes/s",
+			 count, hierarchy.mLevelCount, initMs, singleMs, pooledMs, pooledMs > 0.0 ? count / (pooledMs * 1000.0) : 0.0);
+
+		// Incremental: a random share of the nodes gets a new position each frame. Recomputed counts include the descendants
+		// of moving nodes.
+		static const uint32_t movingPercents[] = { 1, 10, 100 };
+		for (uint32_t p = 0; p < sizeof(movingPercents) / sizeof(movingPercents[0]); ++p)
+		{
+			uint64_t recomputed = 0;
+			int64_t  setUSec = 0;
+			int64_t  updateUSec = 0;
+			for (uint32_t i = 0; i < iterations; ++i)
+			{
+				getHiresTimerUSec(&timer, true);
+				for (uint32_t id = 0; id < count; ++id)
+				{
+					if (hashUint(i, id) % 100 >= movingPercents[p])
+						continue;
+					const uint32_t node = hierarchy.pSortedIndices[id];
+					const float    position[3] = { hierarchy.pPositionX[node] + 0.001f, hierarchy.pPositionY[node], hierarchy.pPositionZ[node] };
+					const float    rotation[4] = { hierarchy.pRotationX[node], hierarchy.pRotationY[node], hierarchy.pRotationZ[node],
+												   hierarchy.pRotationW[node] };
+					setTransformLocal(&hierarchy, id, position, rotation, hierarchy.pScale[node]);
+				}
+				setUSec += getHiresTimerUSec(&timer, true);
+				updateTransformHierarchy(&hierarchy);
+				updateUSec += getHiresTimerUSec(&timer, true);
+				recomputed += hierarchy.mChangedCount;
+			}
+			LOGF(LogLevel::eINFO, "Transform hierarchy %8u nodes, %3u%% moving: set %8.3f ms, update %8.3f ms, %8llu recomputed (%5.1f%%)",
+				 count, movingPercents[p], setUSec / 1000.0 / iterations, updateUSec / 1000.0 / iterations,
+				 (unsigned long long)(recomputed / iterations), 100.0 * recomputed / iterations / count);
+		}
+
+		exitTransformHierarchy(&hierarchy);
+		tf_free(pParents);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-frame accounting of tf_malloc/tf_free calls made from files that include VoCommon/Public/TrackedMemory.h,
+// grouped by call site (file:line). Used to keep steady-state Update()/Draw() allocation free:
+// - frames whose allocation count or bytes exceed the budget are flagged in the stats,
+// - in guard mode (mFailOnAllocation) any allocation after warm-up logs the offending call sites and marks the run as
+//   failed; the app shuts down and exits with a non-zero code.
+//
+// Allocations made by The Forge libraries themselves don't go through the redirect and are not counted.
+//
+// Frame window: allocationTrackerBeginFrame() at the top of Update(), allocationTrackerEndFrame() at the end of Draw().
+// Allocations outside the window (Init/Load/Unload) are tracked for byte accounting only.
+
+struct AllocationTrackerSettings
+{
+	bool     mEnabled;          // per-frame accounting, can be toggled at runtime
+	bool     mFailOnAllocation; // guard/test mode
+	uint32_t mWarmupFrames;     // frames after init or reload before budget and guard apply
+	uint32_t mBudgetAllocCount; // per frame
+	uint32_t mBudgetBytes;      // per frame
+};
+
+struct AllocationSiteStats
+{
+	const char* pFile;
+	const char* pFunction;
+	uint32_t    mLine;
+	uint32_t    mAllocCount;
+	uint32_t    mFreeCount;
+	uint64_t    mAllocBytes;
+};
+
+struct AllocationFrameStats
+{
+	uint32_t mAllocCount;
+	uint32_t mFreeCount;
+	uint64_t mAllocBytes;
+	uint64_t mFreeBytes; // only for blocks whose size is known (allocated while the tracker was initialized)
+	uint32_t mOverBudgetFrames;
+	bool     mOverBudget;
+	bool     mWarm; // warm-up done, budget and guard active
+};
+
+void initAllocationTracker(const AllocationTrackerSettings* pSettings);
+// Returns false if the guard tripped during the run.
+bool exitAllocationTracker();
+
+// Live settings, widgets can bind to the fields directly.
+AllocationTrackerSettings* getAllocationTrackerSettings();
+
+void allocationTrackerBeginFrame();
+void allocationTrackerEndFrame();
+// Call from Load(): reloads reallocate legitimately, so warm-up starts over.
+void allocationTrackerRestartWarmup();
+
+// Stats of the last completed frame.
+const AllocationFrameStats* getAllocationFrameStats();
+// Totals and the busiest call sites of the last completed frame, for a DynamicTextWidget.
+const char* getAllocationTrackerSummary();
+bool        allocationTrackerFailed();
+
+// Redirect targets for TrackedMemory.h
+void* voTrackedMalloc(size_t size, const char* pFile, int line, const char* pFunction);
+void* voTrackedMemalign(size_t align, size_t size, const char* pFile, int line, const char* pFunction);
+void* voTrackedCalloc(size_t count, size_t size, const char* pFile, int line, const char* pFunction);
+void* voTrackedCallocMemalign(size_t count, size_t align, size_t size, const char* pFile, int line, const char* pFunction);
+void* voTrackedRealloc(void* ptr, size_t size, const char* pFile, int line, const char* pFunction);
+void  voTrackedFree(void* ptr, const char* pFile, int line, const char* pFunction);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+// Scenario driven benchmark runs with a regression check. A scenario file in RD_SCRIPTS holds "key = value" lines
+// ('#' starts a comment). The runner reads "frames" (measured frames, default 600), "warmup" (frames before that,
+// default 120) and "tolerance" (allowed relative increase over the baseline, default 0.1); every other key is up to
+// the app (getScenarioUint()).
+//
+// The app registers its metrics, then adds one sample per metric per frame while benchmarkScenarioMeasuring(). At the
+// end the averages go to RD_DEBUG as "<scenario>.results.csv" and are compared with "<scenario>.baseline.csv" from
+// RD_SCRIPTS, in the same format. Every metric is lower-is-better (times, invocation counts), so any average more than
+// the tolerance above its baseline is a regression, and a missing baseline fails the run too, so a check that never
+// ran can't pass. Baselines are per machine: to accept new numbers, copy the results over the baseline.
+
+#define BENCHMARK_MAX_SCENARIO_KEYS 32
+#define BENCHMARK_MAX_METRICS       16
+
+struct BenchmarkMetric
+{
+	char     mName[32];
+	double   mSum;
+	uint32_t mSampleCount; // metrics without samples (e.g. no pipeline statistics) are left out of results and checks
+};
+
+struct BenchmarkScenario
+{
+	char            mName[64]; // file name without extension
+	char            mKeys[BENCHMARK_MAX_SCENARIO_KEYS][32];
+	char            mValues[BENCHMARK_MAX_SCENARIO_KEYS][64];
+	uint32_t        mKeyCount;
+	uint32_t        mWarmupFrames;
+	uint32_t        mFrames;
+	double          mTolerance;
+	uint32_t        mFrame; // advanceBenchmarkScenario() calls so far, warm-up included
+	BenchmarkMetric mMetrics[BENCHMARK_MAX_METRICS];
+	uint32_t        mMetricCount;
+	bool            mActive; // loaded and not finished yet
+};
+
+// False (and logged) if the file can't be read.
+bool loadBenchmarkScenario(const char* pFileName, BenchmarkScenario* pScenario);
+
+uint32_t getScenarioUint(const BenchmarkScenario* pScenario, const char* pKey, uint32_t defaultValue);
+
+// Returns the metric index for addBenchmarkSample().
+uint32_t addBenchmarkMetric(BenchmarkScenario* pScenario, const char* pName);
+
+inline bool benchmarkScenarioMeasuring(const BenchmarkScenario* pScenario)
+{
+	return pScenario->mActive && pScenario->mFrame >= pScenario->mWarmupFrames;
+}
+
+inline void addBenchmarkSample(BenchmarkScenario* pScenario, uint32_t metric, double value)
+{
+	pScenario->mMetrics[metric].mSum += value;
+	++pScenario->mMetrics[metric].mSampleCount;
+}
+
+// Call once per frame after adding that frame's samples. Returns true once all frames ran.
+bool advanceBenchmarkScenario(BenchmarkScenario* pScenario);
+
+// Writes the results, checks them against the baseline and logs both. Returns false on a regression, and when there is
+// no baseline to check against (the results are still written, ready to be promoted).
+bool finishBenchmarkScenario(BenchmarkScenario* pScenario);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// True if pFlag (e.g. "--alloc-guard") was passed on the command line. Call with IApp::argc/IApp::argv.
+inline bool hasCommandLineFlag(int argc, const char** argv, const char* pFlag)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i] && strcmp(argv[i], pFlag) == 0)
+			return true;
+	}
+	return false;
+}
+
+// Number following pFlag (e.g. "--asteroids 200000"), defaultValue if the flag is missing or not followed by a number.
+inline uint32_t getCommandLineUint(int argc, const char** argv, const char* pFlag, uint32_t defaultValue)
+{
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (!argv[i] || !argv[i + 1] || strcmp(argv[i], pFlag) != 0)
+			continue;
+		char*               pEnd = NULL;
+		const unsigned long value = strtoul(argv[i + 1], &pEnd, 10);
+		if (pEnd != argv[i + 1] && *pEnd == '\0')
+			return (uint32_t)value;
+	}
+	return defaultValue;
+}
+
+// Argument following pFlag (e.g. "--scenario Asteroids.scenario"), NULL if the flag is missing or last.
+inline const char* getCommandLineString(int argc, const char** argv, const char* pFlag)
+{
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (argv[i] && strcmp(argv[i], pFlag) == 0)
+			return argv[i + 1];
+	}
+	return NULL;
+}
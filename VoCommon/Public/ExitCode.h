@@ -0,0 +1,24 @@
+#pragma once
+
+// Process exit code for failures found while the app shuts down (allocation guard, scenario regression check).
+// IApp::Exit() must not call exit() itself, that skips the rest of The Forge teardown and the log flush. Instead the
+// code is returned from main() once the platform main has run Exit() and torn The Forge down.
+//
+// Keeps the first non-zero code, 0 is ignored.
+void setShutdownExitCode(int exitCode);
+int  getShutdownExitCode();
+
+// Exit code of the process: the platform main's own failure code if it has one, the shutdown exit code otherwise.
+int applyShutdownExitCode(int platformExitCode);
+
+// DEFINE_APPLICATION_MAIN defines main() on these platforms, so the app can rename it and wrap it:
+//
+//     #define main platformMain
+//     DEFINE_APPLICATION_MAIN(App)
+//     #undef main
+//     int main(int argc, char** argv) { return applyShutdownExitCode(platformMain(argc, argv)); }
+//
+// Elsewhere the platform layer owns the entry point and the shutdown exit code is not applied.
+#if defined(_WIN32) || (defined(__linux__) && !defined(__ANDROID__))
+#define VO_WRAP_APPLICATION_MAIN
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+// Frame time distributions and hitch detection. Frame pacing targets are written as p99/p99.9 frame times and hitch
+// counts, which averages hide, so every metric keeps a log-scale histogram (1% wide bins from 0.01 ms to 1 s, so a
+// percentile is off by at most 1%) over a rolling window of recent frames for the UI, and one over the whole run for
+// the CSV summary written at exit.
+//
+// A frame whose CPU or GPU time exceeds the hitch threshold is a hitch. A CPU hitch is logged with the main thread scope
+// breakdown of that frame from FrameTrace, so frameTimeStatsEndFrame() has to run before the next
+// frameTraceBeginFrame(). A GPU-only hitch isn't: the GPU frame time is frames behind and the breakdown isn't its own.
+// Frames before warm-up are not recorded at all (loading, first PSO compiles).
+//
+// No allocations: everything is fixed-size global storage.
+
+#define FRAME_TIME_MAX_WINDOW_FRAMES 4096
+
+enum FrameTimeMetric
+{
+	FRAME_TIME_CPU_FRAME,  // main thread, end of one Draw() to the end of the next; measured here
+	FRAME_TIME_GPU_FRAME,  // the GPU profiler's frame time
+	FRAME_TIME_FENCE_WAIT, // CPU blocked on the frame slot's fence
+	FRAME_TIME_PRESENT,    // CPU time in queuePresent()
+	FRAME_TIME_METRIC_COUNT
+};
+
+struct FrameTimeStatsSettings
+{
+	float    mHitchThresholdMs; // can be changed at runtime, widgets can bind to it
+	uint32_t mWarmupFrames;     // frames after init or reload before anything is recorded
+	uint32_t mWindowFrames;     // rolling window for the UI, read at init; 0 or above FRAME_TIME_MAX_WINDOW_FRAMES is the max
+};
+
+void initFrameTimeStats(const FrameTimeStatsSettings* pSettings);
+// Writes the whole-run summary of every metric to pCsvFileName in RD_DEBUG, nullptr skips it.
+void exitFrameTimeStats(const char* pCsvFileName);
+
+// Live settings, widgets can bind to the fields directly.
+FrameTimeStatsSettings* getFrameTimeStatsSettings();
+
+// Sample for the frame in progress. Metrics without a sample in a frame are skipped for it (no GPU timing support, say).
+void addFrameTimeSample(FrameTimeMetric metric, double ms);
+// End of Draw(), after present: records the frame's samples and checks for a hitch.
+void frameTimeStatsEndFrame();
+// Call from Load(): reloads stall legitimately, so warm-up starts over. The recorded history is kept.
+void frameTimeStatsRestartWarmup();
+
+// Sample of the last completed frame, warm-up included; 0 if that frame had none.
+double getLastFrameTimeMs(FrameTimeMetric metric);
+// Rolling window percentiles of every metric and the hitch count, for a DynamicTextWidget.
+const char* getFrameTimeStatsSummary();
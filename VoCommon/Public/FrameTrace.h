@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+struct Renderer;
+struct Queue;
+struct Cmd;
+
+// Continuous frame trace for a chosen window of frames, written as Chrome trace JSON to RD_DEBUG (chrome://tracing or
+// ui.perfetto.dev). CPU scopes can come from any thread; GPU ranges are timestamp queries on the command buffer, read
+// back once their frame slot is reused, so nothing waits on the GPU. Everything sits on the CPU clock in microseconds
+// since initFrameTrace().
+//
+// The GPU clock has no fixed relation to the CPU clock, so it is aligned per capture: a frame's first GPU range can't
+// start before the CPU submitted it, and the tightest such bound over the captured frames is taken as the offset. Any
+// frame that reached an idle GPU makes it exact; otherwise GPU work shows up slightly early, never before its submit.
+//
+// Main thread scopes are also timed outside captures, summed per name over the current frame, as the breakdown hitch
+// reports attribute a slow frame with. Other calls return right away outside a capture. Storage is allocated in
+// initFrameTrace(), nothing allocates per frame.
+
+#define FRAME_TRACE_MAX_GPU_RANGES   16
+#define FRAME_TRACE_MAX_FRAME_SCOPES 32
+#define FRAME_TRACE_NO_SCOPE         0xFFFFFFFFu
+
+// Main thread time of one scope name in the current frame
+struct FrameTraceScopeTime
+{
+	const char* pName;
+	double      mMs;
+	uint32_t    mCount; // completed scopes with this name
+	uint32_t    mDepth; // nesting depth of the first one
+};
+
+// gpuFrameCount is the number of frame slots (command buffers) in flight. GPU ranges are left out without timestamp
+// query support.
+void initFrameTrace(Renderer* pRenderer, Queue* pQueue, uint32_t gpuFrameCount);
+void exitFrameTrace();
+
+// Records frameCount frames from the next frameTraceBeginFrame() on; pFileName is written a few frames after the last
+// one, when its GPU ranges are in. Ignored while a capture is running.
+void requestFrameTraceCapture(uint32_t frameCount, const char* pFileName);
+bool isFrameTraceCapturing();
+
+// Top of Update(), on the main thread: closes the previous frame and opens the next one.
+void frameTraceBeginFrame();
+
+// Any thread. pName must stay valid until the capture is written (string literals). Scopes on one thread must nest.
+uint32_t frameTraceBeginCpuScope(const char* pName);
+void     frameTraceEndCpuScope(uint32_t scope);
+
+// Main thread breakdown of the current frame (since frameTraceBeginFrame()), in first-begin order. Names beyond
+// FRAME_TRACE_MAX_FRAME_SCOPES are left out.
+const FrameTraceScopeTime* getFrameTraceScopeTimes(uint32_t* pCount);
+// Summed main thread time of pName in the current frame, 0 if it didn't run.
+double getFrameTraceScopeMs(const char* pName);
+
+// On the thread recording pCmd, after the fence of frame slot frameIndex was waited on: reads back that slot's
+// previous ranges and starts recording this frame's.
+void frameTraceBeginGpuFrame(Cmd* pCmd, uint32_t frameIndex);
+// Ranges nest, at most FRAME_TRACE_MAX_GPU_RANGES per frame. Same lifetime rule for pName as CPU scopes.
+void frameTraceBeginGpuRange(Cmd* pCmd, const char* pName);
+void frameTraceEndGpuRange(Cmd* pCmd);
+// Right before endCmd(); the submit time that follows is what the GPU clock is aligned against.
+void frameTraceEndGpuFrame(Cmd* pCmd);
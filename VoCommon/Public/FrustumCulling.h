@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+// Bounding sphere frustum culling. Spheres are SoA (center x, y, z and radius arrays) so the plane tests run on four
+// spheres at a time with SSE; the indices of the visible ones are compacted into an output list.
+
+struct FrustumPlanes
+{
+	// Normalized, pointing inward: dot(xyz, p) + w >= 0 inside. Left, right, bottom, top, near, far.
+	float mPlanes[6][4];
+};
+
+// pViewProjection is 16 floats, column-major, clip = M * p, with clip depth in [0, w] (either depth direction, so
+// reverse Z projections work too).
+void extractFrustumPlanes(const float* pViewProjection, FrustumPlanes* pFrustum);
+
+// Writes the indices of the spheres intersecting the frustum to pVisible (room for count entries) in ascending order and
+// returns how many there are. The test is conservative near frustum corners, as usual for plane tests.
+uint32_t cullSpheres(const FrustumPlanes* pFrustum, const float* pCenterX, const float* pCenterY, const float* pCenterZ,
+					 const float* pRadius, uint32_t count, uint32_t* pVisible);
+
+// Logs scalar and SSE culling time of 1K to 1M random spheres.
+void benchmarkFrustumCulling();
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+// Index and vertex reordering for triangle lists, run once on the CPU before upload:
+// - optimizeVertexCache: Tipsify (Sander, Nehab, Barczak 2007), linear time post-transform cache reordering
+// - optimizeOverdraw: sorts clusters of the cache optimized order so outward facing parts of the mesh draw first
+// - optimizeVertexFetch*: renumbers vertices in first use order so the vertex fetch walks memory linearly
+// Run them in that order; the first two only move triangles, the last one changes vertex ids.
+
+// Cache size used for the reordering and the statistics, close to what current GPUs reuse per wave.
+#define VERTEX_CACHE_SIZE 16
+
+// FIFO post-transform cache simulation of a triangle list.
+struct VertexCacheStats
+{
+	uint32_t mVerticesTransformed; // cache misses, what the VS invocation counter should show per draw
+	float    mAcmr;                // transformed vertices per triangle, 3 is the worst case, ~0.5 the limit on a grid
+	float    mAtvr;                // transformed vertices per referenced vertex, 1 is ideal
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize);
+
+// pDstIndices and pIndices must not overlap.
+void optimizeVertexCache(uint32_t* pDstIndices, const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize);
+
+// Splits the cache optimized pIndices into clusters, at cache flushes and wherever starting over keeps the cluster ACMR
+// within threshold (e.g. 1.05) of the unsplit one, and sorts them by how far they face away from the mesh center.
+// pPositions points at the float3 position of vertex 0, positionStride bytes apart.
+void optimizeOverdraw(uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount,
+					  uint32_t cacheSize, float threshold);
+
+// Rewrites pIndices to first use order and fills pRemap[oldVertex] = newVertex, unreferenced vertices go last.
+// The remap only depends on the indices, so several vertex streams of the same mesh can share it.
+void optimizeVertexFetchRemap(uint32_t* pRemap, uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount);
+// pDst and pSrc must not overlap.
+void remapVertexBuffer(void* pDst, const void* pSrc, uint32_t vertexCount, uint32_t stride, const uint32_t* pRemap);
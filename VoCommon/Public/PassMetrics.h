@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+struct Renderer;
+struct Queue;
+struct Cmd;
+
+// GPU time and pipeline statistics per named pass. Each frame slot (command buffer in flight) has its own query pools;
+// a slot's results are read back when the slot is reused, after its fence was waited on, so nothing stalls and the
+// numbers are gpuFrameCount frames old. Every read back updates the pass's last-frame values and its running
+// aggregates (average, min and max GPU time, average statistics) since the last resetPassMetrics().
+//
+// Timestamps nest freely, pipeline statistics don't (only one such query can be active at a time), so passes that
+// collect statistics must not overlap each other. A pass has to begin and end on the same side of a render pass
+// boundary: both inside the same bound render targets, or both outside. Anything the GPU can't query is simply left at
+// zero.
+
+#define PASS_METRICS_MAX_PASSES 16
+#define PASS_METRICS_NO_PASS    0xFFFFFFFFu
+
+enum PassMetricsFlags
+{
+	PASS_METRICS_TIMESTAMPS = 0x1,
+	PASS_METRICS_PIPELINE_STATS = 0x2,
+	PASS_METRICS_ALL = PASS_METRICS_TIMESTAMPS | PASS_METRICS_PIPELINE_STATS,
+};
+
+struct PassPipelineStats
+{
+	uint64_t mIAVertices;
+	uint64_t mIAPrimitives;
+	uint64_t mVSInvocations;
+	uint64_t mCInvocations; // clipper
+	uint64_t mCPrimitives;
+	uint64_t mPSInvocations;
+	uint64_t mCSInvocations;
+};
+
+struct PassMetrics
+{
+	const char* pName;
+	uint32_t    mFlags; // the requested ones the GPU supports
+
+	// Last read back frame that recorded the pass
+	bool              mUpdated; // by the latest passMetricsBeginFrame()
+	double            mGpuMs;
+	PassPipelineStats mStats;
+
+	// Since the last resetPassMetrics()
+	uint32_t          mFrameCount;
+	double            mGpuMsSum;
+	double            mGpuMsMin;
+	double            mGpuMsMax;
+	PassPipelineStats mStatsSum;
+};
+
+// gpuFrameCount is the number of frame slots (command buffers) in flight.
+void initPassMetrics(Renderer* pRenderer, Queue* pQueue, uint32_t gpuFrameCount);
+void exitPassMetrics();
+
+// After initPassMetrics(), pName must stay valid (string literals). Returns PASS_METRICS_NO_PASS when full.
+uint32_t addMetricsPass(const char* pName, uint32_t flags);
+
+// On the thread recording pCmd, after the fence of frame slot frameIndex was waited on: reads back that slot's
+// previous passes and resets its queries for this frame.
+void passMetricsBeginFrame(Cmd* pCmd, uint32_t frameIndex);
+// At most once per pass and frame. PASS_METRICS_NO_PASS is ignored.
+void passMetricsBeginPass(Cmd* pCmd, uint32_t pass);
+void passMetricsEndPass(Cmd* pCmd, uint32_t pass);
+// Right before endCmd().
+void passMetricsEndFrame(Cmd* pCmd);
+
+// Aggregates start over (after a reload or settings change that moves the numbers). Last-frame values are kept.
+void resetPassMetrics();
+
+const PassMetrics* getPassMetrics(uint32_t pass);
+
+inline double getPassMetricsAverageGpuMs(const PassMetrics* pMetrics)
+{
+	return pMetrics->mFrameCount ? pMetrics->mGpuMsSum / pMetrics->mFrameCount : 0.0;
+}
+
+// Every pass with its last and aggregated numbers, for a DynamicTextWidget.
+const char* getPassMetricsSummary();
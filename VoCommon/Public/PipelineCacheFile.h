@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+struct Renderer;
+struct PipelineCache;
+
+// Pipeline cache kept in RD_PIPELINE_CACHE between runs: loaded in Init(), passed as PipelineDesc::pCache to every
+// addPipeline() and saved in Exit(), so only the first launch (and pipelines that changed since) pays for full
+// pipeline compilation. Each batch of pipeline creation is timed and logged as cold or warm.
+
+struct PipelineCacheFile
+{
+	PipelineCache* pCache; // NULL when disabled, fine to pass to addPipeline() either way
+	char           mFileName[64];
+	bool           mLoadedFromDisk;
+	uint32_t       mBatchCount; // logPipelineCreation() calls so far
+};
+
+// Loads pFileName, or starts an empty cache when there is none yet. With enabled false no cache is used or written,
+// every batch is cold (e.g. "--no-pipeline-cache" to measure the difference).
+void loadPipelineCacheFile(Renderer* pRenderer, const char* pFileName, bool enabled, PipelineCacheFile* pFile);
+
+// Writes the cache back to disk and frees it.
+void savePipelineCacheFile(Renderer* pRenderer, PipelineCacheFile* pFile);
+
+// Logs how long a batch of addPipeline() calls took. A batch is warm when the cache came from disk or an earlier batch
+// of this run filled it (e.g. a resize or shader reload), cold otherwise.
+void logPipelineCreation(PipelineCacheFile* pFile, const char* pName, uint64_t microseconds);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Resources/ResourceLoader/Interfaces/IResourceLoader.h"
+
+// Wall time of the startup phases of an app, from the top of Init() to the end of the first Load(). Phases are nested
+// begin/end scopes on the main thread; resource loads, which complete on the resource loader thread, are recorded from
+// the addResource() call to their completion. The summary (slowest first) goes to the log, the events to a Chrome
+// trace JSON in RD_DEBUG (chrome://tracing or ui.perfetto.dev).
+//
+// Storage is static, nothing here allocates. Once finished every call is a no-op, so reloads don't need to care.
+
+// Starts the clock, call first thing in Init().
+void initStartupTrace();
+
+// pName is copied. Scopes nest up to 8 deep.
+void startupTraceBegin(const char* pName);
+void startupTraceEnd();
+
+// Call right after addResource(..., &token) with the token of that load only.
+void startupTraceAddLoad(const char* pName, const SyncToken* pToken);
+
+// Replaces waitForAllResourceLoads(): polls the recorded loads until all are done, so each one ends when its token is
+// first seen completed whatever the order they finish in, then waits for everything else.
+void startupTraceWaitForLoads();
+
+// Logs the summary and writes pFileName to RD_DEBUG, call at the end of the first Load().
+void finishStartupTrace(const char* pFileName);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Resources/ResourceLoader/Interfaces/IResourceLoader.h"
+#include "Utilities/Interfaces/ITime.h"
+
+// Textures loaded from disk without ever blocking a frame. A request returns at once and a 1x1 placeholder stands in
+// for the texture while the resource loader thread reads and uploads the file; updateTextureStreamer(), once per frame,
+// notices completed loads and logs their latency. Descriptor sets referencing streamed textures are patched by the app
+// whenever mVersion changes, one frame copy at a time once the GPU is done with it.
+
+#define TEXTURE_STREAMER_MAX_TEXTURES 16
+
+struct StreamedTexture
+{
+	char      mFileName[64];
+	Texture*  pTexture; // written by the loader thread, only valid once mLoaded is set (NULL if the load failed)
+	SyncToken mToken;
+	uint64_t  mRequestUSec;
+	uint32_t  mRequestFrame;
+	bool      mLoaded;
+};
+
+struct TextureStreamer
+{
+	HiresTimer      mTimer;
+	Texture*        pPlaceholder;
+	StreamedTexture mTextures[TEXTURE_STREAMER_MAX_TEXTURES];
+	uint32_t        mTextureCount;
+	uint32_t        mPendingCount;
+	uint32_t        mFrame;   // updateTextureStreamer() calls so far
+	uint32_t        mVersion; // bumped whenever a texture becomes usable
+};
+
+// pPlaceholderColor is 4 bytes, RGBA8 sRGB. The placeholder upload is queued like any other resource, the app's usual
+// waitForAllResourceLoads() in Init() covers it.
+void initTextureStreamer(TextureStreamer* pStreamer, const uint8_t* pPlaceholderColor);
+
+// Waits for loads still in flight, then removes every texture and the placeholder.
+void exitTextureStreamer(TextureStreamer* pStreamer);
+
+// Starts loading pFileName and returns its index for getStreamedTexture(). Issue requests after the last
+// waitForAllResourceLoads() before the first frame, or that wait covers them and nothing is gained.
+uint32_t requestStreamedTexture(TextureStreamer* pStreamer, const char* pFileName, TextureCreationFlags flags);
+
+// The texture once loaded, the placeholder until then (or forever, if the load failed or was never requested).
+inline Texture* getStreamedTexture(const TextureStreamer* pStreamer, uint32_t index)
+{
+	if (index >= pStreamer->mTextureCount)
+		return pStreamer->pPlaceholder;
+	const StreamedTexture* pTexture = &pStreamer->mTextures[index];
+	return pTexture->mLoaded && pTexture->pTexture ? pTexture->pTexture : pStreamer->pPlaceholder;
+}
+
+// Call once per frame. Returns true when a load completed, i.e. mVersion changed.
+bool updateTextureStreamer(TextureStreamer* pStreamer);
@@ -0,0 +1,31 @@
+#pragma once
+
+// Drop-in for Utilities/Interfaces/IMemory.h: same rule, must be the last include in a cpp file.
+// Routes the tf_* allocation macros of the including file through the allocation tracker so every call site is
+// attributed. Define VO_ALLOCATION_TRACKING to 0 to compile the redirect out.
+
+#include "Utilities/Interfaces/IMemory.h"
+
+#ifndef VO_ALLOCATION_TRACKING
+#define VO_ALLOCATION_TRACKING 1
+#endif
+
+#if VO_ALLOCATION_TRACKING
+
+#include "VoCommon/Public/AllocationTracker.h"
+
+#undef tf_malloc
+#undef tf_memalign
+#undef tf_calloc
+#undef tf_calloc_memalign
+#undef tf_realloc
+#undef tf_free
+
+#define tf_malloc(size)                        voTrackedMalloc(size, __FILE__, __LINE__, __FUNCTION__)
+#define tf_memalign(align, size)               voTrackedMemalign(align, size, __FILE__, __LINE__, __FUNCTION__)
+#define tf_calloc(count, size)                 voTrackedCalloc(count, size, __FILE__, __LINE__, __FUNCTION__)
+#define tf_calloc_memalign(count, align, size) voTrackedCallocMemalign(count, align, size, __FILE__, __LINE__, __FUNCTION__)
+#define tf_realloc(ptr, size)                  voTrackedRealloc(ptr, size, __FILE__, __LINE__, __FUNCTION__)
+#define tf_free(ptr)                           voTrackedFree(ptr, __FILE__, __LINE__, __FUNCTION__)
+
+#endif
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Utilities/Threading/ThreadSystem.h"
+
+// Flat transform hierarchy for large node counts. Nodes are sorted by depth at init, so every parent comes before its
+// children and each level is a contiguous range whose nodes only read the level above. Local transforms are compact
+// TRS (position, rotation quaternion, uniform scale) in SoA arrays; world matrices are computed level by level, four
+// nodes at a time with SSE, each level split into tasks on the thread system.
+//
+// Callers keep their own node ids; pSortedIndices maps them to the internal (sorted) index used by every array.
+//
+// Updates are incremental: setTransformLocal() only flags a node when its values change, a flagged node recomputes its
+// subtree and nothing else is touched. The caller node ids of every recomputed world matrix are collected in
+// pChangedNodes, so uploads can be limited to what moved.
+
+#define TRANSFORM_NO_PARENT 0xFFFFFFFFu
+
+struct TransformHierarchyDesc
+{
+	uint32_t        mNodeCount;
+	const uint32_t* pParents;     // per caller node id, TRANSFORM_NO_PARENT for roots; must form a forest
+	ThreadSystem    mThreadSystem; // NULL updates on the calling thread
+};
+
+struct TransformHierarchy
+{
+	uint32_t mNodeCount;
+	uint32_t mLevelCount;
+	uint32_t* pLevelStarts;   // mLevelCount + 1 entries, level l is [pLevelStarts[l], pLevelStarts[l + 1])
+	uint32_t* pSortedIndices; // caller node id -> sorted index
+	uint32_t* pNodeIds;       // sorted index -> caller node id
+	uint32_t* pParents;       // sorted index of the parent, TRANSFORM_NO_PARENT for roots
+
+	// Local TRS, sorted index order
+	float* pPositionX;
+	float* pPositionY;
+	float* pPositionZ;
+	float* pRotationX;
+	float* pRotationY;
+	float* pRotationZ;
+	float* pRotationW;
+	float* pScale;
+
+	// 16 floats per node, column-major, 16-byte aligned
+	float* pWorldMatrices;
+
+	uint8_t*  pDirty;        // local transform changed since the last update
+	uint8_t*  pChanged;      // world matrix recomputed by the last update
+	uint32_t* pChangedNodes; // caller node ids of the pChanged nodes, in sorted order
+	uint32_t  mChangedCount;
+
+	ThreadSystem mThreadSystem;
+};
+
+void initTransformHierarchy(const TransformHierarchyDesc* pDesc, TransformHierarchy* pHierarchy);
+void exitTransformHierarchy(TransformHierarchy* pHierarchy);
+
+// pPosition is a float3 and pRotation a unit quaternion (x, y, z, w). Flags the node only if a value differs.
+void setTransformLocal(TransformHierarchy* pHierarchy, uint32_t nodeId, const float* pPosition, const float* pRotation, float scale);
+
+inline const float* getTransformWorldMatrix(const TransformHierarchy* pHierarchy, uint32_t nodeId)
+{
+	return pHierarchy->pWorldMatrices + (uint64_t)pHierarchy->pSortedIndices[nodeId] * 16;
+}
+
+// Flags every node, the next update recomputes the whole hierarchy.
+void markTransformHierarchyDirty(TransformHierarchy* pHierarchy);
+
+// Recomputes the world matrices of flagged nodes and their descendants, and fills the change list.
+void updateTransformHierarchy(TransformHierarchy* pHierarchy);
+
+// Logs init and full update time of random forests of 1K to 1M nodes, on the calling thread and on threadSystem, then
+// the incremental update cost with 1%, 10% and 100% of the nodes moving.
+void benchmarkTransformHierarchy(ThreadSystem threadSystem);
@@ -0,0 +1,449 @@
+#include "Public/PlanetMesh.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define VO_PLANET_MESH_SSE 1
+#else
+#define VO_PLANET_MESH_SSE 0
+#endif
+
+#include "Utilities/Interfaces/ILog.h"
+#include "Utilities/Interfaces/ITime.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+// A face vertex at grid (x, y) sits at mAxisX * fx + mAxisY * fy + mNormal with fx, fy in [-1, 1].
+struct PlanetFace
+{
+	float mAxisX[3];
+	float mAxisY[3];
+	float mNormal[3];
+};
+
+static const PlanetFace gPlanetFaces[6] = {
+	{ { 0, 1, 0 }, { 0, 0, 1 }, { -1, 0, 0 } },  // -x
+	{ { 0, -1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },  // +x
+	{ { -1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },  // +z
+	{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, -1 } },  // -z
+	{ { 1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },   // +y
+	{ { -1, 0, 0 }, { 0, 0, 1 }, { 0, -1, 0 } }, // -y
+};
+
+// Vertex rows handled by a single task
+static const uint32_t gRowsPerTask = 16;
+
+struct PlanetTaskData
+{
+	const PlanetMeshDesc* pDesc;
+	uint32_t              mFirstRow;
+	uint32_t              mEndRow;
+};
+
+static inline uint32_t hashUint(uint32_t seed, uint32_t value)
+{
+	uint32_t h = seed ^ (value * 0x9E3779B9u);
+	h ^= h >> 16;
+	h *= 0x7FEB352Du;
+	h ^= h >> 15;
+	h *= 0x846CA68Bu;
+	h ^= h >> 16;
+	return h;
+}
+
+// Scales the three low bytes of rgb by ratio / 255, alpha stays 0.
+static inline uint32_t scaleColor(uint32_t rgb, uint32_t ratio)
+{
+	const uint32_t r = ((rgb & 0xFF) * ratio) / 255;
+	const uint32_t g = (((rgb >> 8) & 0xFF) * ratio) / 255;
+	const uint32_t b = (((rgb >> 16) & 0xFF) * ratio) / 255;
+	return r | (g << 8) | (b << 16);
+}
+
+// Round to nearest even. Inputs are finite and small (|v| <= sqrt(3)), so there is no NaN handling.
+static inline uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const int32_t  exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t       mantissa = bits & 0x7FFFFF;
+
+	if (exponent >= 31)
+		return (uint16_t)(sign | 0x7C00);
+	if (exponent <= 0)
+	{
+		// Subnormal half
+		if (exponent < -10)
+			return (uint16_t)sign;
+		mantissa |= 0x800000;
+		const uint32_t shift = (uint32_t)(14 - exponent);
+		const uint32_t rest = mantissa & ((1u << shift) - 1);
+		const uint32_t halfway = 1u << (shift - 1);
+		uint32_t       half = mantissa >> shift;
+		half += (rest > halfway || (rest == halfway && (half & 1))) ? 1 : 0;
+		return (uint16_t)(sign | half);
+	}
+
+	uint32_t       half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+	const uint32_t rest = mantissa & 0x1FFF;
+	// A carry out of the mantissa correctly bumps the exponent
+	half += (rest > 0x1000 || (rest == 0x1000 && (half & 1))) ? 1 : 0;
+	return (uint16_t)(sign | half);
+}
+
+static inline int16_t floatToSnorm16(float value)
+{
+	value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+	return (int16_t)lrintf(value * 32767.0f);
+}
+
+// Octahedral map of a unit vector, decoded by decodeOctahedral() in Basic.vert.fsl.
+static inline uint32_t encodeOctahedral(const float* pVector)
+{
+	const float invL1 = 1.0f / (fabsf(pVector[0]) + fabsf(pVector[1]) + fabsf(pVector[2]));
+	float       x = pVector[0] * invL1;
+	float       y = pVector[1] * invL1;
+	if (pVector[2] < 0.0f)
+	{
+		const float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		const float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+	return (uint32_t)(uint16_t)floatToSnorm16(x) | ((uint32_t)(uint16_t)floatToSnorm16(y) << 16);
+}
+
+// Oblate key frame of a sphere vertex: y scaled by PLANET_OBLATE_Y_SCALE, the normal by its inverse.
+static inline void getOblateVectors(const float* pSphereNormal, float* pPosition, float* pNormal)
+{
+	pPosition[0] = pSphereNormal[0];
+	pPosition[1] = pSphereNormal[1] * PLANET_OBLATE_Y_SCALE;
+	pPosition[2] = pSphereNormal[2];
+
+	const float normalY = pSphereNormal[1] * (1.0f / PLANET_OBLATE_Y_SCALE);
+	const float invLength = 1.0f / sqrtf(pSphereNormal[0] * pSphereNormal[0] + normalY * normalY + pSphereNormal[2] * pSphereNormal[2]);
+	pNormal[0] = pSphereNormal[0] * invLength;
+	pNormal[1] = normalY * invLength;
+	pNormal[2] = pSphereNormal[2] * invLength;
+}
+
+static inline uint8_t* getAttributeData(uint8_t* const* ppRows, const PlanetVertexFormat& format, uint32_t attribute, uint32_t vertex)
+{
+	const PlanetAttributeFormat& attributeFormat = format.mAttributes[attribute];
+	return ppRows[attributeFormat.mStream] + (uint64_t)vertex * format.mStrides[attributeFormat.mStream] + attributeFormat.mOffset;
+}
+
+// pBase is the cube key frame vector PLANET_ENCODING_DELTA4 is relative to.
+static inline void writeVector(uint8_t* const* ppRows, const PlanetVertexFormat& format, uint32_t attribute, uint32_t vertex,
+							   const float* pVector, const float* pBase)
+{
+	switch (format.mAttributes[attribute].mEncoding)
+	{
+	case PLANET_ENCODING_FLOAT3:
+		memcpy(getAttributeData(ppRows, format, attribute, vertex), pVector, sizeof(float) * 3);
+		break;
+	case PLANET_ENCODING_HALF4:
+	{
+		const uint16_t half[4] = { floatToHalf(pVector[0]), floatToHalf(pVector[1]), floatToHalf(pVector[2]), 0x3C00 };
+		memcpy(getAttributeData(ppRows, format, attribute, vertex), half, sizeof(half));
+		break;
+	}
+	case PLANET_ENCODING_OCTAHEDRAL:
+	{
+		const uint32_t packed = encodeOctahedral(pVector);
+		memcpy(getAttributeData(ppRows, format, attribute, vertex), &packed, sizeof(packed));
+		break;
+	}
+	case PLANET_ENCODING_DELTA4:
+	{
+		const float   scale = format.mAttributes[attribute].mDeltaScale;
+		const float   invScale = scale > 0.0f ? 1.0f / scale : 0.0f;
+		const int16_t delta[4] = { floatToSnorm16((pVector[0] - pBase[0]) * invScale), floatToSnorm16((pVector[1] - pBase[1]) * invScale),
+								   floatToSnorm16((pVector[2] - pBase[2]) * invScale), 0 };
+		memcpy(getAttributeData(ppRows, format, attribute, vertex), delta, sizeof(delta));
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static inline void writeColor(uint8_t* const* ppRows, const PlanetVertexFormat& format, uint32_t attribute, uint32_t vertex, uint32_t color)
+{
+	if (format.mAttributes[attribute].mEncoding == PLANET_ENCODING_RGBA8)
+		memcpy(getAttributeData(ppRows, format, attribute, vertex), &color, sizeof(color));
+}
+
+// ppRows holds the data of the current row in each stream.
+static inline void writeVertex(uint8_t* const* ppRows, uint32_t vertex, const PlanetVertexFormat& format, const float* pPosition,
+							   const float* pSphereNormal, const float* pCubeNormal, uint32_t cubeColor, uint32_t sphereColor)
+{
+	writeVector(ppRows, format, PLANET_ATTRIBUTE_CUBE_POSITION, vertex, pPosition, pPosition);
+	writeVector(ppRows, format, PLANET_ATTRIBUTE_CUBE_NORMAL, vertex, pCubeNormal, pCubeNormal);
+	writeVector(ppRows, format, PLANET_ATTRIBUTE_SPHERE_POSITION, vertex, pSphereNormal, pPosition);
+	writeVector(ppRows, format, PLANET_ATTRIBUTE_SPHERE_NORMAL, vertex, pSphereNormal, pCubeNormal);
+	writeColor(ppRows, format, PLANET_ATTRIBUTE_CUBE_COLOR, vertex, cubeColor);
+	writeColor(ppRows, format, PLANET_ATTRIBUTE_SPHERE_COLOR, vertex, sphereColor);
+
+	if (format.mAttributes[PLANET_ATTRIBUTE_OBLATE_POSITION].mEncoding || format.mAttributes[PLANET_ATTRIBUTE_OBLATE_NORMAL].mEncoding)
+	{
+		float oblatePosition[3];
+		float oblateNormal[3];
+		getOblateVectors(pSphereNormal, oblatePosition, oblateNormal);
+		writeVector(ppRows, format, PLANET_ATTRIBUTE_OBLATE_POSITION, vertex, oblatePosition, pPosition);
+		writeVector(ppRows, format, PLANET_ATTRIBUTE_OBLATE_NORMAL, vertex, oblateNormal, pCubeNormal);
+	}
+}
+
+static inline void updateMaxDelta(float* pMaxDelta, const float* pVector, const float* pBase)
+{
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		const float delta = fabsf(pVector[i] - pBase[i]);
+		*pMaxDelta = delta > *pMaxDelta ? delta : *pMaxDelta;
+	}
+}
+
+void setPlanetMorphDeltaScales(PlanetVertexFormat* pFormat, uint32_t detailLevel)
+{
+	ASSERT(pFormat && detailLevel >= 2);
+
+	bool hasDeltas = false;
+	for (uint32_t i = 0; i < PLANET_ATTRIBUTE_COUNT; ++i)
+		hasDeltas |= pFormat->mAttributes[i].mEncoding == PLANET_ENCODING_DELTA4;
+	if (!hasDeltas)
+		return;
+
+	float       maxDelta[PLANET_ATTRIBUTE_COUNT] = {};
+	const float toUnit = 2.0f / float(detailLevel - 1);
+	for (uint32_t face = 0; face < 6; ++face)
+	{
+		const PlanetFace& planetFace = gPlanetFaces[face];
+		for (uint32_t x = 0; x < detailLevel; ++x)
+		{
+			const float fx = float(x) * toUnit - 1.0f;
+			for (uint32_t y = 0; y < detailLevel; ++y)
+			{
+				const float fy = float(y) * toUnit - 1.0f;
+				float       position[3];
+				for (uint32_t i = 0; i < 3; ++i)
+					position[i] = planetFace.mAxisX[i] * fx + planetFace.mAxisY[i] * fy + planetFace.mNormal[i];
+				const float invLength = 1.0f / sqrtf(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+				const float normal[3] = { position[0] * invLength, position[1] * invLength, position[2] * invLength };
+				float       oblatePosition[3];
+				float       oblateNormal[3];
+				getOblateVectors(normal, oblatePosition, oblateNormal);
+
+				updateMaxDelta(&maxDelta[PLANET_ATTRIBUTE_SPHERE_POSITION], normal, position);
+				updateMaxDelta(&maxDelta[PLANET_ATTRIBUTE_SPHERE_NORMAL], normal, planetFace.mNormal);
+				updateMaxDelta(&maxDelta[PLANET_ATTRIBUTE_OBLATE_POSITION], oblatePosition, position);
+				updateMaxDelta(&maxDelta[PLANET_ATTRIBUTE_OBLATE_NORMAL], oblateNormal, planetFace.mNormal);
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < PLANET_ATTRIBUTE_COUNT; ++i)
+	{
+		if (pFormat->mAttributes[i].mEncoding == PLANET_ENCODING_DELTA4)
+			pFormat->mAttributes[i].mDeltaScale = maxDelta[i];
+	}
+}
+
+static void generateRows(const PlanetMeshDesc* pDesc, uint32_t firstRow, uint32_t endRow)
+{
+	const uint32_t            detail = pDesc->mDetailLevel;
+	const PlanetVertexFormat& format = pDesc->mFormat;
+	const float               toUnit = 2.0f / float(detail - 1);
+	const float               toRatio = 2.0f / float(detail);
+
+	for (uint32_t row = firstRow; row < endRow; ++row)
+	{
+		const uint32_t    face = row / detail;
+		const uint32_t    x = row % detail;
+		const PlanetFace& planetFace = gPlanetFaces[face];
+
+		const float    fx = float(x) * toUnit - 1.0f;
+		const float    rowBase[3] = { planetFace.mAxisX[0] * fx + planetFace.mNormal[0], planetFace.mAxisX[1] * fx + planetFace.mNormal[1],
+									  planetFace.mAxisX[2] * fx + planetFace.mNormal[2] };
+		const float    rx = 1.0f - fabsf(float(x) * toRatio - 1.0f);
+		const uint32_t sphereRowColor = hashUint(pDesc->mSeed ^ 0x5BD1E995u, row);
+		const uint64_t firstVertex = (uint64_t)row * detail;
+		uint8_t*       pRows[PLANET_MAX_VERTEX_STREAMS];
+		for (uint32_t i = 0; i < format.mStreamCount; ++i)
+			pRows[i] = (uint8_t*)pDesc->pStreamData[i] + (uint64_t)(row - pDesc->mFirstRow) * detail * format.mStrides[i];
+
+		uint32_t y = 0;
+#if VO_PLANET_MESH_SSE
+		const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+		const __m128 scale = _mm_set1_ps(toUnit);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 three = _mm_set1_ps(3.0f);
+		for (; y + 4 <= detail; y += 4)
+		{
+			const __m128 fy = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_set1_ps(float(y)), lanes), scale), one);
+			const __m128 px = _mm_add_ps(_mm_set1_ps(rowBase[0]), _mm_mul_ps(_mm_set1_ps(planetFace.mAxisY[0]), fy));
+			const __m128 py = _mm_add_ps(_mm_set1_ps(rowBase[1]), _mm_mul_ps(_mm_set1_ps(planetFace.mAxisY[1]), fy));
+			const __m128 pz = _mm_add_ps(_mm_set1_ps(rowBase[2]), _mm_mul_ps(_mm_set1_ps(planetFace.mAxisY[2]), fy));
+
+			// Points are on the cube surface, so the squared length is >= 1 and never needs a zero check.
+			// rsqrt is ~12 bits, one Newton-Raphson step brings it close to full float precision.
+			const __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)), _mm_mul_ps(pz, pz));
+			__m128       invLength = _mm_rsqrt_ps(lengthSq);
+			invLength = _mm_mul_ps(_mm_mul_ps(half, invLength), _mm_sub_ps(three, _mm_mul_ps(_mm_mul_ps(lengthSq, invLength), invLength)));
+
+			float position[3][4];
+			float normal[3][4];
+			_mm_storeu_ps(position[0], px);
+			_mm_storeu_ps(position[1], py);
+			_mm_storeu_ps(position[2], pz);
+			_mm_storeu_ps(normal[0], _mm_mul_ps(px, invLength));
+			_mm_storeu_ps(normal[1], _mm_mul_ps(py, invLength));
+			_mm_storeu_ps(normal[2], _mm_mul_ps(pz, invLength));
+
+			for (uint32_t lane = 0; lane < 4; ++lane)
+			{
+				const uint32_t vy = y + lane;
+				const float    ry = 1.0f - fabsf(float(vy) * toRatio - 1.0f);
+				const uint32_t ratio = uint32_t(rx * ry * 255);
+				const float    vertexPosition[3] = { position[0][lane], position[1][lane], position[2][lane] };
+				const float    vertexNormal[3] = { normal[0][lane], normal[1][lane], normal[2][lane] };
+				writeVertex(pRows, vy, format, vertexPosition, vertexNormal, planetFace.mNormal,
+							scaleColor(hashUint(pDesc->mSeed, (uint32_t)(firstVertex + vy)), ratio), scaleColor(sphereRowColor, ratio));
+			}
+		}
+#endif
+		for (; y < detail; ++y)
+		{
+			const float fy = float(y) * toUnit - 1.0f;
+			const float position[3] = { rowBase[0] + planetFace.mAxisY[0] * fy, rowBase[1] + planetFace.mAxisY[1] * fy,
+										rowBase[2] + planetFace.mAxisY[2] * fy };
+			const float invLength = 1.0f / sqrtf(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+			const float normal[3] = { position[0] * invLength, position[1] * invLength, position[2] * invLength };
+
+			const float    ry = 1.0f - fabsf(float(y) * toRatio - 1.0f);
+			const uint32_t ratio = uint32_t(rx * ry * 255);
+			writeVertex(pRows, y, format, position, normal, planetFace.mNormal,
+						scaleColor(hashUint(pDesc->mSeed, (uint32_t)(firstVertex + y)), ratio), scaleColor(sphereRowColor, ratio));
+		}
+	}
+}
+
+static void generatePlanetTask(void* pUser, uint64_t index)
+{
+	const PlanetTaskData* pData = (const PlanetTaskData*)pUser;
+	const uint32_t        firstRow = pData->mFirstRow + (uint32_t)index * gRowsPerTask;
+	const uint32_t        endRow = firstRow + gRowsPerTask < pData->mEndRow ? firstRow + gRowsPerTask : pData->mEndRow;
+	generateRows(pData->pDesc, firstRow, endRow);
+}
+
+void generatePlanetVertices(const PlanetMeshDesc* pDesc)
+{
+	ASSERT(pDesc && pDesc->mFormat.mStreamCount <= PLANET_MAX_VERTEX_STREAMS);
+	ASSERT(pDesc->mDetailLevel >= 2);
+
+	const uint32_t rowCount = planetMeshRowCount(pDesc->mDetailLevel);
+	ASSERT(pDesc->mFirstRow + pDesc->mRowCount <= rowCount);
+
+	PlanetTaskData data = {};
+	data.pDesc = pDesc;
+	data.mFirstRow = pDesc->mFirstRow;
+	data.mEndRow = pDesc->mRowCount ? pDesc->mFirstRow + pDesc->mRowCount : rowCount;
+	const uint32_t taskCount = (data.mEndRow - data.mFirstRow + gRowsPerTask - 1) / gRowsPerTask;
+
+	if (pDesc->mThreadSystem)
+	{
+		threadSystemAddTaskGroup(pDesc->mThreadSystem, generatePlanetTask, taskCount, &data);
+		threadSystemWaitIdle(pDesc->mThreadSystem);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < taskCount; ++i)
+			generatePlanetTask(&data, i);
+	}
+}
+
+template<typename IndexType>
+static void generateQuadRows(const PlanetIndexDesc* pDesc, uint32_t endQuadRow)
+{
+	const uint32_t detail = pDesc->mDetailLevel;
+	IndexType*     pQuad = (IndexType*)pDesc->pIndexData;
+	for (uint32_t quadRow = pDesc->mFirstQuadRow; quadRow < endQuadRow; ++quadRow)
+	{
+		const uint32_t face = quadRow / (detail - 1);
+		const uint32_t x = quadRow % (detail - 1);
+		const uint32_t o = detail * detail * face;
+		for (uint32_t y = 0; y < detail - 1; ++y, pQuad += 6)
+		{
+#define vid(vx, vy) (IndexType)(o + (vx)*detail + (vy))
+			pQuad[0] = vid(x, y);
+			pQuad[1] = vid(x, y + 1);
+			pQuad[2] = vid(x + 1, y + 1);
+			pQuad[3] = vid(x + 1, y + 1);
+			pQuad[4] = vid(x + 1, y);
+			pQuad[5] = vid(x, y);
+#undef vid
+		}
+	}
+}
+
+void generatePlanetIndices(const PlanetIndexDesc* pDesc)
+{
+	ASSERT(pDesc && pDesc->pIndexData);
+	ASSERT(pDesc->mIndexSize == 4 || (pDesc->mIndexSize == 2 && planetMeshVertexCount(pDesc->mDetailLevel) <= 0x10000));
+
+	const uint32_t quadRowCount = planetMeshQuadRowCount(pDesc->mDetailLevel);
+	ASSERT(pDesc->mFirstQuadRow + pDesc->mQuadRowCount <= quadRowCount);
+	const uint32_t endQuadRow = pDesc->mQuadRowCount ? pDesc->mFirstQuadRow + pDesc->mQuadRowCount : quadRowCount;
+
+	if (pDesc->mIndexSize == 2)
+		generateQuadRows<uint16_t>(pDesc, endQuadRow);
+	else
+		generateQuadRows<uint32_t>(pDesc, endQuadRow);
+}
+
+void benchmarkPlanetMeshGeneration(const PlanetVertexFormat* pFormat, ThreadSystem threadSystem)
+{
+	for (uint32_t detail = 64; detail <= 1024; detail *= 2)
+	{
+		const uint64_t vertexCount = planetMeshVertexCount(detail);
+		const size_t   dataSize = (size_t)(vertexCount * planetVertexSize(pFormat));
+		void*          pVertexData = tf_malloc(dataSize);
+		if (!pVertexData)
+		{
+			LOGF(LogLevel::eWARNING, "Planet mesh benchmark: could not allocate %.1f MB for detail %u", dataSize / (1024.0 * 1024.0), detail);
+			break;
+		}
+		// Touch every page once so both runs measure generation rather than page faults
+		memset(pVertexData, 0, dataSize);
+
+		PlanetMeshDesc desc = {};
+		desc.mDetailLevel = detail;
+		desc.mFormat = *pFormat;
+		uint64_t streamOffset = 0;
+		for (uint32_t i = 0; i < pFormat->mStreamCount; ++i)
+		{
+			desc.pStreamData[i] = (uint8_t*)pVertexData + streamOffset;
+			streamOffset += vertexCount * pFormat->mStrides[i];
+		}
+
+		HiresTimer timer;
+		initHiresTimer(&timer);
+		desc.mThreadSystem = NULL;
+		generatePlanetVertices(&desc);
+		const double singleMs = getHiresTimerUSec(&timer, true) / 1000.0;
+
+		desc.mThreadSystem = threadSystem;
+		generatePlanetVertices(&desc);
+		const double pooledMs = getHiresTimerUSec(&timer, true) / 1000.0;
+
+		LOGF(LogLevel::eINFO, "Planet mesh %4u per edge (%8llu verts, %7.1f MB): 1 thread %8.2f ms, pool %8.2f ms, %7.1f Mverts/s, x%.2f",
+			 detail, (unsigned long long)vertexCount, dataSize / (1024.0 * 1024.0), singleMs, pooledMs,
+			 pooledMs > 0.0 ? vertexCount / (pooledMs * 1000.0) : 0.0, pooledMs > 0.0 ? singleMs / pooledMs : 0.0);
+
+		tf_free(pVertexData);
+	}
+}
@@ -1,8 +1,6 @@
 // Unit Test for testing transformations using a solar system.
 // Tests the basic mat4 transformations, such as scaling, rotation, and translation.
 
-#define MAX_PLANETS 20 // Does not affect test, just for allocating space in uniform block. Must match with shader.
-
 #include <cstdint>
 
 // Interfaces
@@ -14,7 +12,11 @@
 #include "Application/Interfaces/IUI.h"
 #include "Game/Interfaces/IScripting.h"
 
+#include "Utilities/Interfaces/IFileSystem.h"
+#include "Utilities/Interfaces/ILog.h"
+#include "Utilities/Interfaces/ITime.h"
 #include "Utilities/RingBuffer.h"
+#include "Utilities/Threading/ThreadSystem.h"
 
 // Renderer
 #include "Graphics/Interfaces/IGraphics.h"
@@ -23,7 +25,22 @@
 // Math
 #include "Utilities/Math/MathTypes.h"
 
-#include "Utilities/Interfaces/IMemory.h"
+#include "Public/PlanetMesh.h"
+#include "VoCommon/Public/BenchmarkScenario.h"
+#include "VoCommon/Public/ExitCode.h"
+#include "VoCommon/Public/FrameTimeStats.h"
+#include "VoCommon/Public/FrameTrace.h"
+#include "VoCommon/Public/FrustumCulling.h"
+#include "VoCommon/Public/MeshOptimizer.h"
+#include "VoCommon/Public/PassMetrics.h"
+#include "VoCommon/Public/PipelineCacheFile.h"
+#include "VoCommon/Public/StartupTrace.h"
+#include "VoCommon/Public/TextureStreaming.h"
+#include "VoCommon/Public/TransformHierarchy.h"
+
+#include "VoCommon/Public/CommandLine.h"
+
+#include "VoCommon/Public/TrackedMemory.h"
 
 // fsl
 #include "Graphics/FSL/defaults.h"
@@ -32,9 +49,8 @@
 /// Demo structures
 struct PlanetInfoStruct
 {
-	mat4  mTranslationMat;
-	mat4  mScaleMat;
-	mat4  mSharedMat; // Matrix to pass down to children
+	vec3  mTranslation;
+	float mScale;
 	vec4  mColor;
 	uint  mParentIndex;
 	float mYOrbitSpeed; // Rotation speed around parent
@@ -47,13 +63,21 @@ struct UniformBlock
 {
 	CameraMatrix mProjectView;
 	CameraMatrix mSkyProjectView;
-	mat4         mToWorldMat[MAX_PLANETS];
-	vec4         mColor[MAX_PLANETS];
-	float        mGeometryWeight[MAX_PLANETS][4];
 
 	// Point Light Information
 	vec4 mLightPosition;
 	vec4 mLightColor;
+
+	// Per-mesh scales of the sphere position, sphere normal, oblate position and oblate normal morph deltas
+	vec4 mMorphDeltaScale;
+};
+
+// InstanceData in Resources.h.fsl
+struct InstanceData
+{
+	mat4  mToWorldMat;
+	vec4  mColor;
+	float mGeometryWeight[4];
 };
 
 // But we only need Two sets of resources (one in flight and one being used on CPU)
@@ -72,20 +96,237 @@ SwapChain* pSwapChain = NULL;
 RenderTarget* pDepthBuffer = NULL;
 Semaphore* pImageAcquiredSemaphore = NULL;
 
-Shader* pSphereShader = NULL;
-Buffer* pSphereVertexBuffer = NULL;
+// Saved on exit, warms up pipeline creation of the next run
+PipelineCacheFile gPipelineCache = {};
+
+// Vertex shader variants of the sphere layouts
+enum SphereShader
+{
+	SPHERE_SHADER_BASIC,      // basic.vert, full key frames
+	SPHERE_SHADER_OCTAHEDRAL, // basic_oct.vert, octahedral normals
+	SPHERE_SHADER_MORPH,      // basic_morph.vert, cube key frame plus sphere and oblate morph deltas
+	SPHERE_SHADER_COUNT
+};
+
+Shader* pSphereShaders[SPHERE_SHADER_COUNT] = {};
 Buffer* pSphereIndexBuffer = NULL;
 uint32_t     gSphereIndexCount = 0;
-Pipeline* pSpherePipeline = NULL;
+IndexType    gSphereIndexType = INDEX_TYPE_UINT16;
 VertexLayout gSphereVertexLayout = {};
 uint32_t     gSphereLayoutType = 0;
 
+// Attribute slots in Basic.vert.fsl VSInput order, the slot is also the location.
+struct SphereAttributeSlot
+{
+	ShaderSemantic  mSemantic;
+	PlanetAttribute mAttribute;
+};
+static const SphereAttributeSlot gSphereAttributeSlots[PLANET_ATTRIBUTE_COUNT] = {
+	{ SEMANTIC_POSITION, PLANET_ATTRIBUTE_CUBE_POSITION },   { SEMANTIC_NORMAL, PLANET_ATTRIBUTE_CUBE_NORMAL },
+	{ SEMANTIC_TEXCOORD1, PLANET_ATTRIBUTE_SPHERE_POSITION }, { SEMANTIC_TEXCOORD3, PLANET_ATTRIBUTE_SPHERE_NORMAL },
+	{ SEMANTIC_TEXCOORD0, PLANET_ATTRIBUTE_CUBE_COLOR },      { SEMANTIC_TEXCOORD2, PLANET_ATTRIBUTE_SPHERE_COLOR },
+	{ SEMANTIC_TEXCOORD4, PLANET_ATTRIBUTE_OBLATE_POSITION }, { SEMANTIC_TEXCOORD5, PLANET_ATTRIBUTE_OBLATE_NORMAL },
+};
+
+struct SphereLayoutAttrib
+{
+	TinyImageFormat mFormat;
+	uint32_t        mBinding;
+	uint32_t        mOffset;
+};
+
+// One entry per selectable vertex layout. Vectors are R32G32B32_SFLOAT, R16G16B16A16_SFLOAT (half, 3 channel half
+// formats aren't a supported vertex fetch format everywhere), R16G16_SNORM (octahedral, normals only) or
+// R16G16B16A16_SNORM (morph delta); colors are RGBA8 in every layout. Attribs left UNDEFINED are not stored.
+struct SphereLayoutDesc
+{
+	const char*        pName;
+	uint32_t           mBindingCount;
+	uint32_t           mStrides[PLANET_MAX_VERTEX_STREAMS];
+	uint32_t           mShader; // SphereShader
+	SphereLayoutAttrib mAttribs[PLANET_ATTRIBUTE_COUNT];
+};
+
+#define F32x3 TinyImageFormat_R32G32B32_SFLOAT
+#define F16x4 TinyImageFormat_R16G16B16A16_SFLOAT
+#define OCT16 TinyImageFormat_R16G16_SNORM
+#define D16x4 TinyImageFormat_R16G16B16A16_SNORM
+#define RGBA8 TinyImageFormat_R8G8B8A8_UNORM
+
+// Attribs in gSphereAttributeSlots order
+static const SphereLayoutDesc gSphereLayouts[] = {
+	// Sphere position and normal alias the same bytes
+	{ "Interleaved 44 B", 1, { 44 }, SPHERE_SHADER_BASIC,
+	  { { F32x3, 0, 0 }, { F32x3, 0, 16 }, { F32x3, 0, 32 }, { F32x3, 0, 32 }, { RGBA8, 0, 12 }, { RGBA8, 0, 28 } } },
+	{ "Interleaved padded 80 B", 1, { 80 }, SPHERE_SHADER_BASIC,
+	  { { F32x3, 0, 0 }, { F32x3, 0, 16 }, { F32x3, 0, 48 }, { F32x3, 0, 64 }, { RGBA8, 0, 32 }, { RGBA8, 0, 36 } } },
+	// Positions alone in stream 0, for position-only passes
+	{ "Split position stream 24 + 32 B", 2, { 24, 32 }, SPHERE_SHADER_BASIC,
+	  { { F32x3, 0, 0 }, { F32x3, 1, 0 }, { F32x3, 0, 12 }, { F32x3, 1, 12 }, { RGBA8, 1, 24 }, { RGBA8, 1, 28 } } },
+	{ "Half positions 48 B", 1, { 48 }, SPHERE_SHADER_BASIC,
+	  { { F16x4, 0, 0 }, { F32x3, 0, 16 }, { F16x4, 0, 8 }, { F32x3, 0, 28 }, { RGBA8, 0, 40 }, { RGBA8, 0, 44 } } },
+	{ "Octahedral normals 40 B", 1, { 40 }, SPHERE_SHADER_OCTAHEDRAL,
+	  { { F32x3, 0, 0 }, { OCT16, 0, 24 }, { F32x3, 0, 12 }, { OCT16, 0, 28 }, { RGBA8, 0, 32 }, { RGBA8, 0, 36 } } },
+	{ "Half positions + octahedral normals 32 B", 1, { 32 }, SPHERE_SHADER_OCTAHEDRAL,
+	  { { F16x4, 0, 0 }, { OCT16, 0, 16 }, { F16x4, 0, 8 }, { OCT16, 0, 20 }, { RGBA8, 0, 24 }, { RGBA8, 0, 28 } } },
+	// One stream per attribute
+	{ "SoA streams 4 x 12 + 2 x 4 B", 6, { 12, 12, 12, 12, 4, 4 }, SPHERE_SHADER_BASIC,
+	  { { F32x3, 0, 0 }, { F32x3, 1, 0 }, { F32x3, 2, 0 }, { F32x3, 3, 0 }, { RGBA8, 4, 0 }, { RGBA8, 5, 0 } } },
+	// Cube key frame plus quantized deltas to the sphere and oblate ones, 16 B per extra key frame
+	{ "Morph deltas, 3 key frames 56 B", 1, { 56 }, SPHERE_SHADER_MORPH,
+	  { { F32x3, 0, 0 }, { OCT16, 0, 12 }, { D16x4, 0, 16 }, { D16x4, 0, 24 }, { RGBA8, 0, 32 }, { RGBA8, 0, 36 }, { D16x4, 0, 40 },
+		{ D16x4, 0, 48 } } },
+};
+
+#undef F32x3
+#undef F16x4
+#undef OCT16
+#undef D16x4
+#undef RGBA8
+
+const uint32_t gSphereLayoutTypeCount = TF_ARRAY_COUNT(gSphereLayouts);
+
+// Generated geometry stays GPU resident across shader and rendertarget reloads, one vertex buffer per layout type
+// holding every stream back to back. pSphereMesh/gSphereVertexLayout point at the entry of the current layout,
+// gCurrentSphereLayoutType; gSphereLayoutType is the one the UI asks for.
+struct SphereMesh
+{
+	Buffer*            pVertexBuffer;
+	Buffer*            pStreamBuffers[PLANET_MAX_VERTEX_STREAMS]; // pVertexBuffer once per stream, for cmdBindVertexBuffer
+	uint32_t           mStrides[PLANET_MAX_VERTEX_STREAMS];
+	uint64_t           mStreamOffsets[PLANET_MAX_VERTEX_STREAMS];
+	VertexLayout       mLayout;
+	PlanetVertexFormat mFormat; // mLayout as the generator sees it, with the morph delta scales of mDetailLevel
+	uint32_t           mDetailLevel;
+	bool               mOptimized;
+};
+SphereMesh  gSphereMeshes[gSphereLayoutTypeCount] = {};
+SphereMesh* pSphereMesh = NULL;
+uint32_t    gCurrentSphereLayoutType = 0;
+
+// One pipeline per layout, all built in addPipelines(), so switching layouts only needs the mesh of the new one
+Pipeline* pSpherePipelines[gSphereLayoutTypeCount] = {};
+
+// LOD chain of each layout's mesh, LOD 0 is the mesh with pSphereIndexBuffer. LOD l has gSphereDetailLevel >> l
+// vertices per cube face edge (at least 2); these are streamed without optimizer or disk cache and, as lower detail
+// levels have no larger morph deltas (the position ones come from the cube corners every level has), use the delta
+// scales of LOD 0 so mMorphDeltaScale holds for the whole chain.
+struct SphereLod
+{
+	SphereMesh mMesh;
+	Buffer*    pIndexBuffer;
+	uint32_t   mIndexCount;
+	IndexType  mIndexType;
+	uint32_t   mBaseDetailLevel; // of LOD 0 when built
+};
+const uint32_t gSphereLodCount = 4;
+SphereLod      gSphereLods[gSphereLayoutTypeCount][gSphereLodCount] = {}; // [][0] unused
+
+// An instance gets the finest LOD whose vertices along a cube face edge are at least gLodVertexSpacing pixels apart on
+// screen (projected bounding radius / detail level). Refining needs gLodHysteresis more spacing and keeping the current
+// LOD that much less, so instances near a threshold don't flip every frame.
+float gLodVertexSpacing = 2.0f;
+float gLodHysteresis = 0.15f;
+
+bool        gUseSphereMeshDiskCache = true;
+
+// Reorders sphere triangles for the post-transform cache and overdraw, and vertices for fetch locality. The optimizer
+// needs the whole mesh on the CPU (vertices, 32-bit indices and the remapped copies, about 1.5 GB at detail 1024), so
+// detail levels above gMaxOptimizedSphereDetailLevel keep the bounded memory of the streamed upload instead.
+const uint32_t   gMaxOptimizedSphereDetailLevel = 256;
+bool             gOptimizeSphereMesh = true;
+bool             gSphereIndexOptimized = false;
+VertexCacheStats gSphereCacheStats = {}; // of the current index buffer, mVerticesTransformed is 0 when not analyzed
+
+// Vertices per cube face edge. Up to 104 (6 * 104^2 <= 65536) the mesh uses 16-bit indices, 32-bit above that; 1024 is
+// 6.3M vertices.
+const uint32_t gMaxSphereDetailLevel = 1024;
+uint32_t       gSphereDetailLevel = 64;
+uint32_t       gSphereIndexDetailLevel = 0;
+bool           gRunMeshBenchmark = false;
+bool           gRunTransformBenchmark = false;
+bool           gRunCullingBenchmark = false;
+
+// Share of the morph that goes to the oblate key frame instead of the sphere, layouts with morph deltas only
+float gOblateMorphWeight = 0.5f;
+
+// Vertex layout benchmark ("Benchmark Vertex Layouts", or --layout-benchmark which exits when done): every layout is
+// drawn for gLayoutBenchmarkWarmupFrames, then GPU frame time and 3D pipeline stats are summed over gLayoutBenchmarkFrames
+// and the averages written to VertexLayoutBenchmark.csv.
+struct LayoutBenchmarkResult
+{
+	double   mGpuMs;
+	uint64_t mVSInvocations;
+	uint64_t mPSInvocations;
+	uint64_t mIAPrimitives;
+	uint64_t mCPrimitives;
+};
+const uint32_t        gLayoutBenchmarkWarmupFrames = 60;
+const uint32_t        gLayoutBenchmarkFrames = 240;
+bool                  gRunLayoutBenchmark = false;
+bool                  gLayoutBenchmarkActive = false;
+bool                  gExitAfterLayoutBenchmark = false;
+uint32_t              gLayoutBenchmarkFrame = 0;
+uint32_t              gLayoutBenchmarkRestoreType = 0;
+LayoutBenchmarkResult gLayoutBenchmarkResults[gSphereLayoutTypeCount] = {};
+
+// "--scenario <file>" runs a benchmark scenario from Scripts/ (see BenchmarkScenario.h) and exits when done, with a
+// failing exit code if a metric regressed against the scenario's baseline or there is no baseline. Scene keys:
+// asteroids, belt (0/1), layout, detail, skybox_faces (0/1) and threads (0 = default). VSync is off while it runs.
+enum ScenarioMetric
+{
+	SCENARIO_METRIC_CPU_FRAME_MS,
+	SCENARIO_METRIC_GPU_FRAME_MS,
+	SCENARIO_METRIC_DRAW_SKYBOX_GPU_MS,
+	SCENARIO_METRIC_VS_INVOCATIONS,
+	SCENARIO_METRIC_PS_INVOCATIONS,
+	SCENARIO_METRIC_IA_PRIMITIVES,
+	SCENARIO_METRIC_CLIPPER_PRIMITIVES,
+	SCENARIO_METRIC_COUNT,
+};
+const char* gScenarioMetricNames[SCENARIO_METRIC_COUNT] = {
+	"cpu_frame_ms", "gpu_frame_ms", "draw_skybox_gpu_ms", "vs_invocations", "ps_invocations", "ia_primitives", "clipper_primitives",
+};
+BenchmarkScenario gScenario = {};
+bool              gScenarioPassed = true;
+
+// "Capture Frame Trace" (or "--frame-trace N" at startup) writes the next gFrameTraceFrames frames to
+// Debug/_VoAcademy.trace.json: CPU scopes of the main thread and the transform tasks, and the GPU draw ranges.
+uint32_t gFrameTraceFrames = 120;
+
+ThreadSystem gThreadSystem = NULL;
+
 Shader* pSkyBoxDrawShader = NULL;
 Buffer* pSkyBoxVertexBuffer = NULL;
 Pipeline* pSkyBoxDrawPipeline = NULL;
-Texture* pSkyBoxTextures[6];
+// Six faces, streamed in after the first Load(); index i is pSkyBoxImageFileNames[i]
+TextureStreamer gSkyBoxStreamer = {};
+// gSkyBoxStreamer.mVersion each copy of pDescriptorSetSkyBoxFaces was last written with
+uint32_t gSkyBoxDescriptorVersions[gDataBufferCount] = {};
 Sampler* pSkyBoxSampler = {};
 DescriptorSet* pDescriptorSetTexture = { NULL };
+DescriptorSet* pDescriptorSetSkyBoxFaces = NULL;
+
+// The skybox samples one cube map with the view direction. The build pass bakes the six faces into it, one draw per
+// cube face: at startup from the placeholders (1x1), and again at the face resolution once every face streamed in.
+RenderTarget* pSkyBoxCube = NULL;
+Shader*       pSkyBoxCubeBuildShader = NULL;
+Pipeline*     pSkyBoxCubeBuildPipeline = NULL;
+Buffer*       pSkyBoxCubeBuildVertexBuffer = NULL;
+bool          gSkyBoxCubeBuildPending = true;
+
+// "Six-Face Skybox" draws from the faces directly, as before the cube map, so both can be compared. Each path is a timed
+// pass of its own, averaged since the last reload.
+enum SkyBoxPath
+{
+	SKYBOX_PATH_CUBE,
+	SKYBOX_PATH_FACES,
+	SKYBOX_PATH_COUNT,
+};
+Shader*   pSkyBoxFacesShader = NULL;
+Pipeline* pSkyBoxFacesPipeline = NULL;
+bool      gDrawSkyBoxFaces = false;
+uint32_t  gSkyBoxPasses[SKYBOX_PATH_COUNT] = { PASS_METRICS_NO_PASS, PASS_METRICS_NO_PASS };
 DescriptorSet* pDescriptorSetUniforms = { NULL };
 
 Buffer* pUniformBuffer[gDataBufferCount] = { NULL };
@@ -97,13 +338,57 @@ int              gNumberOfSpherePoints;
 UniformBlock     gUniformData;
 PlanetInfoStruct gPlanetInfoData[gNumPlanets];
 
+// Asteroid belt between Mars and Jupiter: ring nodes under the sun orbit, each turning at its own speed, with the
+// asteroids static below them. The belt is always in the hierarchy and the instance buffers, "Asteroid Belt" only
+// decides whether it moves and is drawn. "--asteroids N" overrides the count.
+const uint32_t gAsteroidRingCount = 16;
+const float    gAsteroidBeltInnerRadius = 43.0f;
+const float    gAsteroidBeltOuterRadius = 47.0f;
+uint32_t       gAsteroidCount = 100000;
+bool           gDrawAsteroidBelt = false;
+
+// Two nodes per planet: the orbit (node 2 * i) that moons hang off, and the body (node 2 * i + 1) below it that adds
+// the self rotation, the z orbit tilt and the scale. The asteroid rings and then the asteroids follow.
+TransformHierarchy gPlanetTransforms = {};
+const uint32_t     gFirstRingNode = gNumPlanets * 2;
+const uint32_t     gFirstAsteroidNode = gFirstRingNode + gAsteroidRingCount;
+
+// Earth years for one orbit at the inner edge of the belt, rings further out are slower by (radius / inner)^1.5
+const float gAsteroidBeltOrbitSpeed = 3.0f;
+
+// Planets, then asteroids. pInstanceUploads counts per instance the instance buffers still holding old data: set to
+// gDataBufferCount when an instance changes, only those instances are written on upload.
+uint32_t      gInstanceCount = 0;
+InstanceData* pInstanceData = NULL;
+uint8_t*      pInstanceUploads = NULL;
+Buffer*       pInstanceBuffer[gDataBufferCount] = { NULL };
+
+// Bounding spheres of the instances, SoA: center x, y and z, then radius, gInstanceCount floats each. Updated from the
+// hierarchy change list and culled against the camera frustum every frame.
+const float gSphereMeshBoundingRadius = 1.7320508f; // cube key frame corners
+float*      pInstanceBounds = NULL;
+uint32_t*   pVisibleInstances = NULL;
+uint32_t    gVisibleInstanceCount = 0;
+bool        gFrustumCulling = true;
+
+// The visible instances grouped by LOD, one instanced draw per LOD. pVisibleInstanceBuffer holds pDrawInstances and is
+// bound as an instance rate vertex stream at the first instance of each LOD: unlike SV_InstanceID, which starts at 0
+// for every draw on D3D whatever the start instance, a vertex stream offset works the same on every API.
+uint8_t*  pInstanceLods = NULL; // last selected LOD, kept while an instance is culled
+uint32_t* pDrawInstances = NULL;
+uint32_t  gLodInstanceCounts[gSphereLodCount] = {};
+uint32_t  gLodFirstInstances[gSphereLodCount] = {};
+Buffer*   pVisibleInstanceBuffer[gDataBufferCount] = { NULL };
+
 ICameraController* pCameraController = NULL;
 
 UIComponent* pGuiWindow = NULL;
 
 uint32_t gFontID = 0;
 
-QueryPool* pPipelineStatsQueryPool[gDataBufferCount] = {};
+// Pass metrics with pipeline statistics, the 3D pass covers the skybox and planets
+uint32_t gScenePass = PASS_METRICS_NO_PASS;
+uint32_t gUIPass = PASS_METRICS_NO_PASS;
 
 const char* pSkyBoxImageFileNames[] = { "Skybox_right1.tex",  "Skybox_left2.tex",  "Skybox_top3.tex",
 										"Skybox_bottom4.tex", "Skybox_front5.tex", "Skybox_back6.tex" };
@@ -137,8 +422,63 @@ const float gSkyBoxPoints[] = {
 	-10.0f, 4.0f,   -10.0f, -10.0f, 10.0f,  4.0f,   10.0f,  -10.0f, 10.0f,  4.0f,
 };
 
-static unsigned char gPipelineStatsCharArray[2048] = {};
-static bstring       gPipelineStats = bfromarr(gPipelineStatsCharArray);
+// Per cube face in layer order (+x, -x, +y, -y, +z, -z): the skybox cube point at the center of the face, the offsets
+// to its right and top edges (clip x and y = 1) and the face id of gSkyBoxPoints.
+const float gSkyBoxCubeFaces[6][10] = {
+	{ 10.0f, 0.0f, 0.0f, 0.0f, 0.0f, -10.0f, 0.0f, 10.0f, 0.0f, 1.0f },
+	{ -10.0f, 0.0f, 0.0f, 0.0f, 0.0f, 10.0f, 0.0f, 10.0f, 0.0f, 2.0f },
+	{ 0.0f, 10.0f, 0.0f, 10.0f, 0.0f, 0.0f, 0.0f, 0.0f, -10.0f, 3.0f },
+	{ 0.0f, -10.0f, 0.0f, 10.0f, 0.0f, 0.0f, 0.0f, 0.0f, 10.0f, 4.0f },
+	{ 0.0f, 0.0f, 10.0f, 10.0f, 0.0f, 0.0f, 0.0f, 10.0f, 0.0f, 5.0f },
+	{ 0.0f, 0.0f, -10.0f, -10.0f, 0.0f, 0.0f, 0.0f, 10.0f, 0.0f, 6.0f },
+};
+
+// One fullscreen triangle per cube face: clip position, then cube point and face id, 8 floats per vertex.
+static void fill_skybox_cube_build_points(float* pPoints)
+{
+	static const float clip[3][2] = { { -1.0f, -1.0f }, { -1.0f, 3.0f }, { 3.0f, -1.0f } };
+	for (uint32_t face = 0; face < 6; ++face)
+	{
+		const float* pFace = gSkyBoxCubeFaces[face];
+		for (uint32_t v = 0; v < 3; ++v, pPoints += 8)
+		{
+			pPoints[0] = clip[v][0];
+			pPoints[1] = clip[v][1];
+			pPoints[2] = 0.0f;
+			pPoints[3] = 1.0f;
+			for (uint32_t c = 0; c < 3; ++c)
+				pPoints[4 + c] = pFace[c] + clip[v][0] * pFace[3 + c] + clip[v][1] * pFace[6 + c];
+			pPoints[7] = pFace[9];
+		}
+	}
+}
+
+static unsigned char gSkyBoxStatsCharArray[128] = {};
+static bstring       gSkyBoxStats = bfromarr(gSkyBoxStatsCharArray);
+
+static unsigned char gPassMetricsCharArray[2048] = {};
+static bstring       gPassMetricsText = bfromarr(gPassMetricsCharArray);
+
+static unsigned char gSphereLayoutNameCharArray[64] = {};
+static bstring       gSphereLayoutName = bfromarr(gSphereLayoutNameCharArray);
+
+static unsigned char gSphereMeshStatsCharArray[256] = {};
+static bstring       gSphereMeshStats = bfromarr(gSphereMeshStatsCharArray);
+
+static unsigned char gInstanceStatsCharArray[256] = {};
+static bstring       gInstanceStats = bfromarr(gInstanceStatsCharArray);
+
+static unsigned char gCullingStatsCharArray[128] = {};
+static bstring       gCullingStats = bfromarr(gCullingStatsCharArray);
+
+static unsigned char gLodStatsCharArray[256] = {};
+static bstring       gLodStats = bfromarr(gLodStatsCharArray);
+
+static unsigned char gAllocationStatsCharArray[1024] = {};
+static bstring       gAllocationStats = bfromarr(gAllocationStatsCharArray);
+
+static unsigned char gFrameTimesCharArray[1024] = {};
+static bstring       gFrameTimes = bfromarr(gFrameTimesCharArray);
 
 void reloadRequest(void*)
 {
@@ -150,255 +490,808 @@ const char* gWindowTestScripts[] = { "TestFullScreen.lua", "TestCenteredWindow.l
 
 const char* gReloadServerTestScripts[] = { "TestReloadShader.lua", "TestReloadShaderCapture.lua" };
 
-static void add_attribute(VertexLayout* layout, ShaderSemantic semantic, TinyImageFormat format, uint32_t offset)
+static void add_sphere_layout(uint32_t layoutType, VertexLayout* pLayout)
 {
-	uint32_t n_attr = layout->mAttribCount++;
+	const SphereLayoutDesc* pDesc = &gSphereLayouts[layoutType];
 
-	VertexAttrib* attr = layout->mAttribs + n_attr;
+	*pLayout = {};
+	pLayout->mBindingCount = pDesc->mBindingCount;
+	for (uint32_t i = 0; i < pDesc->mBindingCount; ++i)
+		pLayout->mBindings[i].mStride = pDesc->mStrides[i];
 
-	attr->mSemantic = semantic;
-	attr->mFormat = format;
-	attr->mBinding = 0;
-	attr->mLocation = n_attr;
-	attr->mOffset = offset;
+	for (uint32_t i = 0; i < PLANET_ATTRIBUTE_COUNT; ++i)
+	{
+		if (pDesc->mAttribs[i].mFormat == TinyImageFormat_UNDEFINED)
+			continue;
+		VertexAttrib* pAttrib = &pLayout->mAttribs[pLayout->mAttribCount++];
+		pAttrib->mSemantic = gSphereAttributeSlots[i].mSemantic;
+		pAttrib->mFormat = pDesc->mAttribs[i].mFormat;
+		pAttrib->mBinding = pDesc->mAttribs[i].mBinding;
+		pAttrib->mLocation = i;
+		pAttrib->mOffset = pDesc->mAttribs[i].mOffset;
+	}
 }
 
-static void copy_attribute(VertexLayout* layout, void* buffer_data, uint32_t offset, uint32_t size, uint32_t vcount, void* data)
+static uint32_t get_planet_attribute_encoding(TinyImageFormat format)
 {
-	uint8_t* dst_data = static_cast<uint8_t*>(buffer_data);
-	uint8_t* src_data = static_cast<uint8_t*>(data);
-	for (uint32_t i = 0; i < vcount; ++i)
+	switch (format)
 	{
-		memcpy(dst_data + offset, src_data, size);
-
-		dst_data += layout->mBindings[0].mStride;
-		src_data += size;
+	case TinyImageFormat_R32G32B32_SFLOAT:
+		return PLANET_ENCODING_FLOAT3;
+	case TinyImageFormat_R16G16B16A16_SFLOAT:
+		return PLANET_ENCODING_HALF4;
+	case TinyImageFormat_R16G16_SNORM:
+		return PLANET_ENCODING_OCTAHEDRAL;
+	case TinyImageFormat_R16G16B16A16_SNORM:
+		return PLANET_ENCODING_DELTA4;
+	case TinyImageFormat_R8G8B8A8_UNORM:
+		return PLANET_ENCODING_RGBA8;
+	default:
+		return PLANET_ENCODING_NONE;
 	}
 }
 
-static void compute_normal(const float* src, float* dst)
+// Streams, offsets and encodings the generator writes, read from the vertex layout so the two can't drift apart.
+static PlanetVertexFormat get_planet_vertex_format(const VertexLayout* pLayout)
 {
-	float len = sqrtf(src[0] * src[0] + src[1] * src[1] + src[2] * src[2]);
-	if (len == 0)
+	PlanetVertexFormat format = {};
+	format.mStreamCount = pLayout->mBindingCount;
+	for (uint32_t i = 0; i < pLayout->mBindingCount; ++i)
+		format.mStrides[i] = pLayout->mBindings[i].mStride;
+
+	for (uint32_t i = 0; i < pLayout->mAttribCount; ++i)
 	{
-		dst[0] = 0;
-		dst[1] = 0;
-		dst[2] = 0;
+		const VertexAttrib* pAttrib = &pLayout->mAttribs[i];
+		for (uint32_t slot = 0; slot < PLANET_ATTRIBUTE_COUNT; ++slot)
+		{
+			if (gSphereAttributeSlots[slot].mSemantic != pAttrib->mSemantic)
+				continue;
+			PlanetAttributeFormat* pAttribute = &format.mAttributes[gSphereAttributeSlots[slot].mAttribute];
+			pAttribute->mEncoding = get_planet_attribute_encoding(pAttrib->mFormat);
+			pAttribute->mStream = pAttrib->mBinding;
+			pAttribute->mOffset = pAttrib->mOffset;
+		}
 	}
-	else
+	return format;
+}
+
+// Sphere geometry is produced and uploaded in chunks of at most this many bytes (or one row, if larger). A chunk fits
+// the resource loader staging buffer, so CPU memory use is bounded at any detail level and only the GPU buffer ever
+// holds the whole mesh.
+static const uint64_t gSphereUploadChunkSize = 4 * 1024 * 1024;
+
+// Streams of one vertex buffer start on this boundary.
+static const uint64_t gSphereStreamAlignment = 256;
+
+static uint32_t get_rows_per_upload_chunk(uint64_t rowSize)
+{
+	const uint64_t rows = gSphereUploadChunkSize / rowSize;
+	return rows ? (uint32_t)rows : 1;
+}
+
+// Offsets of every stream in a buffer holding vertexCount vertices of each stream back to back. Returns the buffer size.
+static uint64_t get_sphere_stream_offsets(const PlanetVertexFormat* pFormat, uint64_t vertexCount, uint64_t* pOffsets)
+{
+	uint64_t offset = 0;
+	for (uint32_t i = 0; i < pFormat->mStreamCount; ++i)
 	{
-		dst[0] = src[0] / len;
-		dst[1] = src[1] / len;
-		dst[2] = src[2] / len;
+		pOffsets[i] = offset;
+		offset += vertexCount * pFormat->mStrides[i];
+		offset = (offset + gSphereStreamAlignment - 1) / gSphereStreamAlignment * gSphereStreamAlignment;
 	}
+	return offset;
 }
 
-static void generate_complex_mesh()
+// Creates an empty GPU buffer, filled afterwards through beginUpdateResource/endUpdateResource.
+static void add_sphere_buffer(DescriptorType descriptors, uint64_t size, Buffer** ppBuffer)
 {
-	gSphereVertexLayout = {};
+	BufferLoadDesc bufferDesc = {};
+	bufferDesc.mDesc.mDescriptors = descriptors;
+	bufferDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+	bufferDesc.mDesc.mSize = size;
+	bufferDesc.ppBuffer = ppBuffer;
+	addResource(&bufferDesc, nullptr);
+}
+
+static void add_sphere_vertex_buffer(SphereMesh* pMesh, const PlanetVertexFormat* pFormat, uint32_t detailLevel)
+{
+	const uint64_t size = get_sphere_stream_offsets(pFormat, planetMeshVertexCount(detailLevel), pMesh->mStreamOffsets);
+	add_sphere_buffer(DESCRIPTOR_TYPE_VERTEX_BUFFER, size, &pMesh->pVertexBuffer);
+	for (uint32_t i = 0; i < pFormat->mStreamCount; ++i)
+	{
+		pMesh->pStreamBuffers[i] = pMesh->pVertexBuffer;
+		pMesh->mStrides[i] = pFormat->mStrides[i];
+	}
+}
 
-	// number of vertices on a quad side, must be >= 2
-#define DETAIL_LEVEL 64
+// Copies pData to pBuffer one staging chunk at a time, pData can be freed as soon as this returns.
+static void upload_sphere_buffer_data(Buffer* pBuffer, uint64_t dstOffset, const void* pData, uint64_t size)
+{
+	for (uint64_t offset = 0; offset < size; offset += gSphereUploadChunkSize)
+	{
+		BufferUpdateDesc update = { pBuffer };
+		update.mDstOffset = dstOffset + offset;
+		update.mSize = size - offset < gSphereUploadChunkSize ? size - offset : gSphereUploadChunkSize;
+		beginUpdateResource(&update);
+		memcpy(update.pMappedData, (const uint8_t*)pData + offset, (size_t)update.mSize);
+		endUpdateResource(&update);
+	}
+}
 
-	// static here to prevent stack overflow
-	static float verts[6][DETAIL_LEVEL][DETAIL_LEVEL][3];
-	static float sqNormals[6][DETAIL_LEVEL][DETAIL_LEVEL][3];
-	static float sphNormals[6][DETAIL_LEVEL][DETAIL_LEVEL][3];
+// Produces the vertices chunk by chunk into a zeroed scratch chunk (so the padding between attributes is deterministic
+// in the disk cache): read from pReadStream when set, otherwise generated and also written to pWriteStream when set.
+// Each chunk then goes to pBuffer, or to pCpuCopy when set; both hold every stream back to back at pStreamOffsets.
+// The disk cache stores each chunk stream by stream, so reading it back needs the same chunk size.
+static void build_sphere_vertices(const PlanetVertexFormat* pFormat, uint32_t detailLevel, FileStream* pReadStream,
+								  FileStream* pWriteStream, Buffer* pBuffer, uint8_t* pCpuCopy, const uint64_t* pStreamOffsets)
+{
+	PlanetMeshDesc desc = {};
+	desc.mDetailLevel = detailLevel;
+	desc.mSeed = (uint32_t)randomInt(0, 0x7FFFFFFF);
+	desc.mFormat = *pFormat;
+	desc.mThreadSystem = gThreadSystem;
+
+	const uint32_t rowCount = planetMeshRowCount(detailLevel);
+	const uint32_t rowsPerChunk = get_rows_per_upload_chunk((uint64_t)detailLevel * planetVertexSize(pFormat));
+	const uint64_t chunkVertices = (uint64_t)rowsPerChunk * detailLevel;
+	uint8_t*       pScratch = (uint8_t*)tf_calloc((size_t)chunkVertices, planetVertexSize(pFormat));
+
+	uint64_t scratchOffset = 0;
+	for (uint32_t i = 0; i < pFormat->mStreamCount; ++i)
+	{
+		desc.pStreamData[i] = pScratch + scratchOffset;
+		scratchOffset += chunkVertices * pFormat->mStrides[i];
+	}
 
-	for (int i = 0; i < 6; ++i)
+	for (uint32_t row = 0; row < rowCount; row += rowsPerChunk)
 	{
-		for (int x = 0; x < DETAIL_LEVEL; ++x)
+		const uint32_t chunkRows = rowCount - row < rowsPerChunk ? rowCount - row : rowsPerChunk;
+		if (pReadStream)
 		{
-			for (int y = 0; y < DETAIL_LEVEL; ++y)
-			{
-				float* vert = verts[i][x][y];
-				float* sqNorm = sqNormals[i][x][y];
-
-				sqNorm[0] = 0;
-				sqNorm[1] = 0;
-				sqNorm[2] = 0;
-
-				float fx = 2 * (float(x) / float(DETAIL_LEVEL - 1)) - 1;
-				float fy = 2 * (float(y) / float(DETAIL_LEVEL - 1)) - 1;
-
-				switch (i)
-				{
-				case 0:
-					vert[0] = -1, vert[1] = fx, vert[2] = fy;
-					sqNorm[0] = -1;
-					break;
-				case 1:
-					vert[0] = 1, vert[1] = -fx, vert[2] = fy;
-					sqNorm[0] = 1;
-					break;
-				case 2:
-					vert[0] = -fx, vert[1] = fy, vert[2] = 1;
-					sqNorm[2] = 1;
-					break;
-				case 3:
-					vert[0] = fx, vert[1] = fy, vert[2] = -1;
-					sqNorm[2] = -1;
-					break;
-				case 4:
-					vert[0] = fx, vert[1] = 1, vert[2] = fy;
-					sqNorm[1] = 1;
-					break;
-				case 5:
-					vert[0] = -fx, vert[1] = -1, vert[2] = fy;
-					sqNorm[1] = -1;
-					break;
-				}
-
-				compute_normal(vert, sphNormals[i][x][y]);
-			}
+			for (uint32_t i = 0; i < pFormat->mStreamCount; ++i)
+				fsReadFromStream(pReadStream, desc.pStreamData[i], (size_t)chunkRows * detailLevel * pFormat->mStrides[i]);
+		}
+		else
+		{
+			desc.mFirstRow = row;
+			desc.mRowCount = chunkRows;
+			generatePlanetVertices(&desc);
+			for (uint32_t i = 0; pWriteStream && i < pFormat->mStreamCount; ++i)
+				fsWriteToStream(pWriteStream, desc.pStreamData[i], (size_t)chunkRows * detailLevel * pFormat->mStrides[i]);
+		}
+
+		for (uint32_t i = 0; i < pFormat->mStreamCount; ++i)
+		{
+			const uint64_t dstOffset = pStreamOffsets[i] + (uint64_t)row * detailLevel * pFormat->mStrides[i];
+			const uint64_t size = (uint64_t)chunkRows * detailLevel * pFormat->mStrides[i];
+			if (pCpuCopy)
+				memcpy(pCpuCopy + dstOffset, desc.pStreamData[i], (size_t)size);
+			else
+				upload_sphere_buffer_data(pBuffer, dstOffset, desc.pStreamData[i], size);
 		}
 	}
 
-	static uint8_t sqColors[6][DETAIL_LEVEL][DETAIL_LEVEL][3];
-	static uint8_t spColors[6][DETAIL_LEVEL][DETAIL_LEVEL][3];
-	for (int i = 0; i < 6; ++i)
+	tf_free(pScratch);
+}
+
+// The index buffer doesn't depend on the vertex layout, one is shared by every cached mesh of the same detail level.
+// Creates it empty and returns the index size.
+static uint32_t add_sphere_index_buffer(uint32_t detailLevel, bool optimized)
+{
+	const uint32_t indexSize = planetMeshIndexSize(detailLevel);
+	gSphereIndexCount = (uint32_t)planetMeshIndexCount(detailLevel);
+	gSphereIndexType = indexSize == sizeof(uint16_t) ? INDEX_TYPE_UINT16 : INDEX_TYPE_UINT32;
+	gSphereIndexDetailLevel = detailLevel;
+	gSphereIndexOptimized = optimized;
+	add_sphere_buffer(DESCRIPTOR_TYPE_INDEX_BUFFER, (uint64_t)gSphereIndexCount * indexSize, &pSphereIndexBuffer);
+	return indexSize;
+}
+
+// Generates the row-major indices chunk by chunk straight into staging memory.
+static void upload_sphere_indices(Buffer* pBuffer, uint32_t detailLevel)
+{
+	PlanetIndexDesc desc = {};
+	desc.mDetailLevel = detailLevel;
+	desc.mIndexSize = planetMeshIndexSize(detailLevel);
+
+	const uint32_t quadRowCount = planetMeshQuadRowCount(detailLevel);
+	const uint64_t quadRowSize = 6ull * (detailLevel - 1) * desc.mIndexSize;
+	const uint32_t rowsPerChunk = get_rows_per_upload_chunk(quadRowSize);
+	for (uint32_t row = 0; row < quadRowCount; row += rowsPerChunk)
 	{
-		for (int x = 0; x < DETAIL_LEVEL; ++x)
-		{
-			uint8_t spColorTemplate[3] = {
-				uint8_t(randomInt(0, 256)),
-				uint8_t(randomInt(0, 256)),
-				uint8_t(randomInt(0, 256)),
-			};
+		BufferUpdateDesc update = { pBuffer };
+		desc.mFirstQuadRow = row;
+		desc.mQuadRowCount = quadRowCount - row < rowsPerChunk ? quadRowCount - row : rowsPerChunk;
+		update.mDstOffset = row * quadRowSize;
+		update.mSize = desc.mQuadRowCount * quadRowSize;
+		beginUpdateResource(&update);
+		desc.pIndexData = update.pMappedData;
+		generatePlanetIndices(&desc);
+		endUpdateResource(&update);
+	}
+}
 
-			float rx = 1 - abs((float(x) / DETAIL_LEVEL) * 2 - 1);
+// On-disk copy of the vertex data, one file per layout type and detail level. The streams are stored chunk by chunk
+// as build_sphere_vertices() produces them, so the chunk size is part of the format.
+struct SphereMeshFileHeader
+{
+	uint32_t mMagic;
+	uint32_t mVersion;
+	uint32_t mLayoutType;
+	uint32_t mDetailLevel;
+	uint32_t mVertexSize;
+	uint32_t mVertexCount;
+	uint32_t mRowsPerChunk;
+};
 
-			for (int y = 0; y < DETAIL_LEVEL; ++y)
-			{
-				float    ry = 1 - abs((float(y) / DETAIL_LEVEL) * 2 - 1);
-				uint32_t close_ratio = uint32_t(rx * ry * 255);
+static const uint32_t gSphereMeshFileMagic = 0x4853454D; // "MESH"
+static const uint32_t gSphereMeshFileVersion = 3;
+
+static void get_sphere_mesh_file_name(uint32_t layoutType, uint32_t detailLevel, char* pName, size_t nameSize)
+{
+	snprintf(pName, nameSize, "SphereMesh_L%u_D%u.bin", layoutType, detailLevel);
+}
+
+// Opens the cache file for reading and leaves pStream at the vertex data. The header and the file size are validated
+// up front, so the chunked upload can read without checking each chunk.
+static bool open_sphere_mesh_file(uint32_t layoutType, uint32_t detailLevel, uint32_t vertexSize, FileStream* pStream)
+{
+	char fileName[64];
+	get_sphere_mesh_file_name(layoutType, detailLevel, fileName, sizeof(fileName));
+
+	if (!fsOpenStreamFromPath(RD_PIPELINE_CACHE, fileName, FM_READ, pStream))
+		return false;
+
+	const uint64_t       vertexCount = planetMeshVertexCount(detailLevel);
+	SphereMeshFileHeader header = {};
+	if (fsGetStreamFileSize(pStream) == (ssize_t)(sizeof(header) + vertexCount * vertexSize) &&
+		fsReadFromStream(pStream, &header, sizeof(header)) == sizeof(header) && header.mMagic == gSphereMeshFileMagic &&
+		header.mVersion == gSphereMeshFileVersion && header.mLayoutType == layoutType && header.mDetailLevel == detailLevel &&
+		header.mVertexSize == vertexSize && header.mVertexCount == vertexCount &&
+		header.mRowsPerChunk == get_rows_per_upload_chunk((uint64_t)detailLevel * vertexSize))
+		return true;
 
-				uint8_t* sq_color = sqColors[i][x][y];
-				uint8_t* sp_color = spColors[i][x][y];
+	fsCloseStream(pStream);
+	LOGF(LogLevel::eWARNING, "Ignoring stale sphere mesh cache '%s'", fileName);
+	return false;
+}
 
-				sq_color[0] = (uint8_t)((randomInt(0, 256) * close_ratio) / 255);
-				sq_color[1] = (uint8_t)((randomInt(0, 256) * close_ratio) / 255);
-				sq_color[2] = (uint8_t)((randomInt(0, 256) * close_ratio) / 255);
+// Creates the cache file and writes its header, the vertex data is appended chunk by chunk during the upload.
+static bool create_sphere_mesh_file(uint32_t layoutType, uint32_t detailLevel, uint32_t vertexSize, FileStream* pStream)
+{
+	char fileName[64];
+	get_sphere_mesh_file_name(layoutType, detailLevel, fileName, sizeof(fileName));
 
-				sp_color[0] = (uint8_t)((spColorTemplate[0] * close_ratio) / 255);
-				sp_color[1] = (uint8_t)((spColorTemplate[1] * close_ratio) / 255);
-				sp_color[2] = (uint8_t)((spColorTemplate[2] * close_ratio) / 255);
-			}
+	if (!fsOpenStreamFromPath(RD_PIPELINE_CACHE, fileName, FM_WRITE, pStream))
+	{
+		LOGF(LogLevel::eWARNING, "Could not write sphere mesh cache '%s'", fileName);
+		return false;
+	}
+
+	SphereMeshFileHeader header = {};
+	header.mMagic = gSphereMeshFileMagic;
+	header.mVersion = gSphereMeshFileVersion;
+	header.mLayoutType = layoutType;
+	header.mDetailLevel = detailLevel;
+	header.mVertexSize = vertexSize;
+	header.mVertexCount = (uint32_t)planetMeshVertexCount(detailLevel);
+	header.mRowsPerChunk = get_rows_per_upload_chunk((uint64_t)detailLevel * vertexSize);
+	fsWriteToStream(pStream, &header, sizeof(header));
+	return true;
+}
+
+static bool is_sphere_mesh_optimized(uint32_t detailLevel) { return gOptimizeSphereMesh && detailLevel <= gMaxOptimizedSphereDetailLevel; }
+
+// Whole-mesh path of load_sphere_mesh when is_sphere_mesh_optimized(): vertex cache (Tipsify), overdraw and vertex
+// fetch reordering. The overdraw pass reads float3 sphere positions generated on the side, so the index buffer can be
+// rebuilt without the vertices. The vertex remap only depends on the indices, every stream of every layout gets the same
+// permutation and they keep sharing the index buffer. The disk cache holds the vertices before optimization.
+static void load_optimized_sphere_mesh(SphereMesh* pMesh, uint32_t layoutType, uint32_t detailLevel, bool addVertices, bool addIndices,
+									   bool* pFromDisk)
+{
+	const PlanetVertexFormat format = pMesh->mFormat;
+	const uint32_t           vertexCount = (uint32_t)planetMeshVertexCount(detailLevel);
+	const uint32_t           indexCount = (uint32_t)planetMeshIndexCount(detailLevel);
+
+	PlanetVertexFormat positionFormat = {};
+	positionFormat.mStreamCount = 1;
+	positionFormat.mStrides[0] = 3 * sizeof(float);
+	positionFormat.mAttributes[PLANET_ATTRIBUTE_SPHERE_POSITION].mEncoding = PLANET_ENCODING_FLOAT3;
+	const uint64_t positionOffset = 0;
+	float*         pPositions = (float*)tf_malloc(vertexCount * 3 * sizeof(float));
+	build_sphere_vertices(&positionFormat, detailLevel, NULL, NULL, NULL, (uint8_t*)pPositions, &positionOffset);
+
+	uint32_t*       pIndices = (uint32_t*)tf_malloc(indexCount * sizeof(uint32_t));
+	uint32_t*       pOptimized = (uint32_t*)tf_malloc(indexCount * sizeof(uint32_t));
+	PlanetIndexDesc indexDesc = {};
+	indexDesc.mDetailLevel = detailLevel;
+	indexDesc.mIndexSize = sizeof(uint32_t);
+	indexDesc.pIndexData = pIndices;
+	generatePlanetIndices(&indexDesc);
+
+	// Sphere positions, both key frames are convex and the sphere is what most of the morph looks like
+	const VertexCacheStats before = analyzeVertexCache(pIndices, indexCount, vertexCount, VERTEX_CACHE_SIZE);
+	optimizeVertexCache(pOptimized, pIndices, indexCount, vertexCount, VERTEX_CACHE_SIZE);
+	optimizeOverdraw(pOptimized, indexCount, pPositions, 3 * sizeof(float), vertexCount, VERTEX_CACHE_SIZE, 1.05f);
+	uint32_t* pRemap = (uint32_t*)tf_malloc(vertexCount * sizeof(uint32_t));
+	optimizeVertexFetchRemap(pRemap, pOptimized, indexCount, vertexCount);
+	gSphereCacheStats = analyzeVertexCache(pOptimized, indexCount, vertexCount, VERTEX_CACHE_SIZE);
+	tf_free(pPositions);
+
+	bformat(&gSphereMeshStats, "Vertex cache (FIFO %u): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", VERTEX_CACHE_SIZE, before.mAcmr,
+			gSphereCacheStats.mAcmr, before.mAtvr, gSphereCacheStats.mAtvr);
+	LOGF(LogLevel::eINFO, "Sphere mesh detail %u: %s", detailLevel, (const char*)gSphereMeshStats.data);
+
+	*pFromDisk = false;
+	if (addVertices)
+	{
+		const uint64_t vertexDataSize = get_sphere_stream_offsets(&format, vertexCount, pMesh->mStreamOffsets);
+		uint8_t*       pVertices = (uint8_t*)tf_calloc(1, (size_t)vertexDataSize);
+
+		FileStream stream = {};
+		const uint32_t vertexSize = planetVertexSize(&format);
+		*pFromDisk = gUseSphereMeshDiskCache && open_sphere_mesh_file(layoutType, detailLevel, vertexSize, &stream);
+		const bool toDisk = !*pFromDisk && gUseSphereMeshDiskCache && create_sphere_mesh_file(layoutType, detailLevel, vertexSize, &stream);
+		build_sphere_vertices(&format, detailLevel, *pFromDisk ? &stream : NULL, toDisk ? &stream : NULL, NULL, pVertices,
+							  pMesh->mStreamOffsets);
+		if (*pFromDisk || toDisk)
+			fsCloseStream(&stream);
+
+		uint8_t* pRemapped = (uint8_t*)tf_calloc(1, (size_t)vertexDataSize);
+		for (uint32_t i = 0; i < format.mStreamCount; ++i)
+			remapVertexBuffer(pRemapped + pMesh->mStreamOffsets[i], pVertices + pMesh->mStreamOffsets[i], vertexCount, format.mStrides[i],
+							  pRemap);
+		add_sphere_vertex_buffer(pMesh, &format, detailLevel);
+		upload_sphere_buffer_data(pMesh->pVertexBuffer, 0, pRemapped, vertexDataSize);
+		tf_free(pRemapped);
+		tf_free(pVertices);
+	}
+
+	if (addIndices)
+	{
+		const uint32_t indexSize = add_sphere_index_buffer(detailLevel, true);
+		if (indexSize == sizeof(uint16_t))
+		{
+			// In place, each 16-bit index lands at or before the 32-bit one it was read from
+			uint16_t* pNarrow = (uint16_t*)pOptimized;
+			for (uint32_t i = 0; i < indexCount; ++i)
+				pNarrow[i] = (uint16_t)pOptimized[i];
 		}
+		upload_sphere_buffer_data(pSphereIndexBuffer, 0, pOptimized, (uint64_t)indexCount * indexSize);
+	}
+
+	tf_free(pRemap);
+	tf_free(pOptimized);
+	tf_free(pIndices);
+}
+
+static void remove_sphere_lod(SphereLod* pLod)
+{
+	if (pLod->mMesh.pVertexBuffer)
+		removeResource(pLod->mMesh.pVertexBuffer);
+	if (pLod->pIndexBuffer)
+		removeResource(pLod->pIndexBuffer);
+	*pLod = {};
+}
+
+static uint32_t get_sphere_lod_detail_level(uint32_t baseDetailLevel, uint32_t lod)
+{
+	const uint32_t detailLevel = baseDetailLevel >> lod;
+	return detailLevel < 2 ? 2 : detailLevel;
+}
+
+// Builds LOD 1 and up of pBase, the mesh of layoutType, when they are missing or were built from another LOD 0 detail
+// level.
+static void load_sphere_lods(const SphereMesh* pBase, uint32_t layoutType)
+{
+	HiresTimer timer;
+	initHiresTimer(&timer);
+	bool added = false;
+	for (uint32_t lod = 1; lod < gSphereLodCount; ++lod)
+	{
+		SphereLod* pLod = &gSphereLods[layoutType][lod];
+		if (pLod->mMesh.pVertexBuffer && pLod->mBaseDetailLevel == pBase->mDetailLevel)
+			continue;
+		remove_sphere_lod(pLod);
+
+		const uint32_t detailLevel = get_sphere_lod_detail_level(pBase->mDetailLevel, lod);
+		pLod->mBaseDetailLevel = pBase->mDetailLevel;
+		pLod->mMesh.mLayout = pBase->mLayout;
+		pLod->mMesh.mFormat = pBase->mFormat;
+		pLod->mMesh.mDetailLevel = detailLevel;
+		add_sphere_vertex_buffer(&pLod->mMesh, &pLod->mMesh.mFormat, detailLevel);
+		build_sphere_vertices(&pLod->mMesh.mFormat, detailLevel, NULL, NULL, pLod->mMesh.pVertexBuffer, NULL, pLod->mMesh.mStreamOffsets);
+
+		const uint32_t indexSize = planetMeshIndexSize(detailLevel);
+		pLod->mIndexCount = (uint32_t)planetMeshIndexCount(detailLevel);
+		pLod->mIndexType = indexSize == sizeof(uint16_t) ? INDEX_TYPE_UINT16 : INDEX_TYPE_UINT32;
+		add_sphere_buffer(DESCRIPTOR_TYPE_INDEX_BUFFER, (uint64_t)pLod->mIndexCount * indexSize, &pLod->pIndexBuffer);
+		upload_sphere_indices(pLod->pIndexBuffer, detailLevel);
+		added = true;
+	}
+
+	if (added)
+	{
+		waitForAllResourceLoads();
+		LOGF(LogLevel::eINFO, "Sphere LODs of layout %u, detail %u: generated and uploaded in %.2f ms", layoutType, pBase->mDetailLevel,
+			 getHiresTimerUSec(&timer, false) / 1000.0f);
+	}
+}
+
+// Makes the mesh of the given layout current. Only the first use of a layout and detail level generates (or reads from
+// disk) and uploads geometry; after that shader and rendertarget reloads just rebind the resident buffers.
+static void load_sphere_mesh(uint32_t layoutType, uint32_t detailLevel)
+{
+	SphereMesh* pMesh = &gSphereMeshes[layoutType];
+	const bool  optimized = is_sphere_mesh_optimized(detailLevel);
+	// Stale buffers can go right away: either Unload() waited for the queue, or this is a layout switch and a stale mesh
+	// (another detail level) hasn't been drawn since the reload that changed the detail level
+	if (pMesh->pVertexBuffer && (pMesh->mDetailLevel != detailLevel || pMesh->mOptimized != optimized))
+	{
+		removeResource(pMesh->pVertexBuffer);
+		pMesh->pVertexBuffer = NULL;
+	}
+	if (pSphereIndexBuffer && (gSphereIndexDetailLevel != detailLevel || gSphereIndexOptimized != optimized))
+	{
+		removeResource(pSphereIndexBuffer);
+		pSphereIndexBuffer = NULL;
+	}
+
+	HiresTimer timer;
+	initHiresTimer(&timer);
+
+	const bool addVertices = !pMesh->pVertexBuffer;
+	const bool addIndices = !pSphereIndexBuffer;
+	bool       fromDisk = false;
+	if (addVertices)
+	{
+		add_sphere_layout(layoutType, &pMesh->mLayout);
+		pMesh->mFormat = get_planet_vertex_format(&pMesh->mLayout);
+		setPlanetMorphDeltaScales(&pMesh->mFormat, detailLevel);
+		pMesh->mDetailLevel = detailLevel;
+		pMesh->mOptimized = optimized;
 	}
 
-	static uint16_t indices[6][DETAIL_LEVEL - 1][DETAIL_LEVEL - 1][6];
-	for (int i = 0; i < 6; ++i)
+	if (optimized && (addVertices || addIndices))
 	{
-		uint32_t o = DETAIL_LEVEL * DETAIL_LEVEL * i;
-		for (int x = 0; x < DETAIL_LEVEL - 1; ++x)
+		load_optimized_sphere_mesh(pMesh, layoutType, detailLevel, addVertices, addIndices, &fromDisk);
+	}
+	else
+	{
+		if (addVertices)
 		{
-			for (int y = 0; y < DETAIL_LEVEL - 1; ++y)
-			{
-				uint16_t* quadIndices = indices[i][x][y];
-
-#define vid(vx, vy) (o + (vx)*DETAIL_LEVEL + (vy))
-				quadIndices[0] = (uint16_t)vid(x, y);
-				quadIndices[1] = (uint16_t)vid(x, y + 1);
-				quadIndices[2] = (uint16_t)vid(x + 1, y + 1);
-				quadIndices[3] = (uint16_t)vid(x + 1, y + 1);
-				quadIndices[4] = (uint16_t)vid(x + 1, y);
-				quadIndices[5] = (uint16_t)vid(x, y);
-#undef vid
-			}
+			const PlanetVertexFormat format = pMesh->mFormat;
+			const uint32_t           vertexSize = planetVertexSize(&format);
+			add_sphere_vertex_buffer(pMesh, &format, detailLevel);
+
+			FileStream stream = {};
+			fromDisk = gUseSphereMeshDiskCache && open_sphere_mesh_file(layoutType, detailLevel, vertexSize, &stream);
+			const bool toDisk =
+				!fromDisk && gUseSphereMeshDiskCache && create_sphere_mesh_file(layoutType, detailLevel, vertexSize, &stream);
+			build_sphere_vertices(&format, detailLevel, fromDisk ? &stream : NULL, toDisk ? &stream : NULL, pMesh->pVertexBuffer, NULL,
+								  pMesh->mStreamOffsets);
+			if (fromDisk || toDisk)
+				fsCloseStream(&stream);
 		}
+
+		if (addIndices)
+		{
+			add_sphere_index_buffer(detailLevel, false);
+			upload_sphere_indices(pSphereIndexBuffer, detailLevel);
+			gSphereCacheStats = {};
+			bformat(&gSphereMeshStats, "Vertex cache: not optimized%s, streamed row-major order",
+					gOptimizeSphereMesh ? " (detail above the optimizer limit)" : "");
+		}
+	}
+
+	if (addVertices || addIndices)
+	{
+		waitForAllResourceLoads();
+
+		LOGF(LogLevel::eINFO, "Sphere mesh layout %u '%s', detail %u (%llu vertices, %u-bit indices): %s and uploaded in %.2f ms",
+			 layoutType, gSphereLayouts[layoutType].pName, detailLevel, (unsigned long long)planetMeshVertexCount(detailLevel),
+			 planetMeshIndexSize(detailLevel) * 8,
+			 !addVertices ? "indices rebuilt" : (fromDisk ? "read from disk" : "generated"), getHiresTimerUSec(&timer, false) / 1000.0f);
 	}
 
-#undef DETAIL_LEVEL
+	load_sphere_lods(pMesh, layoutType);
 
-	void* bufferData = nullptr;
-	uint32_t vertexCount = sizeof(verts) / 12;
-	size_t   bufferSize;
+	pSphereMesh = pMesh;
+	gCurrentSphereLayoutType = layoutType;
+	gSphereVertexLayout = pMesh->mLayout;
+	const PlanetAttributeFormat* pAttributes = pMesh->mFormat.mAttributes;
+	gUniformData.mMorphDeltaScale =
+		vec4(pAttributes[PLANET_ATTRIBUTE_SPHERE_POSITION].mDeltaScale, pAttributes[PLANET_ATTRIBUTE_SPHERE_NORMAL].mDeltaScale,
+			 pAttributes[PLANET_ATTRIBUTE_OBLATE_POSITION].mDeltaScale, pAttributes[PLANET_ATTRIBUTE_OBLATE_NORMAL].mDeltaScale);
+	bformat(&gSphereLayoutName, "%s", gSphereLayouts[layoutType].pName);
+}
 
-	gSphereVertexLayout.mBindingCount = 1;
+// Makes gSphereLayoutType current without a reload: the pipelines of every layout already exist, and the buffers of
+// the old layout stay resident, so nothing in flight is touched and the GPU isn't waited on. A layout seen before is a
+// pointer swap, a new one builds its mesh and LODs (through the disk cache unless optimized). Left to the pending
+// reload when the detail level or the optimizer setting changed too, as those rebuild the shared index buffer.
+static void switch_sphere_layout()
+{
+	if (gSphereLayoutType >= gSphereLayoutTypeCount)
+		gSphereLayoutType = 0;
+	if (gSphereLayoutType == gCurrentSphereLayoutType || gSphereDetailLevel != gSphereIndexDetailLevel ||
+		is_sphere_mesh_optimized(gSphereDetailLevel) != gSphereIndexOptimized)
+		return;
+
+	HiresTimer timer;
+	initHiresTimer(&timer);
+	const bool resident = gSphereMeshes[gSphereLayoutType].pVertexBuffer != NULL;
+	load_sphere_mesh(gSphereLayoutType, gSphereDetailLevel);
+	LOGF(LogLevel::eINFO, "Switched to vertex layout %u '%s' in %.2f ms (%s)", gSphereLayoutType, gSphereLayouts[gSphereLayoutType].pName,
+		 getHiresTimerUSec(&timer, false) / 1000.0f, resident ? "resident" : "mesh built");
+	allocationTrackerRestartWarmup();
+	frameTimeStatsRestartWarmup();
+}
 
-	switch (gSphereLayoutType)
+static void remove_sphere_meshes()
+{
+	for (uint32_t i = 0; i < gSphereLayoutTypeCount; ++i)
 	{
-	default:
-	case 0:
+		if (gSphereMeshes[i].pVertexBuffer)
+			removeResource(gSphereMeshes[i].pVertexBuffer);
+		gSphereMeshes[i] = {};
+	}
+	if (pSphereIndexBuffer)
+		removeResource(pSphereIndexBuffer);
+	pSphereIndexBuffer = NULL;
+	pSphereMesh = NULL;
+	for (uint32_t i = 0; i < gSphereLayoutTypeCount; ++i)
+	{
+		for (uint32_t lod = 1; lod < gSphereLodCount; ++lod)
+			remove_sphere_lod(&gSphereLods[i][lod]);
+	}
+}
+
+void requestMeshBenchmark(void*) { gRunMeshBenchmark = true; }
+void requestTransformBenchmark(void*) { gRunTransformBenchmark = true; }
+void requestCullingBenchmark(void*) { gRunCullingBenchmark = true; }
+void requestLayoutBenchmark(void*) { gRunLayoutBenchmark = true; }
+void requestFrameTrace(void*) { requestFrameTraceCapture(gFrameTraceFrames, "_VoAcademy.trace.json"); }
+
+static float get_asteroid_ring_radius(uint32_t ring, float bandPosition)
+{
+	return gAsteroidBeltInnerRadius + (ring + bandPosition) * (gAsteroidBeltOuterRadius - gAsteroidBeltInnerRadius) / gAsteroidRingCount;
+}
+
+// Instance drawn for a hierarchy node, UINT32_MAX for planet orbits and asteroid rings.
+static uint32_t get_node_instance(uint32_t node)
+{
+	if (node < gFirstRingNode)
+		return node & 1 ? node / 2 : UINT32_MAX;
+	if (node < gFirstAsteroidNode)
+		return UINT32_MAX;
+	return gNumPlanets + node - gFirstAsteroidNode;
+}
+
+// Transform hierarchy, instance data and instance buffers of the planets and the asteroid belt. Needs gPlanetInfoData.
+static void add_planet_instances()
+{
+	const uint32_t nodeCount = gFirstAsteroidNode + gAsteroidCount;
+	uint32_t*      pParents = (uint32_t*)tf_malloc(nodeCount * sizeof(uint32_t));
+	for (uint32_t i = 0; i < gNumPlanets; ++i)
 	{
-		//  0-12 sq positions,
-		// 12-16 sq colors
-		// 16-28 sq normals
-		// 28-32 sp colors
-		// 32-44 sp positions + sp normals
-
-		gSphereVertexLayout.mBindings[0].mStride = 44;
-		size_t vsize = vertexCount * gSphereVertexLayout.mBindings[0].mStride;
-		bufferSize = vsize;
-		bufferData = tf_calloc(1, bufferSize);
-
-		add_attribute(&gSphereVertexLayout, SEMANTIC_POSITION, TinyImageFormat_R32G32B32_SFLOAT, 0);
-		add_attribute(&gSphereVertexLayout, SEMANTIC_NORMAL, TinyImageFormat_R32G32B32_SFLOAT, 16);
-		add_attribute(&gSphereVertexLayout, SEMANTIC_TEXCOORD1, TinyImageFormat_R32G32B32_SFLOAT, 32);
-		add_attribute(&gSphereVertexLayout, SEMANTIC_TEXCOORD3, TinyImageFormat_R32G32B32_SFLOAT, 32);
-		add_attribute(&gSphereVertexLayout, SEMANTIC_TEXCOORD0, TinyImageFormat_R8G8B8A8_UNORM, 12);
-		add_attribute(&gSphereVertexLayout, SEMANTIC_TEXCOORD2, TinyImageFormat_R8G8B8A8_UNORM, 28);
-
-		copy_attribute(&gSphereVertexLayout, bufferData, 0, 12, vertexCount, verts);
-		copy_attribute(&gSphereVertexLayout, bufferData, 12, 3, vertexCount, sqColors);
-		copy_attribute(&gSphereVertexLayout, bufferData, 16, 12, vertexCount, sqNormals);
-		copy_attribute(&gSphereVertexLayout, bufferData, 28, 3, vertexCount, spColors);
-		copy_attribute(&gSphereVertexLayout, bufferData, 32, 12, vertexCount, sphNormals);
+		pParents[i * 2] = gPlanetInfoData[i].mParentIndex > 0 ? gPlanetInfoData[i].mParentIndex * 2 : TRANSFORM_NO_PARENT;
+		pParents[i * 2 + 1] = i * 2;
 	}
-	break;
-	case 1:
+	for (uint32_t i = 0; i < gAsteroidRingCount; ++i)
+		pParents[gFirstRingNode + i] = 0; // sun orbit
+	for (uint32_t i = 0; i < gAsteroidCount; ++i)
+		pParents[gFirstAsteroidNode + i] = gFirstRingNode + i % gAsteroidRingCount;
+
+	TransformHierarchyDesc transformDesc = {};
+	transformDesc.mNodeCount = nodeCount;
+	transformDesc.pParents = pParents;
+	transformDesc.mThreadSystem = gThreadSystem;
+	initTransformHierarchy(&transformDesc, &gPlanetTransforms);
+	tf_free(pParents);
+
+	gInstanceCount = gNumPlanets + gAsteroidCount;
+	pInstanceData = (InstanceData*)tf_memalign(alignof(InstanceData), gInstanceCount * sizeof(InstanceData));
+	memset(pInstanceData, 0, gInstanceCount * sizeof(InstanceData));
+	pInstanceUploads = (uint8_t*)tf_malloc(gInstanceCount);
+	memset(pInstanceUploads, gDataBufferCount, gInstanceCount);
+	pInstanceBounds = (float*)tf_calloc((size_t)gInstanceCount * 4, sizeof(float));
+	pVisibleInstances = (uint32_t*)tf_malloc(gInstanceCount * sizeof(uint32_t));
+	pInstanceLods = (uint8_t*)tf_calloc(gInstanceCount, sizeof(uint8_t));
+	pDrawInstances = (uint32_t*)tf_malloc(gInstanceCount * sizeof(uint32_t));
+
+	// Asteroids keep their place on the ring, only the rings turn
+	for (uint32_t i = 0; i < gAsteroidCount; ++i)
 	{
-		//  0-12 sq positions,
-		// 16-28 sq normals
-		// 32-34 sq colors
-		// 36-40 sp colors
-		// 48-62 sp positions
-		// 64-76 sp normals
-
-		gSphereVertexLayout.mBindings[0].mStride = 80;
-		size_t vsize = vertexCount * gSphereVertexLayout.mBindings[0].mStride;
-		bufferSize = vsize;
-		bufferData = tf_calloc(1, bufferSize);
-
-		add_attribute(&gSphereVertexLayout, SEMANTIC_POSITION, TinyImageFormat_R32G32B32_SFLOAT, 0);
-		add_attribute(&gSphereVertexLayout, SEMANTIC_NORMAL, TinyImageFormat_R32G32B32_SFLOAT, 16);
-		add_attribute(&gSphereVertexLayout, SEMANTIC_TEXCOORD1, TinyImageFormat_R32G32B32_SFLOAT, 48);
-		add_attribute(&gSphereVertexLayout, SEMANTIC_TEXCOORD3, TinyImageFormat_R32G32B32_SFLOAT, 64);
-		add_attribute(&gSphereVertexLayout, SEMANTIC_TEXCOORD0, TinyImageFormat_R8G8B8A8_UNORM, 32);
-		add_attribute(&gSphereVertexLayout, SEMANTIC_TEXCOORD2, TinyImageFormat_R8G8B8A8_UNORM, 36);
-
-		copy_attribute(&gSphereVertexLayout, bufferData, 0, 12, vertexCount, verts);
-		copy_attribute(&gSphereVertexLayout, bufferData, 16, 12, vertexCount, sqNormals);
-		copy_attribute(&gSphereVertexLayout, bufferData, 36, 3, vertexCount, spColors);
-		copy_attribute(&gSphereVertexLayout, bufferData, 32, 3, vertexCount, sqColors);
-		copy_attribute(&gSphereVertexLayout, bufferData, 48, 12, vertexCount, sphNormals);
-		copy_attribute(&gSphereVertexLayout, bufferData, 64, 12, vertexCount, sphNormals);
+		const float radius = get_asteroid_ring_radius(i % gAsteroidRingCount, randomFloat(0.0f, 1.0f));
+		const float angle = randomFloat(0.0f, 2.0f * PI);
+		const Quat  rotation = Quat::rotationY(randomFloat(0.0f, 2.0f * PI)) * Quat::rotationX(randomFloat(0.0f, 2.0f * PI));
+		const float positionData[3] = { radius * cosf(angle), randomFloat(-0.6f, 0.6f), radius * sinf(angle) };
+		const float rotationData[4] = { rotation.getX(), rotation.getY(), rotation.getZ(), rotation.getW() };
+		setTransformLocal(&gPlanetTransforms, gFirstAsteroidNode + i, positionData, rotationData, randomFloat(0.05f, 0.15f));
+
+		const float   brightness = randomFloat(0.25f, 0.5f);
+		InstanceData* pInstance = &pInstanceData[gNumPlanets + i];
+		pInstance->mColor = vec4(brightness, brightness * 0.9f, brightness * 0.8f, 1.0f);
+		pInstance->mGeometryWeight[0] = randomFloat(0.3f, 1.0f);
 	}
-	break;
+
+	BufferLoadDesc instanceDesc = {};
+	instanceDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+	instanceDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+	instanceDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+	instanceDesc.mDesc.mFirstElement = 0;
+	instanceDesc.mDesc.mElementCount = gInstanceCount;
+	instanceDesc.mDesc.mStructStride = sizeof(InstanceData);
+	instanceDesc.mDesc.mSize = (uint64_t)gInstanceCount * sizeof(InstanceData);
+	instanceDesc.mDesc.pName = "InstanceBuffer";
+	instanceDesc.pData = NULL;
+	for (uint32_t i = 0; i < gDataBufferCount; ++i)
+	{
+		instanceDesc.ppBuffer = &pInstanceBuffer[i];
+		addResource(&instanceDesc, NULL);
 	}
 
-	gSphereIndexCount = sizeof(indices) / sizeof(uint16_t);
+	BufferLoadDesc visibleDesc = instanceDesc;
+	visibleDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
+	visibleDesc.mDesc.mElementCount = 0;
+	visibleDesc.mDesc.mStructStride = 0;
+	visibleDesc.mDesc.mSize = (uint64_t)gInstanceCount * sizeof(uint32_t);
+	visibleDesc.mDesc.pName = "VisibleInstanceBuffer";
+	for (uint32_t i = 0; i < gDataBufferCount; ++i)
+	{
+		visibleDesc.ppBuffer = &pVisibleInstanceBuffer[i];
+		addResource(&visibleDesc, NULL);
+	}
+}
 
-	BufferLoadDesc sphereVbDesc = {};
-	sphereVbDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
-	sphereVbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-	sphereVbDesc.mDesc.mSize = bufferSize;
-	sphereVbDesc.pData = bufferData;
-	sphereVbDesc.ppBuffer = &pSphereVertexBuffer;
-	addResource(&sphereVbDesc, nullptr);
+// Fills pVisibleInstances with the instances among the first instanceCount whose bounds intersect the view frustum.
+static void cull_instances(const mat4& viewProjection, uint32_t instanceCount)
+{
+	if (!gFrustumCulling)
+	{
+		for (uint32_t i = 0; i < instanceCount; ++i)
+			pVisibleInstances[i] = i;
+		gVisibleInstanceCount = instanceCount;
+		return;
+	}
 
-	BufferLoadDesc sphereIbDesc = {};
-	sphereIbDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_INDEX_BUFFER;
-	sphereIbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-	sphereIbDesc.mDesc.mSize = sizeof(indices);
-	sphereIbDesc.pData = indices;
-	sphereIbDesc.ppBuffer = &pSphereIndexBuffer;
-	addResource(&sphereIbDesc, nullptr);
+	float matrix[16];
+	for (uint32_t column = 0; column < 4; ++column)
+	{
+		for (uint32_t row = 0; row < 4; ++row)
+			matrix[column * 4 + row] = viewProjection.getElem(column, row);
+	}
+	FrustumPlanes frustum;
+	extractFrustumPlanes(matrix, &frustum);
+	gVisibleInstanceCount = cullSpheres(&frustum, pInstanceBounds, pInstanceBounds + gInstanceCount, pInstanceBounds + gInstanceCount * 2,
+										pInstanceBounds + gInstanceCount * 3, instanceCount, pVisibleInstances);
+}
 
-	waitForAllResourceLoads();
+// Picks the LOD of every visible instance from its projected radius in pixels and sorts them into pDrawInstances by
+// LOD. pixelsPerUnit is the screen size of one world unit at distance 1.
+static void select_instance_lods(const vec3& eye, float pixelsPerUnit)
+{
+	// Minimum projected radius per LOD: its vertices per cube face edge, gLodVertexSpacing pixels apart
+	float minRadius[gSphereLodCount];
+	for (uint32_t lod = 0; lod < gSphereLodCount; ++lod)
+		minRadius[lod] = gLodVertexSpacing * get_sphere_lod_detail_level(pSphereMesh->mDetailLevel, lod);
 
-	tf_free(bufferData);
+	uint32_t counts[gSphereLodCount] = {};
+	for (uint32_t v = 0; v < gVisibleInstanceCount; ++v)
+	{
+		const uint32_t i = pVisibleInstances[v];
+		const float    dx = pInstanceBounds[i] - eye.getX();
+		const float    dy = pInstanceBounds[gInstanceCount + i] - eye.getY();
+		const float    dz = pInstanceBounds[gInstanceCount * 2 + i] - eye.getZ();
+		const float    distance = sqrtf(dx * dx + dy * dy + dz * dz);
+		const float    radius = pInstanceBounds[gInstanceCount * 3 + i] * pixelsPerUnit / (distance > 0.001f ? distance : 0.001f);
+
+		const uint32_t current = pInstanceLods[i];
+		uint32_t       lod = 0;
+		for (; lod < gSphereLodCount - 1; ++lod)
+		{
+			const float hysteresis = lod < current ? 1.0f + gLodHysteresis : (lod == current ? 1.0f - gLodHysteresis : 1.0f);
+			if (radius >= minRadius[lod] * hysteresis)
+				break;
+		}
+		pInstanceLods[i] = (uint8_t)lod;
+		++counts[lod];
+	}
+
+	uint32_t first = 0;
+	for (uint32_t lod = 0; lod < gSphereLodCount; ++lod)
+	{
+		gLodInstanceCounts[lod] = counts[lod];
+		gLodFirstInstances[lod] = first;
+		counts[lod] = first;
+		first += gLodInstanceCounts[lod];
+	}
+	for (uint32_t v = 0; v < gVisibleInstanceCount; ++v)
+		pDrawInstances[counts[pInstanceLods[pVisibleInstances[v]]]++] = pVisibleInstances[v];
+}
+
+static void remove_planet_instances()
+{
+	for (uint32_t i = 0; i < gDataBufferCount; ++i)
+	{
+		removeResource(pInstanceBuffer[i]);
+		removeResource(pVisibleInstanceBuffer[i]);
+	}
+	tf_free(pInstanceData);
+	tf_free(pInstanceUploads);
+	tf_free(pInstanceBounds);
+	tf_free(pVisibleInstances);
+	tf_free(pInstanceLods);
+	tf_free(pDrawInstances);
+	pInstanceData = NULL;
+	pInstanceUploads = NULL;
+	pInstanceBounds = NULL;
+	pVisibleInstances = NULL;
+	pInstanceLods = NULL;
+	pDrawInstances = NULL;
+	exitTransformHierarchy(&gPlanetTransforms);
+}
+
+static void write_layout_benchmark_csv()
+{
+	FileStream stream = {};
+	if (!fsOpenStreamFromPath(RD_DEBUG, "VertexLayoutBenchmark.csv", FM_WRITE, &stream))
+	{
+		LOGF(LogLevel::eWARNING, "Could not write VertexLayoutBenchmark.csv");
+		return;
+	}
+
+	char line[256];
+	int  length = snprintf(line, sizeof(line),
+						   "layout,name,vertex_bytes,streams,gpu_ms,vs_invocations,ps_invocations,ia_primitives,clipper_primitives\n");
+	fsWriteToStream(&stream, line, (size_t)length);
+	for (uint32_t i = 0; i < gSphereLayoutTypeCount; ++i)
+	{
+		const SphereLayoutDesc*      pDesc = &gSphereLayouts[i];
+		const LayoutBenchmarkResult* pResult = &gLayoutBenchmarkResults[i];
+		uint32_t                     vertexBytes = 0;
+		for (uint32_t binding = 0; binding < pDesc->mBindingCount; ++binding)
+			vertexBytes += pDesc->mStrides[binding];
+
+		length = snprintf(line, sizeof(line), "%u,\"%s\",%u,%u,%.4f,%llu,%llu,%llu,%llu\n", i, pDesc->pName, vertexBytes,
+						  pDesc->mBindingCount, pResult->mGpuMs / gLayoutBenchmarkFrames,
+						  (unsigned long long)(pResult->mVSInvocations / gLayoutBenchmarkFrames),
+						  (unsigned long long)(pResult->mPSInvocations / gLayoutBenchmarkFrames),
+						  (unsigned long long)(pResult->mIAPrimitives / gLayoutBenchmarkFrames),
+						  (unsigned long long)(pResult->mCPrimitives / gLayoutBenchmarkFrames));
+		fsWriteToStream(&stream, line, (size_t)length);
+		LOGF(LogLevel::eINFO, "Vertex layout %u '%s': %.4f ms GPU", i, pDesc->pName, pResult->mGpuMs / gLayoutBenchmarkFrames);
+	}
+	fsCloseStream(&stream);
+}
+
+// Called once per frame from Update(), switches to the next layout once the current one has been measured.
+static void update_layout_benchmark()
+{
+	if (gRunLayoutBenchmark && !gLayoutBenchmarkActive)
+	{
+		gRunLayoutBenchmark = false;
+		gLayoutBenchmarkActive = true;
+		gLayoutBenchmarkRestoreType = gSphereLayoutType;
+		memset(gLayoutBenchmarkResults, 0, sizeof(gLayoutBenchmarkResults));
+		gLayoutBenchmarkFrame = 0;
+		gSphereLayoutType = 0;
+		return;
+	}
+
+	if (!gLayoutBenchmarkActive || ++gLayoutBenchmarkFrame < gLayoutBenchmarkWarmupFrames + gLayoutBenchmarkFrames)
+		return;
+
+	gLayoutBenchmarkFrame = 0;
+	if (++gSphereLayoutType == gSphereLayoutTypeCount)
+	{
+		write_layout_benchmark_csv();
+		gLayoutBenchmarkActive = false;
+		gSphereLayoutType = gLayoutBenchmarkRestoreType;
+		if (gExitAfterLayoutBenchmark)
+			requestShutdown();
+	}
 }
 
 class Transformations : public IApp
@@ -406,11 +1299,52 @@ class Transformations : public IApp
 public:
 	bool Init()
 	{
+		initStartupTrace();
+		startupTraceBegin("Init");
+
+		// Steady state Update()/Draw() must not allocate; "--alloc-guard" turns that into a hard failure.
+		AllocationTrackerSettings allocationSettings = {};
+		allocationSettings.mEnabled = true;
+		allocationSettings.mFailOnAllocation = hasCommandLineFlag(IApp::argc, IApp::argv, "--alloc-guard");
+		allocationSettings.mWarmupFrames = 60;
+		initAllocationTracker(&allocationSettings);
+
+		// Frame time percentiles and hitches in the UI, hitches logged with their scope breakdown, and a summary of the
+		// whole run in Debug/_VoAcademy.frametimes.csv at exit.
+		FrameTimeStatsSettings frameTimeSettings = {};
+		frameTimeSettings.mHitchThresholdMs = 33.3f;
+		frameTimeSettings.mWarmupFrames = 60;
+		frameTimeSettings.mWindowFrames = FRAME_TIME_MAX_WINDOW_FRAMES;
+		initFrameTimeStats(&frameTimeSettings);
+
+		gExitAfterLayoutBenchmark = hasCommandLineFlag(IApp::argc, IApp::argv, "--layout-benchmark");
+		gRunLayoutBenchmark = gExitAfterLayoutBenchmark;
+		gAsteroidCount = getCommandLineUint(IApp::argc, IApp::argv, "--asteroids", gAsteroidCount);
+		const char* pScenarioFile = getCommandLineString(IApp::argc, IApp::argv, "--scenario");
+		if (pScenarioFile)
+		{
+			if (!loadBenchmarkScenario(pScenarioFile, &gScenario))
+				return false;
+			gAsteroidCount = getScenarioUint(&gScenario, "asteroids", gAsteroidCount);
+			gDrawAsteroidBelt = getScenarioUint(&gScenario, "belt", gDrawAsteroidBelt) != 0;
+			gSphereLayoutType = getScenarioUint(&gScenario, "layout", gSphereLayoutType);
+			const uint32_t detailLevel = getScenarioUint(&gScenario, "detail", gSphereDetailLevel);
+			gSphereDetailLevel = detailLevel < 2 ? 2 : (detailLevel > gMaxSphereDetailLevel ? gMaxSphereDetailLevel : detailLevel);
+			gDrawSkyBoxFaces = getScenarioUint(&gScenario, "skybox_faces", gDrawSkyBoxFaces) != 0;
+			mSettings.mVSyncEnabled = false;
+			for (uint32_t i = 0; i < SCENARIO_METRIC_COUNT; ++i)
+				addBenchmarkMetric(&gScenario, gScenarioMetricNames[i]);
+		}
+
 		// window and renderer setup
 		RendererDesc settings;
 		memset(&settings, 0, sizeof(settings));
+		startupTraceBegin("GPU configuration");
 		initGPUConfiguration(settings.pExtendedSettings);
+		startupTraceEnd();
+		startupTraceBegin("Renderer");
 		initRenderer(GetName(), &settings, &pRenderer);
+		startupTraceEnd();
 		// check for init success
 		if (!pRenderer)
 		{
@@ -419,21 +1353,21 @@ public:
 		}
 		setupGPUConfigurationPlatformParameters(pRenderer, settings.pExtendedSettings);
 
-		if (pRenderer->pGpu->mPipelineStatsQueries)
-		{
-			QueryPoolDesc poolDesc = {};
-			poolDesc.mQueryCount = 3; // The count is 3 due to quest & multi-view use otherwise 2 is enough as we use 2 queries.
-			poolDesc.mType = QUERY_TYPE_PIPELINE_STATISTICS;
-			for (uint32_t i = 0; i < gDataBufferCount; ++i)
-			{
-				initQueryPool(pRenderer, &poolDesc, &pPipelineStatsQueryPool[i]);
-			}
-		}
+		startupTraceBegin("Queries, queue and command ring");
 
 		QueueDesc queueDesc = {};
 		queueDesc.mType = QUEUE_TYPE_GRAPHICS;
 		queueDesc.mFlag = QUEUE_FLAG_INIT_MICROPROFILE;
 		initQueue(pRenderer, &queueDesc, &pGraphicsQueue);
+		initFrameTrace(pRenderer, pGraphicsQueue, gDataBufferCount);
+		initPassMetrics(pRenderer, pGraphicsQueue, gDataBufferCount);
+		gScenePass = addMetricsPass("Draw Skybox/Planets", PASS_METRICS_ALL);
+		gSkyBoxPasses[SKYBOX_PATH_CUBE] = addMetricsPass("Draw Skybox (cube map)", PASS_METRICS_TIMESTAMPS);
+		gSkyBoxPasses[SKYBOX_PATH_FACES] = addMetricsPass("Draw Skybox (six faces)", PASS_METRICS_TIMESTAMPS);
+		gUIPass = addMetricsPass("Draw UI", PASS_METRICS_ALL);
+		const uint32_t startupTraceFrames = getCommandLineUint(IApp::argc, IApp::argv, "--frame-trace", 0);
+		if (startupTraceFrames)
+			requestFrameTraceCapture(startupTraceFrames, "_VoAcademy.trace.json");
 
 		GpuCmdRingDesc cmdRingDesc = {};
 		cmdRingDesc.pQueue = pGraphicsQueue;
@@ -443,12 +1377,31 @@ public:
 		initGpuCmdRing(pRenderer, &cmdRingDesc, &gGraphicsCmdRing);
 
 		initSemaphore(pRenderer, &pImageAcquiredSemaphore);
+		startupTraceEnd();
 
+		startupTraceBegin("Resource loader");
 		initResourceLoaderInterface(pRenderer);
+		startupTraceEnd();
+
+		// "--no-pipeline-cache" creates every pipeline cold, to compare against a warm start
+		startupTraceBegin("Pipeline cache");
+		const bool pipelineCacheEnabled = !hasCommandLineFlag(IApp::argc, IApp::argv, "--no-pipeline-cache");
+		loadPipelineCacheFile(pRenderer, "_VoAcademy.cache", pipelineCacheEnabled, &gPipelineCache);
+		startupTraceEnd();
 
+		startupTraceBegin("Thread system");
+		ThreadSystemInitDesc threadSystemDesc = {};
+		threadSystemDesc.mThreadCount = getScenarioUint(&gScenario, "threads", 0);
+		initThreadSystem(&threadSystemDesc, &gThreadSystem);
+		startupTraceEnd();
+
+		startupTraceBegin("Root signature");
 		RootSignatureDesc rootDesc = {};
 		INIT_RS_DESC(rootDesc, "default.rootsig", "compute.rootsig");
 		initRootSignature(pRenderer, &rootDesc);
+		startupTraceEnd();
+
+		startupTraceBegin("Skybox and uniform resource requests");
 
 		SamplerDesc samplerDesc = { FILTER_LINEAR,
 									FILTER_LINEAR,
@@ -458,16 +1411,20 @@ public:
 									ADDRESS_MODE_CLAMP_TO_EDGE };
 		addSampler(pRenderer, &samplerDesc, &pSkyBoxSampler);
 
-		// Loads Skybox Textures
-		for (int i = 0; i < 6; ++i)
-		{
-			TextureLoadDesc textureDesc = {};
-			textureDesc.pFileName = pSkyBoxImageFileNames[i];
-			textureDesc.ppTexture = &pSkyBoxTextures[i];
-			// Textures representing color should be stored in SRGB or HDR format
-			textureDesc.mCreationFlag = TEXTURE_CREATION_FLAG_SRGB;
-			addResource(&textureDesc, NULL);
-		}
+		// Skybox textures are requested at the end of the first Load(), the placeholder is a dark night sky until then
+		const uint8_t skyBoxPlaceholder[4] = { 4, 5, 12, 255 };
+		initTextureStreamer(&gSkyBoxStreamer, skyBoxPlaceholder);
+		addSkyBoxCube(1);
+
+		float          skyBoxCubeBuildPoints[6 * 3 * 8];
+		BufferLoadDesc skyBoxCubeBuildVbDesc = {};
+		fill_skybox_cube_build_points(skyBoxCubeBuildPoints);
+		skyBoxCubeBuildVbDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
+		skyBoxCubeBuildVbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+		skyBoxCubeBuildVbDesc.mDesc.mSize = sizeof(skyBoxCubeBuildPoints);
+		skyBoxCubeBuildVbDesc.pData = skyBoxCubeBuildPoints;
+		skyBoxCubeBuildVbDesc.ppBuffer = &pSkyBoxCubeBuildVertexBuffer;
+		addResource(&skyBoxCubeBuildVbDesc, NULL);
 
 		uint64_t       skyBoxDataSize = 4 * 6 * 6 * sizeof(float);
 		BufferLoadDesc skyboxVbDesc = {};
@@ -490,8 +1447,10 @@ public:
 			ubDesc.ppBuffer = &pUniformBuffer[i];
 			addResource(&ubDesc, NULL);
 		}
+		startupTraceEnd();
 
 		// Load fonts
+		startupTraceBegin("Font system");
 		FontDesc font = {};
 		font.pFontPath = "TitilliumText/TitilliumText-Bold.otf";
 		fntDefineFonts(&font, 1, &gFontID);
@@ -500,19 +1459,24 @@ public:
 		fontRenderDesc.pRenderer = pRenderer;
 		if (!initFontSystem(&fontRenderDesc))
 			return false; // report?
+		startupTraceEnd();
 
 		// Initialize Forge User Interface Rendering
+		startupTraceBegin("User interface");
 		UserInterfaceDesc uiRenderDesc = {};
 		uiRenderDesc.pRenderer = pRenderer;
 		initUserInterface(&uiRenderDesc);
+		startupTraceEnd();
 
 		// Initialize micro profiler and its UI.
+		startupTraceBegin("Profiler");
 		ProfilerDesc profiler = {};
 		profiler.pRenderer = pRenderer;
 		initProfiler(&profiler);
 
 		// Gpu profiler can only be added after initProfile.
 		gGpuProfileToken = initGpuProfiler(pRenderer, pGraphicsQueue, "Graphics");
+		startupTraceEnd();
 
 		const uint32_t numScripts = TF_ARRAY_COUNT(gWindowTestScripts);
 		LuaScriptDesc  scriptDescs[numScripts] = {};
@@ -524,7 +1488,7 @@ public:
 			scriptDescs[i].pScriptFileName = mSettings.mBenchmarking ? gWindowTestScripts[i] : gReloadServerTestScripts[i];
 		DEFINE_LUA_SCRIPTS(scriptDescs, numScriptsFinal);
 
-		waitForAllResourceLoads();
+		startupTraceWaitForLoads();
 
 		// Setup planets (Rotation speeds are relative to Earth's, some values randomly given)
 		// Sun
@@ -532,8 +1496,8 @@ public:
 		gPlanetInfoData[0].mYOrbitSpeed = 0; // Earth years for one orbit
 		gPlanetInfoData[0].mZOrbitSpeed = 0;
 		gPlanetInfoData[0].mRotationSpeed = 24.0f; // Earth days for one rotation
-		gPlanetInfoData[0].mTranslationMat = mat4::identity();
-		gPlanetInfoData[0].mScaleMat = mat4::scale(vec3(10.0f));
+		gPlanetInfoData[0].mTranslation = vec3(0.0f);
+		gPlanetInfoData[0].mScale = 10.0f;
 		gPlanetInfoData[0].mColor = vec4(0.97f, 0.38f, 0.09f, 0.0f);
 		gPlanetInfoData[0].mMorphingSpeed = 0.2f;
 
@@ -542,8 +1506,8 @@ public:
 		gPlanetInfoData[1].mYOrbitSpeed = 0.5f;
 		gPlanetInfoData[1].mZOrbitSpeed = 0.0f;
 		gPlanetInfoData[1].mRotationSpeed = 58.7f;
-		gPlanetInfoData[1].mTranslationMat = mat4::translation(vec3(10.0f, 0, 0));
-		gPlanetInfoData[1].mScaleMat = mat4::scale(vec3(1.0f));
+		gPlanetInfoData[1].mTranslation = vec3(10.0f, 0, 0);
+		gPlanetInfoData[1].mScale = 1.0f;
 		gPlanetInfoData[1].mColor = vec4(0.45f, 0.07f, 0.006f, 1.0f);
 		gPlanetInfoData[1].mMorphingSpeed = 5;
 
@@ -552,8 +1516,8 @@ public:
 		gPlanetInfoData[2].mYOrbitSpeed = 0.8f;
 		gPlanetInfoData[2].mZOrbitSpeed = 0.0f;
 		gPlanetInfoData[2].mRotationSpeed = 243.0f;
-		gPlanetInfoData[2].mTranslationMat = mat4::translation(vec3(20.0f, 0, 5));
-		gPlanetInfoData[2].mScaleMat = mat4::scale(vec3(2));
+		gPlanetInfoData[2].mTranslation = vec3(20.0f, 0, 5);
+		gPlanetInfoData[2].mScale = 2;
 		gPlanetInfoData[2].mColor = vec4(0.6f, 0.32f, 0.006f, 1.0f);
 		gPlanetInfoData[2].mMorphingSpeed = 1;
 
@@ -562,8 +1526,8 @@ public:
 		gPlanetInfoData[3].mYOrbitSpeed = 1.0f;
 		gPlanetInfoData[3].mZOrbitSpeed = 0.0f;
 		gPlanetInfoData[3].mRotationSpeed = 1.0f;
-		gPlanetInfoData[3].mTranslationMat = mat4::translation(vec3(30.0f, 0, 0));
-		gPlanetInfoData[3].mScaleMat = mat4::scale(vec3(4));
+		gPlanetInfoData[3].mTranslation = vec3(30.0f, 0, 0);
+		gPlanetInfoData[3].mScale = 4;
 		gPlanetInfoData[3].mColor = vec4(0.07f, 0.028f, 0.61f, 1.0f);
 		gPlanetInfoData[3].mMorphingSpeed = 1;
 
@@ -572,8 +1536,8 @@ public:
 		gPlanetInfoData[4].mYOrbitSpeed = 2.0f;
 		gPlanetInfoData[4].mZOrbitSpeed = 0.0f;
 		gPlanetInfoData[4].mRotationSpeed = 1.1f;
-		gPlanetInfoData[4].mTranslationMat = mat4::translation(vec3(40.0f, 0, 0));
-		gPlanetInfoData[4].mScaleMat = mat4::scale(vec3(3));
+		gPlanetInfoData[4].mTranslation = vec3(40.0f, 0, 0);
+		gPlanetInfoData[4].mScale = 3;
 		gPlanetInfoData[4].mColor = vec4(0.79f, 0.07f, 0.006f, 1.0f);
 		gPlanetInfoData[4].mMorphingSpeed = 1;
 
@@ -582,8 +1546,8 @@ public:
 		gPlanetInfoData[5].mYOrbitSpeed = 11.0f;
 		gPlanetInfoData[5].mZOrbitSpeed = 0.0f;
 		gPlanetInfoData[5].mRotationSpeed = 0.4f;
-		gPlanetInfoData[5].mTranslationMat = mat4::translation(vec3(50.0f, 0, 0));
-		gPlanetInfoData[5].mScaleMat = mat4::scale(vec3(8));
+		gPlanetInfoData[5].mTranslation = vec3(50.0f, 0, 0);
+		gPlanetInfoData[5].mScale = 8;
 		gPlanetInfoData[5].mColor = vec4(0.32f, 0.13f, 0.13f, 1);
 		gPlanetInfoData[5].mMorphingSpeed = 6;
 
@@ -592,8 +1556,8 @@ public:
 		gPlanetInfoData[6].mYOrbitSpeed = 29.4f;
 		gPlanetInfoData[6].mZOrbitSpeed = 0.0f;
 		gPlanetInfoData[6].mRotationSpeed = 0.5f;
-		gPlanetInfoData[6].mTranslationMat = mat4::translation(vec3(60.0f, 0, 0));
-		gPlanetInfoData[6].mScaleMat = mat4::scale(vec3(6));
+		gPlanetInfoData[6].mTranslation = vec3(60.0f, 0, 0);
+		gPlanetInfoData[6].mScale = 6;
 		gPlanetInfoData[6].mColor = vec4(0.45f, 0.45f, 0.21f, 1.0f);
 		gPlanetInfoData[6].mMorphingSpeed = 1;
 
@@ -602,8 +1566,8 @@ public:
 		gPlanetInfoData[7].mYOrbitSpeed = 84.07f;
 		gPlanetInfoData[7].mZOrbitSpeed = 0.0f;
 		gPlanetInfoData[7].mRotationSpeed = 0.8f;
-		gPlanetInfoData[7].mTranslationMat = mat4::translation(vec3(70.0f, 0, 0));
-		gPlanetInfoData[7].mScaleMat = mat4::scale(vec3(7));
+		gPlanetInfoData[7].mTranslation = vec3(70.0f, 0, 0);
+		gPlanetInfoData[7].mScale = 7;
 		gPlanetInfoData[7].mColor = vec4(0.13f, 0.13f, 0.32f, 1.0f);
 		gPlanetInfoData[7].mMorphingSpeed = 1;
 
@@ -612,8 +1576,8 @@ public:
 		gPlanetInfoData[8].mYOrbitSpeed = 164.81f;
 		gPlanetInfoData[8].mZOrbitSpeed = 0.0f;
 		gPlanetInfoData[8].mRotationSpeed = 0.9f;
-		gPlanetInfoData[8].mTranslationMat = mat4::translation(vec3(80.0f, 0, 0));
-		gPlanetInfoData[8].mScaleMat = mat4::scale(vec3(8));
+		gPlanetInfoData[8].mTranslation = vec3(80.0f, 0, 0);
+		gPlanetInfoData[8].mScale = 8;
 		gPlanetInfoData[8].mColor = vec4(0.21f, 0.028f, 0.79f, 1.0f);
 		gPlanetInfoData[8].mMorphingSpeed = 1;
 
@@ -622,8 +1586,8 @@ public:
 		gPlanetInfoData[9].mYOrbitSpeed = 247.7f;
 		gPlanetInfoData[9].mZOrbitSpeed = 1.0f;
 		gPlanetInfoData[9].mRotationSpeed = 7.0f;
-		gPlanetInfoData[9].mTranslationMat = mat4::translation(vec3(90.0f, 0, 0));
-		gPlanetInfoData[9].mScaleMat = mat4::scale(vec3(1.0f));
+		gPlanetInfoData[9].mTranslation = vec3(90.0f, 0, 0);
+		gPlanetInfoData[9].mScale = 1.0f;
 		gPlanetInfoData[9].mColor = vec4(0.45f, 0.21f, 0.21f, 1.0f);
 		gPlanetInfoData[9].mMorphingSpeed = 1;
 
@@ -632,8 +1596,8 @@ public:
 		gPlanetInfoData[10].mYOrbitSpeed = 1.0f;
 		gPlanetInfoData[10].mZOrbitSpeed = 200.0f;
 		gPlanetInfoData[10].mRotationSpeed = 27.0f;
-		gPlanetInfoData[10].mTranslationMat = mat4::translation(vec3(5.0f, 0, 0));
-		gPlanetInfoData[10].mScaleMat = mat4::scale(vec3(1));
+		gPlanetInfoData[10].mTranslation = vec3(5.0f, 0, 0);
+		gPlanetInfoData[10].mScale = 1;
 		gPlanetInfoData[10].mColor = vec4(0.07f, 0.07f, 0.13f, 1.0f);
 		gPlanetInfoData[10].mMorphingSpeed = 1;
 
@@ -643,12 +1607,17 @@ public:
 
 		pCameraController = initFpsCameraController(camPos, lookAt);
 
+		startupTraceBegin("Planet instances");
+		add_planet_instances();
+		startupTraceEnd();
+
 		pCameraController->setMotionParameters(cmp);
 
 		AddCustomInputBindings();
 		initScreenshotCapturer(pRenderer, pGraphicsQueue, GetName());
 		gFrameIndex = 0;
 
+		startupTraceEnd(); // Init
 		return true;
 	}
 
@@ -658,6 +1627,8 @@ public:
 
 		exitCameraController(pCameraController);
 
+		remove_planet_instances();
+
 		exitUserInterface();
 
 		exitFontSystem();
@@ -668,37 +1639,50 @@ public:
 		for (uint32_t i = 0; i < gDataBufferCount; ++i)
 		{
 			removeResource(pUniformBuffer[i]);
-			if (pRenderer->pGpu->mPipelineStatsQueries)
-			{
-				exitQueryPool(pRenderer, pPipelineStatsQueryPool[i]);
-			}
 		}
 
+		remove_sphere_meshes();
 		removeResource(pSkyBoxVertexBuffer);
+		removeResource(pSkyBoxCubeBuildVertexBuffer);
+		removeRenderTarget(pRenderer, pSkyBoxCube);
 		removeSampler(pRenderer, pSkyBoxSampler);
 
-		for (uint i = 0; i < 6; ++i)
-			removeResource(pSkyBoxTextures[i]);
+		exitTextureStreamer(&gSkyBoxStreamer);
 
 		exitGpuCmdRing(pRenderer, &gGraphicsCmdRing);
 		exitSemaphore(pRenderer, pImageAcquiredSemaphore);
 
+		savePipelineCacheFile(pRenderer, &gPipelineCache);
 		exitRootSignature(pRenderer);
 		exitResourceLoaderInterface(pRenderer);
 
+		exitThreadSystem(gThreadSystem);
+		gThreadSystem = NULL;
+
+		exitFrameTimeStats("_VoAcademy.frametimes.csv");
+		exitPassMetrics();
+		exitFrameTrace();
 		exitQueue(pRenderer, pGraphicsQueue);
 
 		exitRenderer(pRenderer);
 		exitGPUConfiguration();
 		pRenderer = NULL;
+
+		if (!exitAllocationTracker() || !gScenarioPassed)
+			setShutdownExitCode(EXIT_FAILURE);
 	}
 
 	bool Load(ReloadDesc* pReloadDesc)
 	{
+		startupTraceBegin("Load");
 		if (pReloadDesc->mType & RELOAD_TYPE_SHADER)
 		{
+			startupTraceBegin("Shaders");
 			addShaders();
+			startupTraceEnd();
+			startupTraceBegin("Descriptor sets");
 			addDescriptorSets();
+			startupTraceEnd();
 		}
 
 		if (pReloadDesc->mType & (RELOAD_TYPE_RESIZE | RELOAD_TYPE_RENDERTARGET))
@@ -712,32 +1696,179 @@ public:
 
 			SliderUintWidget vertexLayoutWidget;
 			vertexLayoutWidget.mMin = 0;
-			vertexLayoutWidget.mMax = 1;
+			vertexLayoutWidget.mMax = gSphereLayoutTypeCount - 1;
 			vertexLayoutWidget.mStep = 1;
 			vertexLayoutWidget.pData = &gSphereLayoutType;
-			UIWidget* pVLw = uiAddComponentWidget(pGuiWindow, "Vertex Layout", &vertexLayoutWidget, WIDGET_TYPE_SLIDER_UINT);
-			uiSetWidgetOnEditedCallback(pVLw, nullptr, reloadRequest);
-
-			if (pRenderer->pGpu->mPipelineStatsQueries)
-			{
-				static float4     color = { 1.0f, 1.0f, 1.0f, 1.0f };
-				DynamicTextWidget statsWidget;
-				statsWidget.pText = &gPipelineStats;
-				statsWidget.pColor = &color;
-				uiAddComponentWidget(pGuiWindow, "Pipeline Stats", &statsWidget, WIDGET_TYPE_DYNAMIC_TEXT);
-			}
-
+			uiAddComponentWidget(pGuiWindow, "Vertex Layout", &vertexLayoutWidget, WIDGET_TYPE_SLIDER_UINT);
+
+			static float4     layoutNameColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+			DynamicTextWidget layoutNameWidget;
+			layoutNameWidget.pText = &gSphereLayoutName;
+			layoutNameWidget.pColor = &layoutNameColor;
+			uiAddComponentWidget(pGuiWindow, "Vertex Layout Name", &layoutNameWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+			ButtonWidget layoutBenchmarkButton;
+			UIWidget*    pLayoutBenchmark =
+				uiAddComponentWidget(pGuiWindow, "Benchmark Vertex Layouts", &layoutBenchmarkButton, WIDGET_TYPE_BUTTON);
+			uiSetWidgetOnEditedCallback(pLayoutBenchmark, nullptr, requestLayoutBenchmark);
+
+			SliderUintWidget detailLevelWidget;
+			detailLevelWidget.mMin = 2;
+			detailLevelWidget.mMax = gMaxSphereDetailLevel;
+			detailLevelWidget.mStep = 1;
+			detailLevelWidget.pData = &gSphereDetailLevel;
+			UIWidget* pDetailWidget = uiAddComponentWidget(pGuiWindow, "Sphere Detail", &detailLevelWidget, WIDGET_TYPE_SLIDER_UINT);
+			uiSetWidgetOnEditedCallback(pDetailWidget, nullptr, reloadRequest);
+
+			SliderFloatWidget oblateWidget;
+			oblateWidget.mMin = 0.0f;
+			oblateWidget.mMax = 1.0f;
+			oblateWidget.mStep = 0.01f;
+			oblateWidget.pData = &gOblateMorphWeight;
+			uiAddComponentWidget(pGuiWindow, "Oblate Morph Weight", &oblateWidget, WIDGET_TYPE_SLIDER_FLOAT);
+
+			CheckboxWidget skyBoxFacesCheckbox;
+			skyBoxFacesCheckbox.pData = &gDrawSkyBoxFaces;
+			uiAddComponentWidget(pGuiWindow, "Six-Face Skybox", &skyBoxFacesCheckbox, WIDGET_TYPE_CHECKBOX);
+
+			static float4     skyBoxColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+			DynamicTextWidget skyBoxWidget;
+			skyBoxWidget.pText = &gSkyBoxStats;
+			skyBoxWidget.pColor = &skyBoxColor;
+			uiAddComponentWidget(pGuiWindow, "Draw Skybox GPU", &skyBoxWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+			CheckboxWidget asteroidBeltCheckbox;
+			asteroidBeltCheckbox.pData = &gDrawAsteroidBelt;
+			uiAddComponentWidget(pGuiWindow, "Asteroid Belt", &asteroidBeltCheckbox, WIDGET_TYPE_CHECKBOX);
+
+			static float4     instanceColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+			DynamicTextWidget instanceWidget;
+			instanceWidget.pText = &gInstanceStats;
+			instanceWidget.pColor = &instanceColor;
+			uiAddComponentWidget(pGuiWindow, "Instances", &instanceWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+			CheckboxWidget frustumCullingCheckbox;
+			frustumCullingCheckbox.pData = &gFrustumCulling;
+			uiAddComponentWidget(pGuiWindow, "Frustum Culling", &frustumCullingCheckbox, WIDGET_TYPE_CHECKBOX);
+
+			static float4     cullingColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+			DynamicTextWidget cullingWidget;
+			cullingWidget.pText = &gCullingStats;
+			cullingWidget.pColor = &cullingColor;
+			uiAddComponentWidget(pGuiWindow, "Visible Instances", &cullingWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+			SliderFloatWidget lodSpacingWidget;
+			lodSpacingWidget.mMin = 0.5f;
+			lodSpacingWidget.mMax = 16.0f;
+			lodSpacingWidget.mStep = 0.5f;
+			lodSpacingWidget.pData = &gLodVertexSpacing;
+			uiAddComponentWidget(pGuiWindow, "LOD Vertex Spacing (px)", &lodSpacingWidget, WIDGET_TYPE_SLIDER_FLOAT);
+
+			SliderFloatWidget lodHysteresisWidget;
+			lodHysteresisWidget.mMin = 0.0f;
+			lodHysteresisWidget.mMax = 0.5f;
+			lodHysteresisWidget.mStep = 0.01f;
+			lodHysteresisWidget.pData = &gLodHysteresis;
+			uiAddComponentWidget(pGuiWindow, "LOD Hysteresis", &lodHysteresisWidget, WIDGET_TYPE_SLIDER_FLOAT);
+
+			static float4     lodColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+			DynamicTextWidget lodWidget;
+			lodWidget.pText = &gLodStats;
+			lodWidget.pColor = &lodColor;
+			uiAddComponentWidget(pGuiWindow, "LOD Instances", &lodWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+			ButtonWidget cullingBenchmarkButton;
+			UIWidget*    pCullingBenchmark =
+				uiAddComponentWidget(pGuiWindow, "Benchmark Frustum Culling", &cullingBenchmarkButton, WIDGET_TYPE_BUTTON);
+			uiSetWidgetOnEditedCallback(pCullingBenchmark, nullptr, requestCullingBenchmark);
+
+			ButtonWidget meshBenchmarkButton;
+			UIWidget*    pMeshBenchmark = uiAddComponentWidget(pGuiWindow, "Benchmark Mesh Generation", &meshBenchmarkButton, WIDGET_TYPE_BUTTON);
+			uiSetWidgetOnEditedCallback(pMeshBenchmark, nullptr, requestMeshBenchmark);
+
+			ButtonWidget transformBenchmarkButton;
+			UIWidget*    pTransformBenchmark =
+				uiAddComponentWidget(pGuiWindow, "Benchmark Transform Hierarchy", &transformBenchmarkButton, WIDGET_TYPE_BUTTON);
+			uiSetWidgetOnEditedCallback(pTransformBenchmark, nullptr, requestTransformBenchmark);
+
+			SliderUintWidget frameTraceFramesWidget;
+			frameTraceFramesWidget.mMin = 1;
+			frameTraceFramesWidget.mMax = 1000;
+			frameTraceFramesWidget.mStep = 1;
+			frameTraceFramesWidget.pData = &gFrameTraceFrames;
+			uiAddComponentWidget(pGuiWindow, "Frame Trace Frames", &frameTraceFramesWidget, WIDGET_TYPE_SLIDER_UINT);
+
+			ButtonWidget frameTraceButton;
+			UIWidget*    pFrameTrace = uiAddComponentWidget(pGuiWindow, "Capture Frame Trace", &frameTraceButton, WIDGET_TYPE_BUTTON);
+			uiSetWidgetOnEditedCallback(pFrameTrace, nullptr, requestFrameTrace);
+
+			CheckboxWidget meshDiskCacheCheckbox;
+			meshDiskCacheCheckbox.pData = &gUseSphereMeshDiskCache;
+			uiAddComponentWidget(pGuiWindow, "Sphere Mesh Disk Cache", &meshDiskCacheCheckbox, WIDGET_TYPE_CHECKBOX);
+
+			CheckboxWidget optimizeMeshCheckbox;
+			optimizeMeshCheckbox.pData = &gOptimizeSphereMesh;
+			UIWidget* pOptimizeMesh = uiAddComponentWidget(pGuiWindow, "Optimize Sphere Mesh", &optimizeMeshCheckbox, WIDGET_TYPE_CHECKBOX);
+			uiSetWidgetOnEditedCallback(pOptimizeMesh, nullptr, reloadRequest);
+
+			static float4     sphereMeshColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+			DynamicTextWidget sphereMeshWidget;
+			sphereMeshWidget.pText = &gSphereMeshStats;
+			sphereMeshWidget.pColor = &sphereMeshColor;
+			uiAddComponentWidget(pGuiWindow, "Sphere Mesh", &sphereMeshWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+			static float4     passMetricsColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+			DynamicTextWidget passMetricsWidget;
+			passMetricsWidget.pText = &gPassMetricsText;
+			passMetricsWidget.pColor = &passMetricsColor;
+			uiAddComponentWidget(pGuiWindow, "Pass Metrics", &passMetricsWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+			CheckboxWidget trackAllocationsCheckbox;
+			trackAllocationsCheckbox.pData = &getAllocationTrackerSettings()->mEnabled;
+			uiAddComponentWidget(pGuiWindow, "Track Frame Allocations", &trackAllocationsCheckbox, WIDGET_TYPE_CHECKBOX);
+
+			static float4     allocationColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+			DynamicTextWidget allocationWidget;
+			allocationWidget.pText = &gAllocationStats;
+			allocationWidget.pColor = &allocationColor;
+			uiAddComponentWidget(pGuiWindow, "Frame Allocations", &allocationWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+			SliderFloatWidget hitchThresholdWidget;
+			hitchThresholdWidget.mMin = 4.0f;
+			hitchThresholdWidget.mMax = 200.0f;
+			hitchThresholdWidget.mStep = 0.1f;
+			hitchThresholdWidget.pData = &getFrameTimeStatsSettings()->mHitchThresholdMs;
+			uiAddComponentWidget(pGuiWindow, "Hitch Threshold (ms)", &hitchThresholdWidget, WIDGET_TYPE_SLIDER_FLOAT);
+
+			static float4     frameTimesColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+			DynamicTextWidget frameTimesWidget;
+			frameTimesWidget.pText = &gFrameTimes;
+			frameTimesWidget.pColor = &frameTimesColor;
+			uiAddComponentWidget(pGuiWindow, "Frame Times", &frameTimesWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+			startupTraceBegin("Swap chain and depth buffer");
 			if (!addSwapChain())
 				return false;
 
 			if (!addDepthBuffer())
 				return false;
+			startupTraceEnd();
 		}
 
 		if (pReloadDesc->mType & (RELOAD_TYPE_SHADER | RELOAD_TYPE_RENDERTARGET))
 		{
-			generate_complex_mesh();
+			if (gSphereLayoutType >= gSphereLayoutTypeCount)
+				gSphereLayoutType = 0;
+			startupTraceBegin("Sphere mesh");
+			load_sphere_mesh(gSphereLayoutType, gSphereDetailLevel);
+			startupTraceEnd();
+
+			startupTraceBegin("Pipelines");
+			HiresTimer pipelineTimer;
+			initHiresTimer(&pipelineTimer);
 			addPipelines();
+			logPipelineCreation(&gPipelineCache, "Academy", getHiresTimerUSec(&pipelineTimer, false));
+			startupTraceEnd();
 		}
 
 		prepareDescriptorSets();
@@ -756,6 +1887,21 @@ public:
 		fontLoad.mLoadType = pReloadDesc->mType;
 		loadFontSystem(&fontLoad);
 
+		// After every wait of the first Load(), so the first frame goes out with the placeholder instead of waiting on disk
+		if (!gSkyBoxStreamer.mTextureCount)
+		{
+			startupTraceBegin("Skybox texture requests");
+			for (uint32_t i = 0; i < 6; ++i)
+				requestStreamedTexture(&gSkyBoxStreamer, pSkyBoxImageFileNames[i], TEXTURE_CREATION_FLAG_SRGB);
+			startupTraceEnd();
+		}
+
+		allocationTrackerRestartWarmup();
+		frameTimeStatsRestartWarmup();
+		resetPassMetrics();
+
+		startupTraceEnd(); // Load
+		finishStartupTrace("_VoAcademy_StartupTrace.json");
 		return true;
 	}
 
@@ -769,8 +1915,6 @@ public:
 		if (pReloadDesc->mType & (RELOAD_TYPE_SHADER | RELOAD_TYPE_RENDERTARGET))
 		{
 			removePipelines();
-			removeResource(pSphereVertexBuffer);
-			removeResource(pSphereIndexBuffer);
 		}
 
 		if (pReloadDesc->mType & (RELOAD_TYPE_RESIZE | RELOAD_TYPE_RENDERTARGET))
@@ -790,6 +1934,64 @@ public:
 
 	void Update(float deltaTime)
 	{
+		allocationTrackerBeginFrame();
+		frameTraceBeginFrame();
+		const uint32_t updateScope = frameTraceBeginCpuScope("Update");
+		if (allocationTrackerFailed())
+			requestShutdown();
+		bformat(&gAllocationStats, "%s", getAllocationTrackerSummary());
+		bformat(&gFrameTimes, "%s", getFrameTimeStatsSummary());
+
+		// Bake the cube once the last face is in, at the largest face resolution
+		if (updateTextureStreamer(&gSkyBoxStreamer) && !gSkyBoxStreamer.mPendingCount)
+		{
+			uint32_t size = 1;
+			for (uint32_t i = 0; i < 6; ++i)
+			{
+				const uint32_t width = getStreamedTexture(&gSkyBoxStreamer, i)->mWidth;
+				size = width > size ? width : size;
+			}
+			if (size != pSkyBoxCube->mWidth)
+			{
+				// Once per run, the old cube may still be sampled by frames in flight
+				waitQueueIdle(pGraphicsQueue);
+				removeRenderTarget(pRenderer, pSkyBoxCube);
+				addSkyBoxCube(size);
+				updateSkyBoxCubeDescriptorSet();
+				LOGF(LogLevel::eINFO, "Skybox cube map is %u x %u per face", size, size);
+			}
+			gSkyBoxCubeBuildPending = true;
+		}
+
+		if (gRunMeshBenchmark)
+		{
+			gRunMeshBenchmark = false;
+			PlanetVertexFormat format = get_planet_vertex_format(&gSphereVertexLayout);
+			setPlanetMorphDeltaScales(&format, gSphereDetailLevel);
+			benchmarkPlanetMeshGeneration(&format, gThreadSystem);
+			allocationTrackerRestartWarmup();
+			frameTimeStatsRestartWarmup();
+		}
+
+		if (gRunTransformBenchmark)
+		{
+			gRunTransformBenchmark = false;
+			benchmarkTransformHierarchy(gThreadSystem);
+			allocationTrackerRestartWarmup();
+			frameTimeStatsRestartWarmup();
+		}
+
+		if (gRunCullingBenchmark)
+		{
+			gRunCullingBenchmark = false;
+			benchmarkFrustumCulling();
+			allocationTrackerRestartWarmup();
+			frameTimeStatsRestartWarmup();
+		}
+
+		update_layout_benchmark();
+		switch_sphere_layout();
+
 		if (!uiIsFocused())
 		{
 			pCameraController->onMove({ inputGetValue(0, CUSTOM_MOVE_X), inputGetValue(0, CUSTOM_MOVE_Y) });
@@ -836,30 +2038,36 @@ public:
 		gUniformData.mLightPosition = vec4(0, 0, 0, 0);
 		gUniformData.mLightColor = vec4(0.9f, 0.9f, 0.7f, 1.0f); // Pale Yellow
 
-		// update planet transformations
+		// The other layouts only have the sphere key frame
+		const float oblateWeight = gSphereLayouts[gCurrentSphereLayoutType].mShader == SPHERE_SHADER_MORPH ? gOblateMorphWeight : 0.0f;
+
+		// update planet transformations: world = parent orbit * rotOrbitY * rotOrbitZ * trans * rotSelf * scale, split
+		// into the orbit node (rotOrbitY * trans) and the body node (trans^-1 * rotOrbitZ * trans * rotSelf * scale)
 		for (unsigned int i = 0; i < gNumPlanets; i++)
 		{
-			mat4 rotSelf, rotOrbitY, rotOrbitZ, trans, scale, parentMat;
-			rotSelf = rotOrbitY = rotOrbitZ = parentMat = mat4::identity();
+			Quat rotSelf, rotOrbitY, rotOrbitZ;
+			rotSelf = rotOrbitY = rotOrbitZ = Quat::identity();
 			if (gPlanetInfoData[i].mRotationSpeed > 0.0f)
-				rotSelf = mat4::rotationY(gRotSelfScale * (currentTime + gTimeOffset) / gPlanetInfoData[i].mRotationSpeed);
+				rotSelf = Quat::rotationY(gRotSelfScale * (currentTime + gTimeOffset) / gPlanetInfoData[i].mRotationSpeed);
 			if (gPlanetInfoData[i].mYOrbitSpeed > 0.0f)
-				rotOrbitY = mat4::rotationY(gRotOrbitYScale * (currentTime + gTimeOffset) / gPlanetInfoData[i].mYOrbitSpeed);
+				rotOrbitY = Quat::rotationY(gRotOrbitYScale * (currentTime + gTimeOffset) / gPlanetInfoData[i].mYOrbitSpeed);
 			if (gPlanetInfoData[i].mZOrbitSpeed > 0.0f)
-				rotOrbitZ = mat4::rotationZ(gRotOrbitZScale * (currentTime + gTimeOffset) / gPlanetInfoData[i].mZOrbitSpeed);
-			if (gPlanetInfoData[i].mParentIndex > 0)
-				parentMat = gPlanetInfoData[gPlanetInfoData[i].mParentIndex].mSharedMat;
+				rotOrbitZ = Quat::rotationZ(gRotOrbitZScale * (currentTime + gTimeOffset) / gPlanetInfoData[i].mZOrbitSpeed);
 
-			trans = gPlanetInfoData[i].mTranslationMat;
-			scale = gPlanetInfoData[i].mScaleMat;
+			const vec3 trans = gPlanetInfoData[i].mTranslation;
+			const vec3 orbitPosition = rotate(rotOrbitY, trans);
+			const vec3 bodyPosition = rotate(rotOrbitZ, trans) - trans;
+			const Quat bodyRotation = rotOrbitZ * rotSelf;
 
-			scale[0][0] /= 2;
-			scale[1][1] /= 2;
-			scale[2][2] /= 2;
+			const float orbitPositionData[3] = { orbitPosition.getX(), orbitPosition.getY(), orbitPosition.getZ() };
+			const float orbitRotationData[4] = { rotOrbitY.getX(), rotOrbitY.getY(), rotOrbitY.getZ(), rotOrbitY.getW() };
+			const float bodyPositionData[3] = { bodyPosition.getX(), bodyPosition.getY(), bodyPosition.getZ() };
+			const float bodyRotationData[4] = { bodyRotation.getX(), bodyRotation.getY(), bodyRotation.getZ(), bodyRotation.getW() };
+			setTransformLocal(&gPlanetTransforms, i * 2, orbitPositionData, orbitRotationData, 1.0f);
+			setTransformLocal(&gPlanetTransforms, i * 2 + 1, bodyPositionData, bodyRotationData, gPlanetInfoData[i].mScale / 2);
 
-			gPlanetInfoData[i].mSharedMat = parentMat * rotOrbitY * trans;
-			gUniformData.mToWorldMat[i] = parentMat * rotOrbitY * rotOrbitZ * trans * rotSelf * scale;
-			gUniformData.mColor[i] = gPlanetInfoData[i].mColor;
+			InstanceData* pInstance = &pInstanceData[i];
+			pInstance->mColor = gPlanetInfoData[i].mColor;
 
 			float step;
 			float phase = modf(currentTime * gPlanetInfoData[i].mMorphingSpeed / 2000.f, &step);
@@ -868,32 +2076,95 @@ public:
 			else
 				phase = phase * 2;
 
-			gUniformData.mGeometryWeight[i][0] = phase;
+			pInstance->mGeometryWeight[0] = phase * (1.0f - oblateWeight);
+			pInstance->mGeometryWeight[1] = phase * oblateWeight;
+			pInstanceUploads[i] = gDataBufferCount;
+		}
+
+		// Asteroid rings, untouched (and so skipped by the hierarchy update) while the belt is hidden
+		for (uint32_t i = 0; gDrawAsteroidBelt && i < gAsteroidRingCount; ++i)
+		{
+			const float orbitSpeed = gAsteroidBeltOrbitSpeed * powf(get_asteroid_ring_radius(i, 0.5f) / gAsteroidBeltInnerRadius, 1.5f);
+			const Quat  rotation = Quat::rotationY(gRotOrbitYScale * (currentTime + gTimeOffset) / orbitSpeed);
+			const float positionData[3] = { 0.0f, 0.0f, 0.0f };
+			const float rotationData[4] = { rotation.getX(), rotation.getY(), rotation.getZ(), rotation.getW() };
+			setTransformLocal(&gPlanetTransforms, gFirstRingNode + i, positionData, rotationData, 1.0f);
+		}
+
+		// Static nodes (e.g. the sun orbit) don't reach the change list, only moved bodies are converted and uploaded
+		const uint32_t transformScope = frameTraceBeginCpuScope("Update Transforms");
+		updateTransformHierarchy(&gPlanetTransforms);
+		frameTraceEndCpuScope(transformScope);
+		for (uint32_t c = 0; c < gPlanetTransforms.mChangedCount; ++c)
+		{
+			const uint32_t node = gPlanetTransforms.pChangedNodes[c];
+			const uint32_t i = get_node_instance(node);
+			if (i == UINT32_MAX)
+				continue;
+			const float* pWorld = getTransformWorldMatrix(&gPlanetTransforms, node);
+			pInstanceUploads[i] = gDataBufferCount;
+			pInstanceData[i].mToWorldMat =
+				mat4(vec4(pWorld[0], pWorld[1], pWorld[2], pWorld[3]), vec4(pWorld[4], pWorld[5], pWorld[6], pWorld[7]),
+					 vec4(pWorld[8], pWorld[9], pWorld[10], pWorld[11]), vec4(pWorld[12], pWorld[13], pWorld[14], pWorld[15]));
+
+			// Uniform scale, any column length will do
+			pInstanceBounds[i] = pWorld[12];
+			pInstanceBounds[gInstanceCount + i] = pWorld[13];
+			pInstanceBounds[gInstanceCount * 2 + i] = pWorld[14];
+			pInstanceBounds[gInstanceCount * 3 + i] =
+				gSphereMeshBoundingRadius * sqrtf(pWorld[0] * pWorld[0] + pWorld[1] * pWorld[1] + pWorld[2] * pWorld[2]);
 		}
 
+		const uint32_t instanceCount = gDrawAsteroidBelt ? gInstanceCount : gNumPlanets;
+		HiresTimer     cullTimer;
+		initHiresTimer(&cullTimer);
+		const uint32_t cullScope = frameTraceBeginCpuScope("Cull and Select LODs");
+		cull_instances(gUniformData.mProjectView.mCamera, instanceCount);
+		bformat(&gCullingStats, "%u / %u visible, culled in %.3f ms", gVisibleInstanceCount, instanceCount,
+				getHiresTimerUSec(&cullTimer, false) / 1000.0);
+
+		select_instance_lods(pCameraController->getViewPosition(), mSettings.mWidth * 0.5f / tanf(horizontal_fov * 0.5f));
+		uint64_t drawnVertices = 0;
+		for (uint32_t lod = 0; lod < gSphereLodCount; ++lod)
+			drawnVertices += gLodInstanceCounts[lod] * planetMeshVertexCount(get_sphere_lod_detail_level(pSphereMesh->mDetailLevel, lod));
+		bformat(&gLodStats, "LOD 0-3 (detail %u-%u): %u / %u / %u / %u instances, %.2f M vertices", pSphereMesh->mDetailLevel,
+				get_sphere_lod_detail_level(pSphereMesh->mDetailLevel, gSphereLodCount - 1), gLodInstanceCounts[0], gLodInstanceCounts[1],
+				gLodInstanceCounts[2], gLodInstanceCounts[3], drawnVertices / 1000000.0);
+		frameTraceEndCpuScope(cullScope);
+
 		viewMat.setTranslation(vec3(0));
 		gUniformData.mSkyProjectView = projMat * viewMat;
+		frameTraceEndCpuScope(updateScope);
 	}
 
 	void Draw()
 	{
+		const uint32_t drawScope = frameTraceBeginCpuScope("Draw");
 		if ((bool)pSwapChain->mEnableVsync != mSettings.mVSyncEnabled)
 		{
 			waitQueueIdle(pGraphicsQueue);
 			::toggleVSync(pRenderer, &pSwapChain);
 		}
 
-		uint32_t swapchainImageIndex;
+		uint32_t       swapchainImageIndex;
+		const uint32_t acquireScope = frameTraceBeginCpuScope("Acquire Image");
 		acquireNextImage(pRenderer, pSwapChain, pImageAcquiredSemaphore, NULL, &swapchainImageIndex);
+		frameTraceEndCpuScope(acquireScope);
 
 		RenderTarget* pRenderTarget = pSwapChain->ppRenderTargets[swapchainImageIndex];
 		GpuCmdRingElement elem = getNextGpuCmdRingElement(&gGraphicsCmdRing, true, 1);
 
 		// Stall if CPU is running "gDataBufferCount" frames ahead of GPU
-		FenceStatus fenceStatus;
+		const uint32_t fenceScope = frameTraceBeginCpuScope("Wait For GPU");
+		FenceStatus    fenceStatus;
 		getFenceStatus(pRenderer, elem.pFence, &fenceStatus);
 		if (fenceStatus == FENCE_STATUS_INCOMPLETE)
 			waitForFences(pRenderer, 1, &elem.pFence);
+		frameTraceEndCpuScope(fenceScope);
+
+		// This frame's copy is idle now, point it at the skybox faces that finished streaming
+		if (gSkyBoxDescriptorVersions[gFrameIndex] != gSkyBoxStreamer.mVersion)
+			updateSkyBoxFacesDescriptorSet(gFrameIndex);
 
 		// Update uniform buffers
 		BufferUpdateDesc viewProjCbv = { pUniformBuffer[gFrameIndex] };
@@ -901,53 +2172,113 @@ public:
 		memcpy(viewProjCbv.pMappedData, &gUniformData, sizeof(gUniformData));
 		endUpdateResource(&viewProjCbv);
 
+		// Update instance buffer: each run of scene instances this buffer hasn't seen yet is one copy
+		const uint32_t instanceCount = gDrawAsteroidBelt ? gInstanceCount : gNumPlanets;
+		uint32_t       uploadCount = 0;
+		HiresTimer     uploadTimer;
+		initHiresTimer(&uploadTimer);
+		BufferUpdateDesc instanceUpdate = { pInstanceBuffer[gFrameIndex] };
+		beginUpdateResource(&instanceUpdate);
+		InstanceData* pMappedInstances = (InstanceData*)instanceUpdate.pMappedData;
+		for (uint32_t first = 0; first < instanceCount;)
+		{
+			if (!pInstanceUploads[first])
+			{
+				++first;
+				continue;
+			}
+			uint32_t end = first;
+			for (; end < instanceCount && pInstanceUploads[end]; ++end)
+				--pInstanceUploads[end];
+			memcpy(pMappedInstances + first, pInstanceData + first, (end - first) * sizeof(InstanceData));
+			uploadCount += end - first;
+			first = end;
+		}
+		endUpdateResource(&instanceUpdate);
+
+		BufferUpdateDesc visibleUpdate = { pVisibleInstanceBuffer[gFrameIndex] };
+		beginUpdateResource(&visibleUpdate);
+		memcpy(visibleUpdate.pMappedData, pDrawInstances, gVisibleInstanceCount * sizeof(uint32_t));
+		endUpdateResource(&visibleUpdate);
+		bformat(&gInstanceStats, "%u in scene, %u uploaded (%.2f MB) in %.3f ms", instanceCount, uploadCount,
+				uploadCount * sizeof(InstanceData) / (1024.0 * 1024.0), getHiresTimerUSec(&uploadTimer, false) / 1000.0);
+
 		// Reset cmd pool for this frame
 		resetCmdPool(pRenderer, elem.pCmdPool);
 
-		if (pRenderer->pGpu->mPipelineStatsQueries)
+		Cmd*           cmd = elem.pCmds[0];
+		const uint32_t recordScope = frameTraceBeginCpuScope("Record Commands");
+		beginCmd(cmd);
+
+		cmdBeginGpuFrameProfile(cmd, gGpuProfileToken);
+		frameTraceBeginGpuFrame(cmd, gFrameIndex);
+		passMetricsBeginFrame(cmd, gFrameIndex);
+
+		// Pass metrics are from the frame that last used this command pool
+		const PassMetrics* pScene = getPassMetrics(gScenePass);
+		const PassMetrics* pSkyBoxCube = getPassMetrics(gSkyBoxPasses[SKYBOX_PATH_CUBE]);
+		const PassMetrics* pSkyBoxFaces = getPassMetrics(gSkyBoxPasses[SKYBOX_PATH_FACES]);
+		bformat(&gSkyBoxStats, "cube map %.4f ms (%u frames), six faces %.4f ms (%u frames)", getPassMetricsAverageGpuMs(pSkyBoxCube),
+				pSkyBoxCube->mFrameCount, getPassMetricsAverageGpuMs(pSkyBoxFaces), pSkyBoxFaces->mFrameCount);
+
+		// FIFO cache estimate of the LOD 0 draw, the measured 3D count adds the other LODs, the 36 skybox vertices and
+		// depends on the cache model of the GPU
+		char expectedVS[64] = "n/a";
+		if (gSphereCacheStats.mVerticesTransformed)
 		{
-			QueryData data3D = {};
-			QueryData data2D = {};
-			getQueryData(pRenderer, pPipelineStatsQueryPool[gFrameIndex], 0, &data3D);
-			getQueryData(pRenderer, pPipelineStatsQueryPool[gFrameIndex], 1, &data2D);
-			bformat(&gPipelineStats,
-				"\n"
-				"Pipeline Stats 3D:\n"
-				"    VS invocations:      %u\n"
-				"    PS invocations:      %u\n"
-				"    Clipper invocations: %u\n"
-				"    IA primitives:       %u\n"
-				"    Clipper primitives:  %u\n"
-				"\n"
-				"Pipeline Stats 2D UI:\n"
-				"    VS invocations:      %u\n"
-				"    PS invocations:      %u\n"
-				"    Clipper invocations: %u\n"
-				"    IA primitives:       %u\n"
-				"    Clipper primitives:  %u\n",
-				data3D.mPipelineStats.mVSInvocations, data3D.mPipelineStats.mPSInvocations, data3D.mPipelineStats.mCInvocations,
-				data3D.mPipelineStats.mIAPrimitives, data3D.mPipelineStats.mCPrimitives, data2D.mPipelineStats.mVSInvocations,
-				data2D.mPipelineStats.mPSInvocations, data2D.mPipelineStats.mCInvocations, data2D.mPipelineStats.mIAPrimitives,
-				data2D.mPipelineStats.mCPrimitives);
+			const unsigned long long expected = (unsigned long long)gSphereCacheStats.mVerticesTransformed * gLodInstanceCounts[0];
+			snprintf(expectedVS, sizeof(expectedVS), "%llu", expected);
 		}
+		bformat(&gPassMetricsText, "\n%s\n\nLOD 0 VS estimate: %s\n", getPassMetricsSummary(), expectedVS);
 
-		Cmd* cmd = elem.pCmds[0];
-		beginCmd(cmd);
+		if (gLayoutBenchmarkActive && gLayoutBenchmarkFrame >= gLayoutBenchmarkWarmupFrames)
+		{
+			LayoutBenchmarkResult* pResult = &gLayoutBenchmarkResults[gCurrentSphereLayoutType];
+			pResult->mGpuMs += getGpuProfileTime(gGpuProfileToken);
+			pResult->mVSInvocations += pScene->mStats.mVSInvocations;
+			pResult->mPSInvocations += pScene->mStats.mPSInvocations;
+			pResult->mIAPrimitives += pScene->mStats.mIAPrimitives;
+			pResult->mCPrimitives += pScene->mStats.mCPrimitives;
+		}
 
-		cmdBeginGpuFrameProfile(cmd, gGpuProfileToken);
-		if (pRenderer->pGpu->mPipelineStatsQueries)
+		// Both frame times are of an earlier frame: the last completed one and the GPU profiler's
+		if (benchmarkScenarioMeasuring(&gScenario))
+		{
+			addBenchmarkSample(&gScenario, SCENARIO_METRIC_CPU_FRAME_MS, getLastFrameTimeMs(FRAME_TIME_CPU_FRAME));
+			addBenchmarkSample(&gScenario, SCENARIO_METRIC_GPU_FRAME_MS, getGpuProfileTime(gGpuProfileToken));
+			const PassMetrics* pSkyBox = pSkyBoxCube->mUpdated ? pSkyBoxCube : pSkyBoxFaces;
+			if (pSkyBox->mUpdated && (pSkyBox->mFlags & PASS_METRICS_TIMESTAMPS))
+				addBenchmarkSample(&gScenario, SCENARIO_METRIC_DRAW_SKYBOX_GPU_MS, pSkyBox->mGpuMs);
+			if (pScene->mFlags & PASS_METRICS_PIPELINE_STATS)
+			{
+				addBenchmarkSample(&gScenario, SCENARIO_METRIC_VS_INVOCATIONS, (double)pScene->mStats.mVSInvocations);
+				addBenchmarkSample(&gScenario, SCENARIO_METRIC_PS_INVOCATIONS, (double)pScene->mStats.mPSInvocations);
+				addBenchmarkSample(&gScenario, SCENARIO_METRIC_IA_PRIMITIVES, (double)pScene->mStats.mIAPrimitives);
+				addBenchmarkSample(&gScenario, SCENARIO_METRIC_CLIPPER_PRIMITIVES, (double)pScene->mStats.mCPrimitives);
+			}
+		}
+		if (advanceBenchmarkScenario(&gScenario))
+		{
+			gScenarioPassed = finishBenchmarkScenario(&gScenario);
+			requestShutdown();
+		}
+
+		if (gSkyBoxCubeBuildPending)
 		{
-			cmdResetQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], 0, 2);
-			QueryDesc queryDesc = { 0 };
-			cmdBeginQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
+			gSkyBoxCubeBuildPending = false;
+			buildSkyBoxCube(cmd);
 		}
 
+		const uint32_t skyBoxPath = gDrawSkyBoxFaces ? SKYBOX_PATH_FACES : SKYBOX_PATH_CUBE;
+
 		RenderTargetBarrier barriers[] = {
 			{ pRenderTarget, RESOURCE_STATE_PRESENT, RESOURCE_STATE_RENDER_TARGET },
 		};
 		cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, barriers);
 
 		cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Skybox/Planets");
+		frameTraceBeginGpuRange(cmd, "Draw Skybox/Planets");
+		passMetricsBeginPass(cmd, gScenePass);
 
 		// simply record the screen cleaning command
 		BindRenderTargetsDesc bindRenderTargets = {};
@@ -961,35 +2292,70 @@ public:
 		const uint32_t skyboxVbStride = sizeof(float) * 4;
 		// draw skybox
 		cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Skybox");
+		frameTraceBeginGpuRange(cmd, "Draw Skybox");
+		passMetricsBeginPass(cmd, gSkyBoxPasses[skyBoxPath]);
 		cmdSetViewport(cmd, 0.0f, 0.0f, (float)pRenderTarget->mWidth, (float)pRenderTarget->mHeight, 1.0f, 1.0f);
-		cmdBindPipeline(cmd, pSkyBoxDrawPipeline);
+		cmdBindPipeline(cmd, skyBoxPath == SKYBOX_PATH_FACES ? pSkyBoxFacesPipeline : pSkyBoxDrawPipeline);
 		cmdBindDescriptorSet(cmd, 0, pDescriptorSetTexture);
 		cmdBindDescriptorSet(cmd, gFrameIndex, pDescriptorSetUniforms);
+		if (skyBoxPath == SKYBOX_PATH_FACES)
+			cmdBindDescriptorSet(cmd, gFrameIndex, pDescriptorSetSkyBoxFaces);
 		cmdBindVertexBuffer(cmd, 1, &pSkyBoxVertexBuffer, &skyboxVbStride, NULL);
 		cmdDraw(cmd, 36, 0);
 		cmdSetViewport(cmd, 0.0f, 0.0f, (float)pRenderTarget->mWidth, (float)pRenderTarget->mHeight, 0.0f, 1.0f);
+		passMetricsEndPass(cmd, gSkyBoxPasses[skyBoxPath]);
+		frameTraceEndGpuRange(cmd);
 		cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
 
 		cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Planets");
-		cmdBindPipeline(cmd, pSpherePipeline);
-		cmdBindVertexBuffer(cmd, 1, &pSphereVertexBuffer, &gSphereVertexLayout.mBindings[0].mStride, nullptr);
-		cmdBindIndexBuffer(cmd, pSphereIndexBuffer, INDEX_TYPE_UINT16, 0);
-		cmdDrawIndexedInstanced(cmd, gSphereIndexCount, 0, gNumPlanets, 0, 0);
+		frameTraceBeginGpuRange(cmd, "Draw Planets");
+		cmdBindPipeline(cmd, pSpherePipelines[gCurrentSphereLayoutType]);
+		for (uint32_t lod = 0; lod < gSphereLodCount; ++lod)
+		{
+			if (!gLodInstanceCounts[lod])
+				continue;
+
+			// Mesh streams, then the draw instances of this LOD
+			const SphereLod*  pLod = &gSphereLods[gCurrentSphereLayoutType][lod];
+			const SphereMesh* pMesh = lod ? &pLod->mMesh : pSphereMesh;
+			const uint32_t    streamCount = pMesh->mLayout.mBindingCount;
+			Buffer*           pStreamBuffers[PLANET_MAX_VERTEX_STREAMS + 1];
+			uint32_t          strides[PLANET_MAX_VERTEX_STREAMS + 1];
+			uint64_t          offsets[PLANET_MAX_VERTEX_STREAMS + 1];
+			for (uint32_t i = 0; i < streamCount; ++i)
+			{
+				pStreamBuffers[i] = pMesh->pStreamBuffers[i];
+				strides[i] = pMesh->mStrides[i];
+				offsets[i] = pMesh->mStreamOffsets[i];
+			}
+			pStreamBuffers[streamCount] = pVisibleInstanceBuffer[gFrameIndex];
+			strides[streamCount] = sizeof(uint32_t);
+			offsets[streamCount] = gLodFirstInstances[lod] * sizeof(uint32_t);
+			cmdBindVertexBuffer(cmd, streamCount + 1, pStreamBuffers, strides, offsets);
+
+			if (lod)
+			{
+				cmdBindIndexBuffer(cmd, pLod->pIndexBuffer, pLod->mIndexType, 0);
+				cmdDrawIndexedInstanced(cmd, pLod->mIndexCount, 0, gLodInstanceCounts[lod], 0, 0);
+			}
+			else
+			{
+				cmdBindIndexBuffer(cmd, pSphereIndexBuffer, gSphereIndexType, 0);
+				cmdDrawIndexedInstanced(cmd, gSphereIndexCount, 0, gLodInstanceCounts[lod], 0, 0);
+			}
+		}
+		frameTraceEndGpuRange(cmd);
 		cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
 
+		frameTraceEndGpuRange(cmd); // Draw Skybox/Planets
 		cmdEndGpuTimestampQuery(cmd, gGpuProfileToken); // Draw Skybox/Planets
 		cmdBindRenderTargets(cmd, NULL);
-
-		if (pRenderer->pGpu->mPipelineStatsQueries)
-		{
-			QueryDesc queryDesc = { 0 };
-			cmdEndQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
-
-			queryDesc = { 1 };
-			cmdBeginQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
-		}
+		// Begun before the render targets were bound: a query has to end on the same side of the render pass
+		passMetricsEndPass(cmd, gScenePass);
 
 		cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw UI");
+		frameTraceBeginGpuRange(cmd, "Draw UI");
+		passMetricsBeginPass(cmd, gUIPass);
 
 		bindRenderTargets = {};
 		bindRenderTargets.mRenderTargetCount = 1;
@@ -1005,22 +2371,20 @@ public:
 
 		cmdDrawUserInterface(cmd);
 
+		frameTraceEndGpuRange(cmd);
 		cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
 		cmdBindRenderTargets(cmd, NULL);
+		passMetricsEndPass(cmd, gUIPass);
 
 		barriers[0] = { pRenderTarget, RESOURCE_STATE_RENDER_TARGET, RESOURCE_STATE_PRESENT };
 		cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, barriers);
 
 		cmdEndGpuFrameProfile(cmd, gGpuProfileToken);
 
-		if (pRenderer->pGpu->mPipelineStatsQueries)
-		{
-			QueryDesc queryDesc = { 1 };
-			cmdEndQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
-			cmdResolveQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], 0, 2);
-		}
-
+		passMetricsEndFrame(cmd);
+		frameTraceEndGpuFrame(cmd);
 		endCmd(cmd);
+		frameTraceEndCpuScope(recordScope);
 
 		FlushResourceUpdateDesc flushUpdateDesc = {};
 		flushUpdateDesc.mNodeIndex = 0;
@@ -1035,7 +2399,9 @@ public:
 		submitDesc.ppSignalSemaphores = &elem.pSemaphore;
 		submitDesc.ppWaitSemaphores = waitSemaphores;
 		submitDesc.pSignalFence = elem.pFence;
+		const uint32_t submitScope = frameTraceBeginCpuScope("Submit");
 		queueSubmit(pGraphicsQueue, &submitDesc);
+		frameTraceEndCpuScope(submitScope);
 
 		QueuePresentDesc presentDesc = {};
 		presentDesc.mIndex = (uint8_t)swapchainImageIndex;
@@ -1044,10 +2410,22 @@ public:
 		presentDesc.ppWaitSemaphores = &elem.pSemaphore;
 		presentDesc.mSubmitDone = true;
 
+		const uint32_t presentScope = frameTraceBeginCpuScope("Present");
 		queuePresent(pGraphicsQueue, &presentDesc);
+		frameTraceEndCpuScope(presentScope);
 		flipProfiler();
 
 		gFrameIndex = (gFrameIndex + 1) % gDataBufferCount;
+
+		frameTraceEndCpuScope(drawScope);
+
+		// GPU frame time is from the frame that last used this command pool, like the other readbacks
+		addFrameTimeSample(FRAME_TIME_FENCE_WAIT, getFrameTraceScopeMs("Wait For GPU"));
+		addFrameTimeSample(FRAME_TIME_PRESENT, getFrameTraceScopeMs("Present"));
+		if (pRenderer->pGpu->mTimestampQueries)
+			addFrameTimeSample(FRAME_TIME_GPU_FRAME, getGpuProfileTime(gGpuProfileToken));
+		frameTimeStatsEndFrame();
+		allocationTrackerEndFrame();
 	}
 
 	const char* GetName() { return "_VoAcademy"; }
@@ -1100,10 +2478,13 @@ public:
 		addDescriptorSet(pRenderer, &descPersisent, &pDescriptorSetTexture);
 		DescriptorSetDesc descUniforms = SRT_SET_DESC(SrtData, PerFrame, gDataBufferCount, 0);
 		addDescriptorSet(pRenderer, &descUniforms, &pDescriptorSetUniforms);
+		DescriptorSetDesc descSkyBoxFaces = SRT_SET_DESC(SrtData, PerBatch, gDataBufferCount, 0);
+		addDescriptorSet(pRenderer, &descSkyBoxFaces, &pDescriptorSetSkyBoxFaces);
 	}
 
 	void removeDescriptorSets()
 	{
+		removeDescriptorSet(pRenderer, pDescriptorSetSkyBoxFaces);
 		removeDescriptorSet(pRenderer, pDescriptorSetUniforms);
 		removeDescriptorSet(pRenderer, pDescriptorSetTexture);
 	}
@@ -1114,18 +2495,36 @@ public:
 		skyShader.mVert.pFileName = "skybox.vert";
 		skyShader.mFrag.pFileName = "skybox.frag";
 
-		ShaderLoadDesc basicShader = {};
-		basicShader.mVert.pFileName = "basic.vert";
-		basicShader.mFrag.pFileName = "basic.frag";
-
 		addShader(pRenderer, &skyShader, &pSkyBoxDrawShader);
-		addShader(pRenderer, &basicShader, &pSphereShader);
+
+		ShaderLoadDesc skyFacesShader = {};
+		skyFacesShader.mVert.pFileName = "skybox.vert";
+		skyFacesShader.mFrag.pFileName = "skybox_faces.frag";
+		addShader(pRenderer, &skyFacesShader, &pSkyBoxFacesShader);
+
+		ShaderLoadDesc cubeBuildShader = {};
+		cubeBuildShader.mVert.pFileName = "skybox_cube_build.vert";
+		cubeBuildShader.mFrag.pFileName = "skybox_faces.frag";
+		addShader(pRenderer, &cubeBuildShader, &pSkyBoxCubeBuildShader);
+
+		// In SphereShader order
+		static const char* sphereVertexShaders[SPHERE_SHADER_COUNT] = { "basic.vert", "basic_oct.vert", "basic_morph.vert" };
+		for (uint32_t i = 0; i < SPHERE_SHADER_COUNT; ++i)
+		{
+			ShaderLoadDesc basicShader = {};
+			basicShader.mVert.pFileName = sphereVertexShaders[i];
+			basicShader.mFrag.pFileName = "basic.frag";
+			addShader(pRenderer, &basicShader, &pSphereShaders[i]);
+		}
 	}
 
 	void removeShaders()
 	{
-		removeShader(pRenderer, pSphereShader);
+		for (uint32_t i = 0; i < SPHERE_SHADER_COUNT; ++i)
+			removeShader(pRenderer, pSphereShaders[i]);
 		removeShader(pRenderer, pSkyBoxDrawShader);
+		removeShader(pRenderer, pSkyBoxFacesShader);
+		removeShader(pRenderer, pSkyBoxCubeBuildShader);
 	}
 
 	void addPipelines()
@@ -1144,6 +2543,7 @@ public:
 		PipelineDesc desc = {};
 		desc.mType = PIPELINE_TYPE_GRAPHICS;
 		PIPELINE_LAYOUT_DESC(desc, SRT_LAYOUT_DESC(SrtData, Persistent), SRT_LAYOUT_DESC(SrtData, PerFrame), NULL, NULL);
+		desc.pCache = gPipelineCache.pCache;
 		GraphicsPipelineDesc& pipelineSettings = desc.mGraphicsDesc;
 		pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
 		pipelineSettings.mRenderTargetCount = 1;
@@ -1152,11 +2552,33 @@ public:
 		pipelineSettings.mSampleCount = pSwapChain->ppRenderTargets[0]->mSampleCount;
 		pipelineSettings.mSampleQuality = pSwapChain->ppRenderTargets[0]->mSampleQuality;
 		pipelineSettings.mDepthStencilFormat = pDepthBuffer->mFormat;
-		pipelineSettings.pShaderProgram = pSphereShader;
-		pipelineSettings.pVertexLayout = &gSphereVertexLayout;
 		pipelineSettings.pRasterizerState = &sphereRasterizerStateDesc;
 		pipelineSettings.mVRFoveatedRendering = true;
-		addPipeline(pRenderer, &desc, &pSpherePipeline);
+		for (uint32_t layoutType = 0; layoutType < gSphereLayoutTypeCount; ++layoutType)
+		{
+			// The mesh streams plus the instance rate draw instance stream, declared after the mesh attributes in VSInput
+			VertexLayout sphereVertexLayout;
+			add_sphere_layout(layoutType, &sphereVertexLayout);
+			uint32_t instanceLocation = 0;
+			for (uint32_t i = 0; i < sphereVertexLayout.mAttribCount; ++i)
+			{
+				if (sphereVertexLayout.mAttribs[i].mLocation >= instanceLocation)
+					instanceLocation = sphereVertexLayout.mAttribs[i].mLocation + 1;
+			}
+			VertexBinding* pInstanceBinding = &sphereVertexLayout.mBindings[sphereVertexLayout.mBindingCount];
+			pInstanceBinding->mStride = sizeof(uint32_t);
+			pInstanceBinding->mRate = VERTEX_BINDING_RATE_INSTANCE;
+			VertexAttrib* pInstanceAttrib = &sphereVertexLayout.mAttribs[sphereVertexLayout.mAttribCount++];
+			pInstanceAttrib->mSemantic = SEMANTIC_TEXCOORD6;
+			pInstanceAttrib->mFormat = TinyImageFormat_R32_UINT;
+			pInstanceAttrib->mBinding = sphereVertexLayout.mBindingCount++;
+			pInstanceAttrib->mLocation = instanceLocation;
+			pInstanceAttrib->mOffset = 0;
+
+			pipelineSettings.pShaderProgram = pSphereShaders[gSphereLayouts[layoutType].mShader];
+			pipelineSettings.pVertexLayout = &sphereVertexLayout;
+			addPipeline(pRenderer, &desc, &pSpherePipelines[layoutType]);
+		}
 
 		// layout and pipeline for skybox draw
 		VertexLayout vertexLayout = {};
@@ -1174,41 +2596,153 @@ public:
 		pipelineSettings.pRasterizerState = &rasterizerStateDesc;
 		pipelineSettings.pShaderProgram = pSkyBoxDrawShader; //-V519
 		addPipeline(pRenderer, &desc, &pSkyBoxDrawPipeline);
+
+		PIPELINE_LAYOUT_DESC(desc, SRT_LAYOUT_DESC(SrtData, Persistent), SRT_LAYOUT_DESC(SrtData, PerFrame),
+							 SRT_LAYOUT_DESC(SrtData, PerBatch), NULL);
+		pipelineSettings.pShaderProgram = pSkyBoxFacesShader;
+		addPipeline(pRenderer, &desc, &pSkyBoxFacesPipeline);
+
+		// Cube faces: clip position, then cube point and face id
+		VertexLayout cubeBuildLayout = {};
+		cubeBuildLayout.mBindingCount = 1;
+		cubeBuildLayout.mBindings[0].mStride = sizeof(float4) * 2;
+		cubeBuildLayout.mAttribCount = 2;
+		cubeBuildLayout.mAttribs[0].mSemantic = SEMANTIC_POSITION;
+		cubeBuildLayout.mAttribs[0].mFormat = TinyImageFormat_R32G32B32A32_SFLOAT;
+		cubeBuildLayout.mAttribs[0].mLocation = 0;
+		cubeBuildLayout.mAttribs[1].mSemantic = SEMANTIC_TEXCOORD0;
+		cubeBuildLayout.mAttribs[1].mFormat = TinyImageFormat_R32G32B32A32_SFLOAT;
+		cubeBuildLayout.mAttribs[1].mLocation = 1;
+		cubeBuildLayout.mAttribs[1].mOffset = sizeof(float4);
+		pipelineSettings.pVertexLayout = &cubeBuildLayout;
+		pipelineSettings.pColorFormats = &pSkyBoxCube->mFormat;
+		pipelineSettings.mSampleCount = SAMPLE_COUNT_1;
+		pipelineSettings.mSampleQuality = 0;
+		pipelineSettings.mDepthStencilFormat = TinyImageFormat_UNDEFINED;
+		pipelineSettings.mVRFoveatedRendering = false;
+		pipelineSettings.pShaderProgram = pSkyBoxCubeBuildShader;
+		addPipeline(pRenderer, &desc, &pSkyBoxCubeBuildPipeline);
 	}
 
 	void removePipelines()
 	{
+		removePipeline(pRenderer, pSkyBoxCubeBuildPipeline);
+		removePipeline(pRenderer, pSkyBoxFacesPipeline);
 		removePipeline(pRenderer, pSkyBoxDrawPipeline);
-		removePipeline(pRenderer, pSpherePipeline);
+		for (uint32_t i = 0; i < gSphereLayoutTypeCount; ++i)
+			removePipeline(pRenderer, pSpherePipelines[i]);
+	}
+
+	// Cube map face layers are render targets of their own, so the build pass draws straight into them.
+	void addSkyBoxCube(uint32_t size)
+	{
+		RenderTargetDesc cubeRT = {};
+		cubeRT.mArraySize = 6;
+		cubeRT.mDepth = 1;
+		cubeRT.mFormat = TinyImageFormat_R8G8B8A8_SRGB;
+		cubeRT.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+		cubeRT.mHeight = size;
+		cubeRT.mSampleCount = SAMPLE_COUNT_1;
+		cubeRT.mSampleQuality = 0;
+		cubeRT.mWidth = size;
+		// Sampled as a cube, rendered one face (array slice) at a time by buildSkyBoxCube()
+		cubeRT.mDescriptors = DESCRIPTOR_TYPE_TEXTURE_CUBE | DESCRIPTOR_TYPE_RENDER_TARGET_ARRAY_SLICES;
+		cubeRT.pName = "SkyBoxCube";
+		addRenderTarget(pRenderer, &cubeRT, &pSkyBoxCube);
+	}
+
+	void buildSkyBoxCube(Cmd* cmd)
+	{
+		cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Build Skybox Cube");
+		frameTraceBeginGpuRange(cmd, "Build Skybox Cube");
+		RenderTargetBarrier barrier = { pSkyBoxCube, RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_RENDER_TARGET };
+		cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, &barrier);
+
+		const uint32_t vertexStride = sizeof(float4) * 2;
+		for (uint32_t face = 0; face < 6; ++face)
+		{
+			BindRenderTargetsDesc bindRenderTargets = {};
+			bindRenderTargets.mRenderTargetCount = 1;
+			bindRenderTargets.mRenderTargets[0] = { pSkyBoxCube, LOAD_ACTION_DONTCARE };
+			bindRenderTargets.mRenderTargets[0].mArraySlice = face;
+			bindRenderTargets.mRenderTargets[0].mUseArraySlice = true;
+			cmdBindRenderTargets(cmd, &bindRenderTargets);
+			cmdSetViewport(cmd, 0.0f, 0.0f, (float)pSkyBoxCube->mWidth, (float)pSkyBoxCube->mHeight, 0.0f, 1.0f);
+			cmdSetScissor(cmd, 0, 0, pSkyBoxCube->mWidth, pSkyBoxCube->mHeight);
+			cmdBindPipeline(cmd, pSkyBoxCubeBuildPipeline);
+			cmdBindDescriptorSet(cmd, 0, pDescriptorSetTexture);
+			cmdBindDescriptorSet(cmd, gFrameIndex, pDescriptorSetSkyBoxFaces);
+			cmdBindVertexBuffer(cmd, 1, &pSkyBoxCubeBuildVertexBuffer, &vertexStride, NULL);
+			// The face's own triangle, firstVertex offsets the vertex fetch on every API
+			cmdDraw(cmd, 3, face * 3);
+			cmdBindRenderTargets(cmd, NULL);
+		}
+
+		barrier = { pSkyBoxCube, RESOURCE_STATE_RENDER_TARGET, RESOURCE_STATE_SHADER_RESOURCE };
+		cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, &barrier);
+		frameTraceEndGpuRange(cmd);
+		cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+	}
+
+	void updateSkyBoxCubeDescriptorSet()
+	{
+		DescriptorData params[2] = {};
+		params[0].mIndex = SRT_RES_IDX(SrtData, Persistent, gSkyBoxCube);
+		params[0].ppTextures = &pSkyBoxCube->pTexture;
+		params[1].mIndex = SRT_RES_IDX(SrtData, Persistent, gSampler);
+		params[1].ppSamplers = &pSkyBoxSampler;
+		updateDescriptorSet(pRenderer, 0, pDescriptorSetTexture, TF_ARRAY_COUNT(params), params);
+	}
+
+	// Copy index of pDescriptorSetSkyBoxFaces gets the current skybox faces, placeholders for those still streaming.
+	void updateSkyBoxFacesDescriptorSet(uint32_t index)
+	{
+		Texture* pTextures[6];
+		for (uint32_t i = 0; i < 6; ++i)
+			pTextures[i] = getStreamedTexture(&gSkyBoxStreamer, i);
+
+		DescriptorData params[6] = {};
+		params[0].mIndex = SRT_RES_IDX(SrtData, PerBatch, gRightTexture);
+		params[0].ppTextures = &pTextures[0];
+		params[1].mIndex = SRT_RES_IDX(SrtData, PerBatch, gLeftTexture);
+		params[1].ppTextures = &pTextures[1];
+		params[2].mIndex = SRT_RES_IDX(SrtData, PerBatch, gTopTexture);
+		params[2].ppTextures = &pTextures[2];
+		params[3].mIndex = SRT_RES_IDX(SrtData, PerBatch, gBotTexture);
+		params[3].ppTextures = &pTextures[3];
+		params[4].mIndex = SRT_RES_IDX(SrtData, PerBatch, gFrontTexture);
+		params[4].ppTextures = &pTextures[4];
+		params[5].mIndex = SRT_RES_IDX(SrtData, PerBatch, gBackTexture);
+		params[5].ppTextures = &pTextures[5];
+		updateDescriptorSet(pRenderer, index, pDescriptorSetSkyBoxFaces, TF_ARRAY_COUNT(params), params);
+		gSkyBoxDescriptorVersions[index] = gSkyBoxStreamer.mVersion;
 	}
 
 	void prepareDescriptorSets()
 	{
 		// Prepare descriptor sets
-		DescriptorData params[7] = {};
-		params[0].mIndex = SRT_RES_IDX(SrtData, Persistent, gRightTexture);
-		params[0].ppTextures = &pSkyBoxTextures[0];
-		params[1].mIndex = SRT_RES_IDX(SrtData, Persistent, gLeftTexture);
-		params[1].ppTextures = &pSkyBoxTextures[1];
-		params[2].mIndex = SRT_RES_IDX(SrtData, Persistent, gTopTexture);
-		params[2].ppTextures = &pSkyBoxTextures[2];
-		params[3].mIndex = SRT_RES_IDX(SrtData, Persistent, gBotTexture);
-		params[3].ppTextures = &pSkyBoxTextures[3];
-		params[4].mIndex = SRT_RES_IDX(SrtData, Persistent, gFrontTexture);
-		params[4].ppTextures = &pSkyBoxTextures[4];
-		params[5].mIndex = SRT_RES_IDX(SrtData, Persistent, gBackTexture);
-		params[5].ppTextures = &pSkyBoxTextures[5];
-		params[6].mIndex = SRT_RES_IDX(SrtData, Persistent, gSampler);
-		params[6].ppSamplers = &pSkyBoxSampler;
-		updateDescriptorSet(pRenderer, 0, pDescriptorSetTexture, TF_ARRAY_COUNT(params), params);
+		updateSkyBoxCubeDescriptorSet();
+		for (uint32_t i = 0; i < gDataBufferCount; ++i)
+			updateSkyBoxFacesDescriptorSet(i);
 
 		for (uint32_t i = 0; i < gDataBufferCount; ++i)
 		{
-			DescriptorData uParams[1] = {};
+			DescriptorData uParams[2] = {};
 			uParams[0].mIndex = SRT_RES_IDX(SrtData, PerFrame, gUniformBlock);
 			uParams[0].ppBuffers = &pUniformBuffer[i];
-			updateDescriptorSet(pRenderer, i, pDescriptorSetUniforms, 1, uParams);
+			uParams[1].mIndex = SRT_RES_IDX(SrtData, PerFrame, gInstanceBuffer);
+			uParams[1].ppBuffers = &pInstanceBuffer[i];
+			updateDescriptorSet(pRenderer, i, pDescriptorSetUniforms, TF_ARRAY_COUNT(uParams), uParams);
 		}
 	}
 };
+#if defined(VO_WRAP_APPLICATION_MAIN)
+// The platform main runs Exit() and tears The Forge down, the shutdown exit code is returned once it has
+#define main platformMain
+DEFINE_APPLICATION_MAIN(Transformations)
+#undef main
+
+int main(int argc, char** argv) { return applyShutdownExitCode(platformMain(argc, argv)); }
+#else
 DEFINE_APPLICATION_MAIN(Transformations)
+#endif
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Utilities/Threading/ThreadSystem.h"
+
+// Procedural planet geometry: a cube with mDetailLevel x mDetailLevel vertices per face, carrying both the cube and the
+// sphere (normalized cube position) attributes so the vertex shader can morph between them. A third key frame, the
+// sphere flattened along y, is only written by layouts that ask for it.
+//
+// Vertices are written straight into the destination format, any mix of interleaved and separate streams with a per
+// attribute encoding. Work is split into row block tasks on the thread system, and each row is processed four vertices
+// at a time with SSE (rsqrt + one Newton-Raphson step for the sphere normal).
+//
+// Rows are numbered across faces (face * mDetailLevel + x), vertex rows are contiguous in the output, so a mesh can be
+// produced in row ranges straight into staging memory and never exist in full on the CPU.
+
+#define PLANET_MAX_VERTEX_STREAMS 8
+
+// y scale of the oblate key frame
+#define PLANET_OBLATE_Y_SCALE 0.6f
+
+typedef enum PlanetAttribute
+{
+	PLANET_ATTRIBUTE_CUBE_POSITION,
+	PLANET_ATTRIBUTE_CUBE_NORMAL,
+	PLANET_ATTRIBUTE_CUBE_COLOR,
+	PLANET_ATTRIBUTE_SPHERE_POSITION, // same vector as the sphere normal, layouts may alias both on the same bytes
+	PLANET_ATTRIBUTE_SPHERE_NORMAL,
+	PLANET_ATTRIBUTE_SPHERE_COLOR,
+	PLANET_ATTRIBUTE_OBLATE_POSITION, // colors of the oblate key frame are the sphere ones
+	PLANET_ATTRIBUTE_OBLATE_NORMAL,
+	PLANET_ATTRIBUTE_COUNT
+} PlanetAttribute;
+
+// Colors are always RGBA8, positions and normals can use any of the other encodings. DELTA4 stores a sphere or oblate
+// attribute as a morph target: the difference to the matching cube attribute, quantized against a per-mesh scale, so
+// each extra key frame costs 8 bytes per vector instead of a full copy.
+typedef enum PlanetAttributeEncoding
+{
+	PLANET_ENCODING_NONE = 0,   // not stored
+	PLANET_ENCODING_FLOAT3,     // 12 bytes
+	PLANET_ENCODING_HALF4,      // 8 bytes, w = 1
+	PLANET_ENCODING_OCTAHEDRAL, // 4 bytes, 2 x snorm16, unit vectors only
+	PLANET_ENCODING_RGBA8,      // 4 bytes, alpha 0
+	PLANET_ENCODING_DELTA4,     // 8 bytes, 4 x snorm16 of (value - cube value) / mDeltaScale, w = 0
+} PlanetAttributeEncoding;
+
+struct PlanetAttributeFormat
+{
+	uint32_t mEncoding; // PlanetAttributeEncoding
+	uint32_t mStream;
+	uint32_t mOffset;     // inside one vertex of mStream
+	float    mDeltaScale; // PLANET_ENCODING_DELTA4 only, see setPlanetMorphDeltaScales()
+};
+
+struct PlanetVertexFormat
+{
+	uint32_t              mStreamCount;
+	uint32_t              mStrides[PLANET_MAX_VERTEX_STREAMS];
+	PlanetAttributeFormat mAttributes[PLANET_ATTRIBUTE_COUNT];
+};
+
+struct PlanetMeshDesc
+{
+	uint32_t           mDetailLevel; // vertices on a face edge, >= 2
+	uint32_t           mSeed;        // colors are a pure function of (seed, vertex), any split produces the same mesh
+	PlanetVertexFormat mFormat;
+	ThreadSystem       mThreadSystem; // NULL generates on the calling thread
+	uint32_t           mFirstRow;
+	uint32_t           mRowCount; // 0: every row from mFirstRow on
+	// Data of mFirstRow in each stream, mRowCount * mDetailLevel * mFormat.mStrides[i] bytes, padding is not written
+	void*              pStreamData[PLANET_MAX_VERTEX_STREAMS];
+};
+
+// Indices of quad rows [mFirstQuadRow, mFirstQuadRow + mQuadRowCount), 6 per quad, mDetailLevel - 1 quads per row.
+struct PlanetIndexDesc
+{
+	uint32_t mDetailLevel;
+	uint32_t mIndexSize; // planetMeshIndexSize()
+	uint32_t mFirstQuadRow;
+	uint32_t mQuadRowCount; // 0: every row from mFirstQuadRow on
+	void*    pIndexData;
+};
+
+// Bytes of one vertex summed over every stream.
+inline uint32_t planetVertexSize(const PlanetVertexFormat* pFormat)
+{
+	uint32_t size = 0;
+	for (uint32_t i = 0; i < pFormat->mStreamCount; ++i)
+		size += pFormat->mStrides[i];
+	return size;
+}
+
+inline uint32_t planetMeshRowCount(uint32_t detailLevel) { return 6 * detailLevel; }
+
+inline uint32_t planetMeshQuadRowCount(uint32_t detailLevel) { return 6 * (detailLevel - 1); }
+
+inline uint64_t planetMeshVertexCount(uint32_t detailLevel) { return 6ull * detailLevel * detailLevel; }
+
+inline uint64_t planetMeshIndexCount(uint32_t detailLevel) { return 36ull * (detailLevel - 1) * (detailLevel - 1); }
+
+// 16-bit indices while every vertex is addressable, 32-bit above that.
+inline uint32_t planetMeshIndexSize(uint32_t detailLevel) { return planetMeshVertexCount(detailLevel) <= 0x10000 ? 2 : 4; }
+
+// Sets mDeltaScale of every PLANET_ENCODING_DELTA4 attribute to the largest delta component over the mesh, so the
+// deltas use the whole snorm16 range. Scans every vertex on the calling thread; a no-op without delta attributes.
+void setPlanetMorphDeltaScales(PlanetVertexFormat* pFormat, uint32_t detailLevel);
+
+void generatePlanetVertices(const PlanetMeshDesc* pDesc);
+void generatePlanetIndices(const PlanetIndexDesc* pDesc);
+
+// Logs single threaded and thread pool generation time for 64 to 1024 vertices per edge.
+void benchmarkPlanetMeshGeneration(const PlanetVertexFormat* pFormat, ThreadSystem threadSystem);
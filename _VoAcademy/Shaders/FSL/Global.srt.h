@@ -28,16 +28,21 @@
  // for low end iOS devices, do not use Argument buffers
 BEGIN_SRT_NO_AB(SrtData)
 	BEGIN_SRT_SET(Persistent)
-		DECL_TEXTURE(Persistent, Tex2D(float4), gRightTexture)
-		DECL_TEXTURE(Persistent, Tex2D(float4), gLeftTexture)
-		DECL_TEXTURE(Persistent, Tex2D(float4), gTopTexture)
-		DECL_TEXTURE(Persistent, Tex2D(float4), gBotTexture)
-		DECL_TEXTURE(Persistent, Tex2D(float4), gFrontTexture)
-		DECL_TEXTURE(Persistent, Tex2D(float4), gBackTexture)
+		DECL_TEXTURE(Persistent, TexCube(float4), gSkyBoxCube)
 		DECL_SAMPLER(Persistent, SamplerState, gSampler)
 	END_SRT_SET(Persistent)
 	BEGIN_SRT_SET(PerFrame)
 		DECL_CBUFFER(PerFrame, CBUFFER(UniformData), gUniformBlock)
+		DECL_BUFFER(PerFrame, Buffer(InstanceData), gInstanceBuffer)
 	END_SRT_SET(PerFrame)
+	// Source faces of gSkyBoxCube, only read by SkyboxFaces.frag
+	BEGIN_SRT_SET(PerBatch)
+		DECL_TEXTURE(PerBatch, Tex2D(float4), gRightTexture)
+		DECL_TEXTURE(PerBatch, Tex2D(float4), gLeftTexture)
+		DECL_TEXTURE(PerBatch, Tex2D(float4), gTopTexture)
+		DECL_TEXTURE(PerBatch, Tex2D(float4), gBotTexture)
+		DECL_TEXTURE(PerBatch, Tex2D(float4), gFrontTexture)
+		DECL_TEXTURE(PerBatch, Tex2D(float4), gBackTexture)
+	END_SRT_SET(PerBatch)
 END_SRT(SrtData)
 
@@ -0,0 +1,242 @@
+#include "Public/FlecsAllocator.h"
+
+#include <string.h>
+
+#include "Game/ThirdParty/OpenSource/flecs/flecs.h"
+
+#include "Utilities/Interfaces/ILog.h"
+#include "Utilities/Interfaces/IThread.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
+
+// Block sizes include the header. Requests that don't fit the largest class go straight to tf_malloc.
+static const uint32_t gSizeClasses[] = { 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384 };
+static const uint32_t gSizeClassCount = sizeof(gSizeClasses) / sizeof(gSizeClasses[0]);
+static const uint32_t gLargeClass = gSizeClassCount;
+static const uint32_t gSlabSize = 256 * 1024;
+
+// 16 bytes so the payload keeps malloc alignment
+struct BlockHeader
+{
+	uint32_t mSizeClass;
+	uint32_t mSize; // requested size
+	uint64_t mPad;
+};
+
+struct FreeBlock
+{
+	FreeBlock* pNext;
+};
+
+struct Slab
+{
+	Slab* pNext;
+	uint64_t mPad;
+};
+
+struct FlecsAllocator
+{
+	Mutex               mMutex;
+	FreeBlock*          pFreeLists[gSizeClassCount];
+	Slab*               pSlabs;
+	FlecsAllocatorStats mCurrent;
+	FlecsAllocatorStats mLastFrame;
+
+	ecs_os_api_malloc_t  pPrevMalloc;
+	ecs_os_api_calloc_t  pPrevCalloc;
+	ecs_os_api_realloc_t pPrevRealloc;
+	ecs_os_api_free_t    pPrevFree;
+};
+
+static FlecsAllocator gFlecsAllocator = {};
+
+static uint32_t sizeClassFor(uint32_t blockSize)
+{
+	for (uint32_t i = 0; i < gSizeClassCount; ++i)
+	{
+		if (blockSize <= gSizeClasses[i])
+			return i;
+	}
+	return gLargeClass;
+}
+
+// Must be called with the mutex held
+static bool refillSizeClass(uint32_t sizeClass)
+{
+	Slab* pSlab = (Slab*)tf_malloc(gSlabSize);
+	if (!pSlab)
+		return false;
+
+	pSlab->pNext = gFlecsAllocator.pSlabs;
+	gFlecsAllocator.pSlabs = pSlab;
+	++gFlecsAllocator.mCurrent.mFrameHeapAllocCount;
+	gFlecsAllocator.mCurrent.mBytesReserved += gSlabSize;
+
+	const uint32_t blockSize = gSizeClasses[sizeClass];
+	uint8_t*       pBlock = (uint8_t*)(pSlab + 1);
+	uint8_t*       pEnd = (uint8_t*)pSlab + gSlabSize;
+	for (; pBlock + blockSize <= pEnd; pBlock += blockSize)
+	{
+		FreeBlock* pFree = (FreeBlock*)pBlock;
+		pFree->pNext = gFlecsAllocator.pFreeLists[sizeClass];
+		gFlecsAllocator.pFreeLists[sizeClass] = pFree;
+	}
+	return true;
+}
+
+static void* flecsMalloc(ecs_size_t size)
+{
+	ASSERT(size >= 0);
+	const uint32_t blockSize = (uint32_t)size + sizeof(BlockHeader);
+	const uint32_t sizeClass = sizeClassFor(blockSize);
+
+	BlockHeader* pHeader = NULL;
+
+	acquireMutex(&gFlecsAllocator.mMutex);
+	FlecsAllocatorStats& stats = gFlecsAllocator.mCurrent;
+	if (sizeClass == gLargeClass)
+	{
+		pHeader = (BlockHeader*)tf_malloc(blockSize);
+		++stats.mFrameHeapAllocCount;
+		stats.mBytesReserved += blockSize;
+	}
+	else
+	{
+		if (gFlecsAllocator.pFreeLists[sizeClass] || refillSizeClass(sizeClass))
+		{
+			FreeBlock* pFree = gFlecsAllocator.pFreeLists[sizeClass];
+			gFlecsAllocator.pFreeLists[sizeClass] = pFree->pNext;
+			pHeader = (BlockHeader*)pFree;
+		}
+	}
+
+	if (pHeader)
+	{
+		pHeader->mSizeClass = sizeClass;
+		pHeader->mSize = (uint32_t)size;
+		++stats.mFrameAllocCount;
+		stats.mBytesInUse += (uint32_t)size;
+		if (stats.mBytesInUse > stats.mPeakBytesInUse)
+			stats.mPeakBytesInUse = stats.mBytesInUse;
+	}
+	releaseMutex(&gFlecsAllocator.mMutex);
+
+	return pHeader ? pHeader + 1 : NULL;
+}
+
+static void flecsFree(void* ptr)
+{
+	if (!ptr)
+		return;
+
+	BlockHeader* pHeader = (BlockHeader*)ptr - 1;
+
+	acquireMutex(&gFlecsAllocator.mMutex);
+	FlecsAllocatorStats& stats = gFlecsAllocator.mCurrent;
+	++stats.mFrameFreeCount;
+	stats.mBytesInUse -= pHeader->mSize;
+	if (pHeader->mSizeClass == gLargeClass)
+	{
+		stats.mBytesReserved -= pHeader->mSize + sizeof(BlockHeader);
+		tf_free(pHeader);
+	}
+	else
+	{
+		ASSERT(pHeader->mSizeClass < gSizeClassCount);
+		FreeBlock* pFree = (FreeBlock*)pHeader;
+		pFree->pNext = gFlecsAllocator.pFreeLists[pHeader->mSizeClass];
+		gFlecsAllocator.pFreeLists[pHeader->mSizeClass] = pFree;
+	}
+	releaseMutex(&gFlecsAllocator.mMutex);
+}
+
+static void* flecsCalloc(ecs_size_t size)
+{
+	void* ptr = flecsMalloc(size);
+	if (ptr)
+		memset(ptr, 0, (size_t)size);
+	return ptr;
+}
+
+static void* flecsRealloc(void* ptr, ecs_size_t size)
+{
+	if (!ptr)
+		return flecsMalloc(size);
+
+	BlockHeader* pHeader = (BlockHeader*)ptr - 1;
+	// Still fits the block we already own: no copy, no pool traffic
+	if (pHeader->mSizeClass != gLargeClass && (uint32_t)size + sizeof(BlockHeader) <= gSizeClasses[pHeader->mSizeClass])
+	{
+		acquireMutex(&gFlecsAllocator.mMutex);
+		FlecsAllocatorStats& stats = gFlecsAllocator.mCurrent;
+		stats.mBytesInUse = stats.mBytesInUse - pHeader->mSize + (uint32_t)size;
+		if (stats.mBytesInUse > stats.mPeakBytesInUse)
+			stats.mPeakBytesInUse = stats.mBytesInUse;
+		pHeader->mSize = (uint32_t)size;
+		releaseMutex(&gFlecsAllocator.mMutex);
+		return ptr;
+	}
+
+	void* pNew = flecsMalloc(size);
+	if (pNew)
+	{
+		memcpy(pNew, ptr, pHeader->mSize < (uint32_t)size ? pHeader->mSize : (uint32_t)size);
+		flecsFree(ptr);
+	}
+	return pNew;
+}
+
+void initFlecsAllocator()
+{
+	initMutex(&gFlecsAllocator.mMutex);
+
+	// Patch the hooks of the API set up by initEntityComponentSystem() directly, ecs_os_set_api is ignored once the API has been
+	// initialized. exitFlecsAllocator() warns if anything replaced them in between.
+	gFlecsAllocator.pPrevMalloc = ecs_os_api.malloc_;
+	gFlecsAllocator.pPrevCalloc = ecs_os_api.calloc_;
+	gFlecsAllocator.pPrevRealloc = ecs_os_api.realloc_;
+	gFlecsAllocator.pPrevFree = ecs_os_api.free_;
+
+	ecs_os_api.malloc_ = flecsMalloc;
+	ecs_os_api.calloc_ = flecsCalloc;
+	ecs_os_api.realloc_ = flecsRealloc;
+	ecs_os_api.free_ = flecsFree;
+}
+
+void exitFlecsAllocator()
+{
+	if (ecs_os_api.malloc_ != flecsMalloc || ecs_os_api.free_ != flecsFree)
+		LOGF(LogLevel::eWARNING, "flecs allocation hooks were replaced while the allocator was installed");
+
+	ecs_os_api.malloc_ = gFlecsAllocator.pPrevMalloc;
+	ecs_os_api.calloc_ = gFlecsAllocator.pPrevCalloc;
+	ecs_os_api.realloc_ = gFlecsAllocator.pPrevRealloc;
+	ecs_os_api.free_ = gFlecsAllocator.pPrevFree;
+
+	if (gFlecsAllocator.mCurrent.mBytesInUse)
+		LOGF(LogLevel::eWARNING, "flecs still holds %llu bytes at allocator shutdown",
+			 (unsigned long long)gFlecsAllocator.mCurrent.mBytesInUse);
+
+	Slab* pSlab = gFlecsAllocator.pSlabs;
+	while (pSlab)
+	{
+		Slab* pNext = pSlab->pNext;
+		tf_free(pSlab);
+		pSlab = pNext;
+	}
+
+	exitMutex(&gFlecsAllocator.mMutex);
+	gFlecsAllocator = {};
+}
+
+void flecsAllocatorNewFrame()
+{
+	acquireMutex(&gFlecsAllocator.mMutex);
+	gFlecsAllocator.mLastFrame = gFlecsAllocator.mCurrent;
+	gFlecsAllocator.mCurrent.mFrameAllocCount = 0;
+	gFlecsAllocator.mCurrent.mFrameFreeCount = 0;
+	gFlecsAllocator.mCurrent.mFrameHeapAllocCount = 0;
+	releaseMutex(&gFlecsAllocator.mMutex);
+}
+
+const FlecsAllocatorStats* getFlecsAllocatorStats() { return &gFlecsAllocator.mLastFrame; }
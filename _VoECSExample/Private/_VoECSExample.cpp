@@ -22,8 +22,12 @@
  * under the License.
  */
 
+#include <float.h>
+
  // ECS
 #include "Game/ThirdParty/OpenSource/flecs/flecs.h"
+#include "Public/FlecsAllocator.h"
+#include "Public/TypedSystem.h"
 
 // Interfaces
 #include "Application/Interfaces/IApp.h"
@@ -51,14 +55,29 @@
 // Math
 #include "Utilities/Math/MathTypes.h"
 
-#include "Utilities/Interfaces/IMemory.h" // Must be the last include in a cpp file
+#include "VoCommon/Public/CommandLine.h"
+#include "VoCommon/Public/ExitCode.h"
+#include "VoCommon/Public/FrameTimeStats.h"
+#include "VoCommon/Public/FrameTrace.h"
+#include "VoCommon/Public/PassMetrics.h"
+#include "VoCommon/Public/PipelineCacheFile.h"
+#include "VoCommon/Public/StartupTrace.h"
+#include "VoCommon/Public/TextureStreaming.h"
+
+#include "VoCommon/Public/TrackedMemory.h" // Must be the last include in a cpp file
 
+// Per-frame instance data (position + tint), see InstanceData in Global.srt.h
 struct SpriteData
 {
-	float posX, posY;
+	float    posX, posY;
+	uint32_t tint;
+	uint32_t pad;
+};
+
+// Instance data that never changes after spawn, see StaticInstanceData in Global.srt.h
+struct SpriteStaticData
+{
 	float scale;
-	float pad;
-	float colR, colG, colB;
 	float sprite;
 };
 
@@ -73,13 +92,32 @@ struct PositionComponent
 	float x, y;
 };
 
+// Render-static: written at spawn, uploaded once.
 struct SpriteComponent
 {
-	float colorR, colorG, colorB;
 	int   spriteIndex;
 	float scale;
 };
 
+// Mutable tint, RGBA8. Only written by AvoidanceSystem on hits.
+struct TintComponent
+{
+	uint32_t rgba;
+};
+
+// Set by AvoidanceSystem when it changes the tint, cleared by the extraction in Update(). A flag rather than a tag, so
+// a hit never moves the entity to another table (and never needs a structural change from a worker thread).
+struct TintDirtyComponent
+{
+	uint8_t dirty;
+};
+
+// Stable index into the instance buffers, assigned at spawn.
+struct RenderSlotComponent
+{
+	uint32_t index;
+};
+
 struct MoveComponent
 {
 	float velx, vely;
@@ -89,6 +127,16 @@ ECS_COMPONENT_DECLARE(WorldBoundsComponent);
 ECS_COMPONENT_DECLARE(PositionComponent);
 ECS_COMPONENT_DECLARE(SpriteComponent);
 ECS_COMPONENT_DECLARE(MoveComponent);
+ECS_COMPONENT_DECLARE(TintComponent);
+ECS_COMPONENT_DECLARE(TintDirtyComponent);
+ECS_COMPONENT_DECLARE(RenderSlotComponent);
+VO_ECS_COMPONENT(WorldBoundsComponent)
+VO_ECS_COMPONENT(PositionComponent)
+VO_ECS_COMPONENT(SpriteComponent)
+VO_ECS_COMPONENT(MoveComponent)
+VO_ECS_COMPONENT(TintComponent)
+VO_ECS_COMPONENT(TintDirtyComponent)
+VO_ECS_COMPONENT(RenderSlotComponent)
 
 // #NOTE: Two sets of resources (one in flight and one being used on CPU)
 const uint32_t gDataBufferCount = 2;
@@ -103,8 +151,12 @@ GpuCmdRing gGraphicsCmdRing = {};
 SwapChain* pSwapChain = NULL;
 Semaphore* pImageAcquiredSemaphore = NULL;
 
+// Saved on exit, warms up pipeline creation of the next run
+PipelineCacheFile gPipelineCache = {};
+
 Shader* pSpriteShader = NULL;
 Buffer* pSpriteVertexBuffers[gDataBufferCount] = { NULL };
+Buffer* pSpriteStaticBuffer = NULL;
 Buffer* pSpriteIndexBuffer = NULL;
 Buffer* pSpriteVertexBuffer = NULL;
 Pipeline* pSpritePipeline = NULL;
@@ -113,7 +165,10 @@ DescriptorSet* pDescriptorSetTexture = NULL;
 DescriptorSet* pDescriptorSetUniforms = NULL;
 Sampler* pLinearClampSampler = NULL;
 
-Texture* pSpriteTexture = NULL;
+// sprites.tex, streamed in after the first Load()
+TextureStreamer gSpriteStreamer = {};
+// gSpriteStreamer.mVersion each copy of pDescriptorSetTexture was last written with
+uint32_t gSpriteDescriptorVersions[gDataBufferCount] = {};
 
 uint32_t gFrameIndex = 0;
 
@@ -122,7 +177,8 @@ uint32_t gAvailableCores = 1;
 
 ecs_world_t* gECSWorld = NULL;
 
-ecs_query_t* gECSSpriteQuery = NULL;
+ecs_query_t* gECSPositionQuery = NULL;
+ecs_query_t* gECSDirtyTintQuery = NULL;
 ecs_query_t* gECSAvoidQuery = NULL;
 
 // Based on: https://github.com/aras-p/dod-playground
@@ -136,10 +192,63 @@ const uint32_t gAvoidEntityCount = 100;
 #endif
 const uint32_t gMaxSpriteCount = gAvoidEntityCount + gSpriteEntityCount;
 
-SpriteData gSpriteData[gMaxSpriteCount] = {};
+SpriteData       gSpriteData[gMaxSpriteCount] = {};
+SpriteStaticData gSpriteStaticData[gMaxSpriteCount] = {};
+uint32_t         gNextRenderSlot = 0;
+
+const float gGlobalScale = 0.05f;
+
+static uint32_t packColor(float r, float g, float b)
+{
+	return (uint32_t)(r * 255.0f) | ((uint32_t)(g * 255.0f) << 8) | ((uint32_t)(b * 255.0f) << 16) | 0xff000000u;
+}
 
 static bool gMultiThread = true;
 
+// Time-sliced avoidance: sprites far from every avoider are only tested every N-th tick (N <= 2^gAvoidanceSliceLog2).
+// Entities that could reach an avoider before their next test stay at N = 1.
+const uint32_t gMaxAvoidanceSliceLog2 = 4;
+const float    gMaxMoveSpeed = 20.0f;
+// Worst case per-tick closing speed: sprite bounce-out (2.1x) plus avoider moving straight at it (1x).
+const float    gMaxClosingSpeed = 3.1f * gMaxMoveSpeed;
+uint32_t       gAvoidanceSliceLog2 = 0;
+uint32_t       gAvoidanceTick = 0;
+bool           gRunAvoidanceBenchmark = false;
+
+// "Capture Frame Trace" (or "--frame-trace N" at startup) writes the next gFrameTraceFrames frames to
+// Debug/_VoECSExample.trace.json, with the flecs systems on their worker threads.
+uint32_t gFrameTraceFrames = 120;
+
+// GPU time and pipeline statistics of the two passes, shown under "Pass Metrics"
+uint32_t gSpritesPass = PASS_METRICS_NO_PASS;
+uint32_t gUIPass = PASS_METRICS_NO_PASS;
+
+// Counters are kept per flecs stage so the multi threaded system never shares a cache line.
+const uint32_t gMaxAvoidanceStages = 64;
+struct AvoidanceStats
+{
+	uint32_t mEvaluated;
+	uint32_t mHits;
+	uint32_t mLateHits; // hits found on a sprite that skipped its previous tick
+	uint32_t mPad[13];
+};
+AvoidanceStats gAvoidanceStats[gMaxAvoidanceStages] = {};
+
+static unsigned char gAvoidanceStatsCharArray[256] = {};
+static bstring       gAvoidanceStatsText = bfromarr(gAvoidanceStatsCharArray);
+
+static unsigned char gFlecsAllocStatsCharArray[256] = {};
+static bstring       gFlecsAllocStatsText = bfromarr(gFlecsAllocStatsCharArray);
+
+static unsigned char gAllocationStatsCharArray[1024] = {};
+static bstring       gAllocationStatsText = bfromarr(gAllocationStatsCharArray);
+
+static unsigned char gFrameTimesCharArray[1024] = {};
+static bstring       gFrameTimesText = bfromarr(gFrameTimesCharArray);
+
+static unsigned char gPassMetricsCharArray[1024] = {};
+static bstring       gPassMetricsText = bfromarr(gPassMetricsCharArray);
+
 UIComponent* pGUIWindow = nullptr;
 
 uint32_t gFontID = 0;
@@ -164,12 +273,31 @@ struct AvoidComponent
 	float distanceSq;
 };
 ECS_COMPONENT_DECLARE(AvoidComponent);
+VO_ECS_COMPONENT(AvoidComponent)
 
-void MoveSystem(ecs_iter_t* it)
+struct AvoidanceScheduleComponent
 {
-	PositionComponent* positions = ecs_field(it, PositionComponent, 0);
-	MoveComponent* moves = ecs_field(it, MoveComponent, 1);
-
+	float    timeBudget; // seconds after the last test in which the sprite can't reach the nearest avoider, halved
+	float    elapsed;    // seconds since the last test
+	uint16_t interval;   // ticks between avoidance tests, power of two
+	uint16_t slot;       // spreads distant sprites over the ticks of an interval
+};
+ECS_COMPONENT_DECLARE(AvoidanceScheduleComponent);
+VO_ECS_COMPONENT(AvoidanceScheduleComponent)
+
+// Term lists; field order of the queries and the system callbacks below is checked at compile time.
+typedef vo::System<vo::InOut<PositionComponent>, vo::InOut<MoveComponent>> MoveSystemDef;
+typedef vo::System<vo::InOut<PositionComponent>, vo::InOut<MoveComponent>, vo::InOut<TintComponent>,
+				   vo::InOut<TintDirtyComponent>, vo::InOut<AvoidanceScheduleComponent>, vo::Not<AvoidComponent>>
+	AvoidanceSystemDef;
+typedef vo::Query<vo::In<PositionComponent>, vo::In<TintComponent>, vo::In<AvoidComponent>> AvoidQuery;
+typedef vo::Query<vo::In<PositionComponent>, vo::In<RenderSlotComponent>> PositionQuery;
+typedef vo::Query<vo::In<TintComponent>, vo::In<RenderSlotComponent>, vo::InOut<TintDirtyComponent>> DirtyTintQuery;
+typedef vo::Query<vo::In<SpriteComponent>, vo::In<TintComponent>, vo::In<RenderSlotComponent>> StaticSpriteQuery;
+
+void MoveSystem(ecs_iter_t* it, vo::Span<PositionComponent> positions, vo::Span<MoveComponent> moves)
+{
+	const uint32_t              scope = frameTraceBeginCpuScope("MoveSystem");
 	const WorldBoundsComponent* bounds = ecs_singleton_get(it->world, WorldBoundsComponent);
 
 	for (int i = 0; i < it->count; i++)
@@ -203,6 +331,7 @@ void MoveSystem(ecs_iter_t* it)
 			pos.y = bounds->yMax;
 		}
 	}
+	frameTraceEndCpuScope(scope);
 }
 
 static float DistanceSq(PositionComponent a, PositionComponent b)
@@ -212,33 +341,80 @@ static float DistanceSq(PositionComponent a, PositionComponent b)
 	return dx * dx + dy * dy;
 }
 
-void AvoidanceSystem(ecs_iter_t* it)
+// Largest power of two interval (<= 2^gAvoidanceSliceLog2) during which the sprite cannot reach the nearest avoider,
+// at the current tick length. The interval is only the regular schedule: the time budget it came from is kept too, as
+// one long tick (hitch, reload, resize) would otherwise let the sprite cover far more than the slack before its test.
+static void ScheduleAvoidance(AvoidanceScheduleComponent& schedule, float nearestDistSq, float nearestRadiusSq, float deltaTime)
 {
-	PositionComponent* positions = ecs_field(it, PositionComponent, 0);
-	MoveComponent* moves = ecs_field(it, MoveComponent, 1);
-	SpriteComponent* sprites = ecs_field(it, SpriteComponent, 2);
+	schedule.elapsed = 0.0f;
+	schedule.timeBudget = 0.0f;
+	schedule.interval = 1;
+	if (gAvoidanceSliceLog2 == 0 || deltaTime <= 0.0f)
+		return;
+
+	float slack = sqrtf(nearestDistSq) - sqrtf(nearestRadiusSq);
+	schedule.timeBudget = 0.5f * slack / gMaxClosingSpeed;
+	float safeTicks = slack / (gMaxClosingSpeed * deltaTime);
+	while (schedule.interval < (1u << gAvoidanceSliceLog2) && float(schedule.interval * 2) <= safeTicks)
+		schedule.interval *= 2;
+}
+
+void AvoidanceSystem(ecs_iter_t* it, vo::Span<PositionComponent> positions, vo::Span<MoveComponent> moves,
+	vo::Span<TintComponent> tints, vo::Span<TintDirtyComponent> tintDirty, vo::Span<AvoidanceScheduleComponent> schedules,
+	vo::Without<AvoidComponent>)
+{
+	const uint32_t scope = frameTraceBeginCpuScope("AvoidanceSystem");
+	int32_t        stageId = ecs_stage_get_id(it->world);
+	ASSERT(stageId >= 0 && (uint32_t)stageId < gMaxAvoidanceStages);
+	AvoidanceStats& stats = gAvoidanceStats[stageId];
+	// The slider may have been lowered since an interval was picked; a sprite must not wait out the old, longer one.
+	// Slots need no clamping: they are drawn from the largest range and the test below only looks at their low bits.
+	const uint16_t  maxInterval = (uint16_t)(1u << gAvoidanceSliceLog2);
 
 	for (int i = 0; i < it->count; i++)
 	{
+		AvoidanceScheduleComponent& schedule = schedules[i];
+		if (schedule.interval > maxInterval)
+			schedule.interval = maxInterval;
+		// Skipped only while the next tick, assumed as long as this one, still fits the time budget
+		schedule.elapsed += it->delta_time;
+		if (((gAvoidanceTick + schedule.slot) & (schedule.interval - 1)) && schedule.elapsed + it->delta_time <= schedule.timeBudget)
+			continue;
+
 		PositionComponent& pos = positions[i];
 		MoveComponent& move = moves[i];
-		SpriteComponent& sprite = sprites[i];
+		TintComponent& tint = tints[i];
+
+		float nearestDistSq = FLT_MAX;
+		float nearestRadiusSq = 0.0f;
+		++stats.mEvaluated;
 
 		ecs_iter_t avoidIter = ecs_query_iter(it->world, gECSAvoidQuery);
 		while (ecs_query_next(&avoidIter))
 		{
-			PositionComponent* avoidPositions = ecs_field(&avoidIter, PositionComponent, 0);
-			SpriteComponent* avoidSprites = ecs_field(&avoidIter, SpriteComponent, 2);
-			AvoidComponent* avoidDistances = ecs_field(&avoidIter, AvoidComponent, 2);
+			vo::Span<const PositionComponent> avoidPositions = AvoidQuery::field<0>(&avoidIter);
+			vo::Span<const TintComponent>     avoidTints = AvoidQuery::field<1>(&avoidIter);
+			vo::Span<const AvoidComponent>    avoidDistances = AvoidQuery::field<2>(&avoidIter);
 
 			for (int j = 0; j < avoidIter.count; j++)
 			{
 				const PositionComponent& avoidPosition = avoidPositions[j];
-				const SpriteComponent& avoidSprite = avoidSprites[j];
+				const TintComponent& avoidTint = avoidTints[j];
 				const AvoidComponent& avoidDistance = avoidDistances[j];
 
-				if (DistanceSq(pos, avoidPosition) < avoidDistance.distanceSq)
+				float distSq = DistanceSq(pos, avoidPosition);
+				if (distSq < nearestDistSq)
+				{
+					nearestDistSq = distSq;
+					nearestRadiusSq = avoidDistance.distanceSq;
+				}
+
+				if (distSq < avoidDistance.distanceSq)
 				{
+					++stats.mHits;
+					if (schedule.interval > 1)
+						++stats.mLateHits;
+
 					// flip velocity
 					move.velx = -move.velx;
 					move.vely = -move.vely;
@@ -247,15 +423,24 @@ void AvoidanceSystem(ecs_iter_t* it)
 					pos.x += move.velx * it->delta_time * 1.1f;
 					pos.y += move.vely * it->delta_time * 1.1f;
 
-					sprite.colorR = avoidSprite.colorR;
-					sprite.colorG = avoidSprite.colorG;
-					sprite.colorB = avoidSprite.colorB;
+					// only flag an actual change, re-tinting with the same avoider costs nothing
+					if (tint.rgba != avoidTint.rgba)
+					{
+						tint.rgba = avoidTint.rgba;
+						tintDirty[i].dirty = 1;
+					}
 				}
 			}
 		}
+
+		ScheduleAvoidance(schedule, nearestDistSq, nearestRadiusSq, it->delta_time);
 	}
+	frameTraceEndCpuScope(scope);
 }
 
+static void requestAvoidanceBenchmark(void*) { gRunAvoidanceBenchmark = true; }
+static void requestFrameTrace(void*) { requestFrameTraceCapture(gFrameTraceFrames, "_VoECSExample.trace.json"); }
+
 struct CreationData
 {
 	WorldBoundsComponent* bounds;
@@ -271,9 +456,12 @@ static void createEntities(void* pData)
 	float x = randomFloat(data.bounds->xMin, data.bounds->xMax);
 	float y = randomFloat(data.bounds->yMin, data.bounds->yMax);
 
-	PositionComponent position = { x, y };
-	MoveComponent     move = createMoveComponent(10.0f, 20.0f);
-	SpriteComponent   sprite = {};
+	PositionComponent   position = { x, y };
+	MoveComponent       move = createMoveComponent(10.0f, gMaxMoveSpeed);
+	SpriteComponent     sprite = {};
+	TintComponent       tint = {};
+	RenderSlotComponent slot = { gNextRenderSlot++ };
+	ASSERT(slot.index < gMaxSpriteCount);
 
 	if (!strcmp(data.entityTypeName, "avoid"))
 	{
@@ -282,24 +470,27 @@ static void createEntities(void* pData)
 
 		position.x *= 0.2f;
 		position.y *= 0.2f;
-		sprite.colorR = randomFloat(0.5f, 1.0f);
-		sprite.colorG = randomFloat(0.5f, 1.0f);
-		sprite.colorB = randomFloat(0.5f, 1.0f);
+		tint.rgba = packColor(randomFloat(0.5f, 1.0f), randomFloat(0.5f, 1.0f), randomFloat(0.5f, 1.0f));
 		sprite.scale = 1.0f;
 		sprite.spriteIndex = 5;
 	}
 	else
 	{
-		sprite.colorR = 1.0f;
-		sprite.colorG = 1.0f;
-		sprite.colorB = 1.0f;
+		tint.rgba = packColor(1.0f, 1.0f, 1.0f);
 		sprite.scale = 0.5f;
 		sprite.spriteIndex = randomInt(0, 5);
+
+		AvoidanceScheduleComponent schedule = { 0.0f, 0.0f, 1, (uint16_t)randomInt(0, 1 << gMaxAvoidanceSliceLog2) };
+		ecs_set(gECSWorld, entityId, AvoidanceScheduleComponent, schedule);
+		TintDirtyComponent tintDirty = { 0 };
+		ecs_set(gECSWorld, entityId, TintDirtyComponent, tintDirty);
 	}
 
 	ecs_set(gECSWorld, entityId, PositionComponent, position);
 	ecs_set(gECSWorld, entityId, MoveComponent, move);
 	ecs_set(gECSWorld, entityId, SpriteComponent, sprite);
+	ecs_set(gECSWorld, entityId, TintComponent, tint);
+	ecs_set(gECSWorld, entityId, RenderSlotComponent, slot);
 }
 
 class EntityComponentSystem : public IApp
@@ -307,6 +498,24 @@ class EntityComponentSystem : public IApp
 public:
 	bool Init()
 	{
+		initStartupTrace();
+		startupTraceBegin("Init");
+
+		// Steady state Update()/Draw() must not allocate; "--alloc-guard" turns that into a hard failure.
+		AllocationTrackerSettings allocationSettings = {};
+		allocationSettings.mEnabled = true;
+		allocationSettings.mFailOnAllocation = hasCommandLineFlag(IApp::argc, IApp::argv, "--alloc-guard");
+		allocationSettings.mWarmupFrames = 60;
+		initAllocationTracker(&allocationSettings);
+
+		// Frame time percentiles and hitches in the UI, hitches logged with their scope breakdown, and a summary of the
+		// whole run in Debug/_VoECSExample.frametimes.csv at exit.
+		FrameTimeStatsSettings frameTimeSettings = {};
+		frameTimeSettings.mHitchThresholdMs = 33.3f;
+		frameTimeSettings.mWarmupFrames = 60;
+		frameTimeSettings.mWindowFrames = FRAME_TIME_MAX_WINDOW_FRAMES;
+		initFrameTimeStats(&frameTimeSettings);
+
 		// FILE PATHS
 		// Align resource dirs with PathStatement to ensure assets are found in Art/ and build output.
 		/*fsSetPathForResourceDir(pSystemFileIO, RD_SHADER_BINARIES, "CompiledShaders/");
@@ -318,18 +527,31 @@ public:
 
 		RendererDesc settings;
 		memset(&settings, 0, sizeof(settings));
+		startupTraceBegin("GPU configuration");
 		initGPUConfiguration(settings.pExtendedSettings);
+		startupTraceEnd();
+		startupTraceBegin("Renderer");
 		initRenderer(GetName(), &settings, &pRenderer);
+		startupTraceEnd();
 		// check for init success
 		if (!pRenderer) {
 			return false;
 		}
 		setupGPUConfigurationPlatformParameters(pRenderer, settings.pExtendedSettings);
 
+		startupTraceBegin("Queue and command ring");
+
 		QueueDesc queueDesc = {};
 		queueDesc.mType = QUEUE_TYPE_GRAPHICS;
 		queueDesc.mFlag = QUEUE_FLAG_INIT_MICROPROFILE;
 		initQueue(pRenderer, &queueDesc, &pGraphicsQueue);
+		initFrameTrace(pRenderer, pGraphicsQueue, gDataBufferCount);
+		initPassMetrics(pRenderer, pGraphicsQueue, gDataBufferCount);
+		gSpritesPass = addMetricsPass("Draw Sprites", PASS_METRICS_ALL);
+		gUIPass = addMetricsPass("Draw UI", PASS_METRICS_ALL);
+		const uint32_t startupTraceFrames = getCommandLineUint(IApp::argc, IApp::argv, "--frame-trace", 0);
+		if (startupTraceFrames)
+			requestFrameTraceCapture(startupTraceFrames, "_VoECSExample.trace.json");
 
 		GpuCmdRingDesc cmdRingDesc = {};
 		cmdRingDesc.pQueue = pGraphicsQueue;
@@ -339,16 +561,28 @@ public:
 		initGpuCmdRing(pRenderer, &cmdRingDesc, &gGraphicsCmdRing);
 
 		initSemaphore(pRenderer, &pImageAcquiredSemaphore);
+		startupTraceEnd();
 
 		{
+			startupTraceBegin("Root signature");
 			RootSignatureDesc rootDesc = {};
 			INIT_RS_DESC(rootDesc, "default.rootsig", "compute.rootsig");
 			initRootSignature(pRenderer, &rootDesc);
+			startupTraceEnd();
 		}
 
+		startupTraceBegin("Resource loader");
 		initResourceLoaderInterface(pRenderer);
+		startupTraceEnd();
+
+		// "--no-pipeline-cache" creates every pipeline cold, to compare against a warm start
+		startupTraceBegin("Pipeline cache");
+		const bool pipelineCacheEnabled = !hasCommandLineFlag(IApp::argc, IApp::argv, "--no-pipeline-cache");
+		loadPipelineCacheFile(pRenderer, "_VoECSExample.cache", pipelineCacheEnabled, &gPipelineCache);
+		startupTraceEnd();
 
 		// Load fonts
+		startupTraceBegin("Font system");
 		FontDesc font = {};
 		font.pFontPath = "TitilliumText/TitilliumText-Bold.otf";
 		fntDefineFonts(&font, 1, &gFontID);
@@ -357,18 +591,25 @@ public:
 		fontRenderDesc.pRenderer = pRenderer;
 		if (!initFontSystem(&fontRenderDesc))
 			return false; // report?
+		startupTraceEnd();
 
 		// Initialize Forge User Interface Rendering
+		startupTraceBegin("User interface");
 		UserInterfaceDesc uiRenderDesc = {};
 		uiRenderDesc.pRenderer = pRenderer;
 		initUserInterface(&uiRenderDesc);
+		startupTraceEnd();
 
 		// Initialize micro profiler and its UI.
+		startupTraceBegin("Profiler");
 		ProfilerDesc profiler = {};
 		profiler.pRenderer = pRenderer;
 		initProfiler(&profiler);
 
 		gGpuProfileToken = initGpuProfiler(pRenderer, pGraphicsQueue, "Graphics");
+		startupTraceEnd();
+
+		startupTraceBegin("Sprite resource requests");
 
 		SamplerDesc samplerDesc = { FILTER_LINEAR,
 									FILTER_LINEAR,
@@ -388,7 +629,7 @@ public:
 		spriteVbDesc.mDesc.mElementCount = gMaxSpriteCount;
 		spriteVbDesc.mDesc.mStructStride = sizeof(SpriteData);
 		spriteVbDesc.mDesc.mSize = gMaxSpriteCount * spriteVbDesc.mDesc.mStructStride;
-		spriteVbDesc.pData = gSpriteData;
+		spriteVbDesc.pData = NULL;
 		for (uint32_t i = 0; i < gDataBufferCount; ++i)
 		{
 			spriteVbDesc.ppBuffer = &pSpriteVertexBuffers[i];
@@ -422,13 +663,10 @@ public:
 		spriteVBDesc.ppBuffer = &pSpriteVertexBuffer;
 		addResource(&spriteVBDesc, NULL);
 
-		// Sprites texture
-		TextureLoadDesc textureDesc = {};
-		textureDesc.ppTexture = &pSpriteTexture;
-		// Textures representing color should be stored in SRGB or HDR format
-		textureDesc.mCreationFlag = TEXTURE_CREATION_FLAG_SRGB;
-		textureDesc.pFileName = "sprites.tex";
-		addResource(&textureDesc, NULL);
+		// Sprites texture, requested at the end of the first Load(); sprites are flat grey until then
+		const uint8_t spritePlaceholder[4] = { 160, 160, 160, 255 };
+		initTextureStreamer(&gSpriteStreamer, spritePlaceholder);
+		startupTraceEnd();
 
 		/************************************************************************/
 		// GUI
@@ -441,7 +679,72 @@ public:
 		Checkbox.pData = &gMultiThread;
 		luaRegisterWidget(uiAddComponentWidget(pGUIWindow, "Threading", &Checkbox, WIDGET_TYPE_CHECKBOX));
 
+		SliderUintWidget sliceWidget;
+		sliceWidget.mMin = 0;
+		sliceWidget.mMax = gMaxAvoidanceSliceLog2;
+		sliceWidget.mStep = 1;
+		sliceWidget.pData = &gAvoidanceSliceLog2;
+		luaRegisterWidget(uiAddComponentWidget(pGUIWindow, "Avoidance Time Slice (log2)", &sliceWidget, WIDGET_TYPE_SLIDER_UINT));
+
+		ButtonWidget benchmarkButton;
+		UIWidget*    pBenchmark = uiAddComponentWidget(pGUIWindow, "Benchmark Avoidance", &benchmarkButton, WIDGET_TYPE_BUTTON);
+		uiSetWidgetOnEditedCallback(pBenchmark, nullptr, requestAvoidanceBenchmark);
+		luaRegisterWidget(pBenchmark);
+
+		static float4     statsColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+		DynamicTextWidget statsWidget;
+		statsWidget.pText = &gAvoidanceStatsText;
+		statsWidget.pColor = &statsColor;
+		uiAddComponentWidget(pGUIWindow, "Avoidance Stats", &statsWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+		DynamicTextWidget allocStatsWidget;
+		allocStatsWidget.pText = &gFlecsAllocStatsText;
+		allocStatsWidget.pColor = &statsColor;
+		uiAddComponentWidget(pGUIWindow, "flecs Allocations", &allocStatsWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+		CheckboxWidget trackAllocationsCheckbox;
+		trackAllocationsCheckbox.pData = &getAllocationTrackerSettings()->mEnabled;
+		luaRegisterWidget(uiAddComponentWidget(pGUIWindow, "Track Frame Allocations", &trackAllocationsCheckbox, WIDGET_TYPE_CHECKBOX));
+
+		DynamicTextWidget frameAllocWidget;
+		frameAllocWidget.pText = &gAllocationStatsText;
+		frameAllocWidget.pColor = &statsColor;
+		uiAddComponentWidget(pGUIWindow, "Frame Allocations", &frameAllocWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+		SliderFloatWidget hitchThresholdWidget;
+		hitchThresholdWidget.mMin = 4.0f;
+		hitchThresholdWidget.mMax = 200.0f;
+		hitchThresholdWidget.mStep = 0.1f;
+		hitchThresholdWidget.pData = &getFrameTimeStatsSettings()->mHitchThresholdMs;
+		luaRegisterWidget(uiAddComponentWidget(pGUIWindow, "Hitch Threshold (ms)", &hitchThresholdWidget, WIDGET_TYPE_SLIDER_FLOAT));
+
+		DynamicTextWidget frameTimesWidget;
+		frameTimesWidget.pText = &gFrameTimesText;
+		frameTimesWidget.pColor = &statsColor;
+		uiAddComponentWidget(pGUIWindow, "Frame Times", &frameTimesWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+		DynamicTextWidget passMetricsWidget;
+		passMetricsWidget.pText = &gPassMetricsText;
+		passMetricsWidget.pColor = &statsColor;
+		uiAddComponentWidget(pGUIWindow, "Pass Metrics", &passMetricsWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+		SliderUintWidget frameTraceFramesWidget;
+		frameTraceFramesWidget.mMin = 1;
+		frameTraceFramesWidget.mMax = 1000;
+		frameTraceFramesWidget.mStep = 1;
+		frameTraceFramesWidget.pData = &gFrameTraceFrames;
+		luaRegisterWidget(uiAddComponentWidget(pGUIWindow, "Frame Trace Frames", &frameTraceFramesWidget, WIDGET_TYPE_SLIDER_UINT));
+
+		ButtonWidget frameTraceButton;
+		UIWidget*    pFrameTrace = uiAddComponentWidget(pGUIWindow, "Capture Frame Trace", &frameTraceButton, WIDGET_TYPE_BUTTON);
+		uiSetWidgetOnEditedCallback(pFrameTrace, nullptr, requestFrameTrace);
+		luaRegisterWidget(pFrameTrace);
+
+		startupTraceBegin("ECS world and entities");
 		initEntityComponentSystem();
+		// Hooked once the ECS has set up the flecs OS API (which would overwrite the hooks) and before the first world,
+		// so every block of the world comes from the pools
+		initFlecsAllocator();
 		ecs_log_set_level(0);
 
 		gECSWorld = ecs_init();
@@ -455,55 +758,17 @@ public:
 		ECS_COMPONENT_DEFINE(gECSWorld, WorldBoundsComponent);
 
 		ECS_COMPONENT_DEFINE(gECSWorld, AvoidComponent);
+		ECS_COMPONENT_DEFINE(gECSWorld, AvoidanceScheduleComponent);
+		ECS_COMPONENT_DEFINE(gECSWorld, TintComponent);
+		ECS_COMPONENT_DEFINE(gECSWorld, RenderSlotComponent);
+		ECS_COMPONENT_DEFINE(gECSWorld, TintDirtyComponent);
 
-		ecs_system_desc_t moveSystemDesc = {};
-		moveSystemDesc.callback = MoveSystem;
-		{
-			ecs_entity_desc_t entDesc = {};
-			entDesc.name = "MoveSystem";
-			ecs_id_t adds[] = { EcsOnUpdate, 0 };
-			entDesc.add = adds;
-			moveSystemDesc.entity = ecs_entity_init(gECSWorld, &entDesc);
-		}
-		moveSystemDesc.query.terms[0].id = ecs_id(PositionComponent);
-		moveSystemDesc.query.terms[0].inout = EcsInOut;
-		moveSystemDesc.query.terms[1].id = ecs_id(MoveComponent);
-		moveSystemDesc.query.terms[1].inout = EcsInOut;
-		moveSystemDesc.multi_threaded = false;
-		ecs_system_init(gECSWorld, &moveSystemDesc);
-
-		ecs_system_desc_t avoidanceSystemDesc = {};
-		avoidanceSystemDesc.callback = AvoidanceSystem;
-		{
-			ecs_entity_desc_t entDesc = {};
-			entDesc.name = "AvoidanceSystem";
-			ecs_id_t adds[] = { EcsPostUpdate, 0 };
-			entDesc.add = adds;
-			avoidanceSystemDesc.entity = ecs_entity_init(gECSWorld, &entDesc);
-		}
-		avoidanceSystemDesc.query.terms[0].id = ecs_id(PositionComponent);
-		avoidanceSystemDesc.query.terms[0].inout = EcsInOut;
-		avoidanceSystemDesc.query.terms[1].id = ecs_id(MoveComponent);
-		avoidanceSystemDesc.query.terms[1].inout = EcsInOut;
-		avoidanceSystemDesc.query.terms[2].id = ecs_id(SpriteComponent);
-		avoidanceSystemDesc.query.terms[2].inout = EcsOut;
-		avoidanceSystemDesc.query.terms[3].id = ecs_id(AvoidComponent);
-		avoidanceSystemDesc.query.terms[3].inout = EcsIn;
-		avoidanceSystemDesc.query.terms[3].oper = EcsNot;
-		avoidanceSystemDesc.multi_threaded = true;
-		ecs_system_init(gECSWorld, &avoidanceSystemDesc);
-
-		ecs_query_desc_t spriteQuery = {};
-		spriteQuery.terms[0].id = ecs_id(PositionComponent);
-		spriteQuery.terms[1].id = ecs_id(MoveComponent);
-		spriteQuery.terms[2].id = ecs_id(SpriteComponent);
-		spriteQuery.terms[3].id = ecs_id(AvoidComponent);
-		spriteQuery.terms[3].oper = EcsNot;
-		gECSSpriteQuery = ecs_query_init(gECSWorld, &spriteQuery);
-
-		ecs_query_desc_t avoidQuery = spriteQuery;
-		avoidQuery.terms[3].oper = EcsAnd;
-		gECSAvoidQuery = ecs_query_init(gECSWorld, &avoidQuery);
+		MoveSystemDef::init<MoveSystem>(gECSWorld, "MoveSystem", EcsOnUpdate, false);
+		AvoidanceSystemDef::init<AvoidanceSystem>(gECSWorld, "AvoidanceSystem", EcsPostUpdate, true);
+
+		gECSPositionQuery = PositionQuery::init(gECSWorld);
+		gECSDirtyTintQuery = DirtyTintQuery::init(gECSWorld);
+		gECSAvoidQuery = AvoidQuery::init(gECSWorld);
 
 		ecs_singleton_ensure(gECSWorld, WorldBoundsComponent);
 		WorldBoundsComponent* bounds = ecs_get_mut(gECSWorld, ecs_id(WorldBoundsComponent), WorldBoundsComponent);
@@ -526,24 +791,56 @@ public:
 		{
 			createEntities(&avoidData);
 		}
+		gDrawSpriteCount = gNextRenderSlot;
+
+		// Render-static data and initial tints are extracted once; per frame only positions and dirty tints are written.
+		ecs_query_t* staticQuery = StaticSpriteQuery::init(gECSWorld);
+		ecs_iter_t   staticIter = ecs_query_iter(gECSWorld, staticQuery);
+		while (ecs_query_next(&staticIter))
+		{
+			vo::Span<const SpriteComponent>     sprites = StaticSpriteQuery::field<0>(&staticIter);
+			vo::Span<const TintComponent>       tints = StaticSpriteQuery::field<1>(&staticIter);
+			vo::Span<const RenderSlotComponent> slots = StaticSpriteQuery::field<2>(&staticIter);
+			for (int i = 0; i < staticIter.count; i++)
+			{
+				SpriteStaticData& staticData = gSpriteStaticData[slots[i].index];
+				staticData.scale = sprites[i].scale * gGlobalScale;
+				staticData.sprite = (float)sprites[i].spriteIndex;
+				gSpriteData[slots[i].index].tint = tints[i].rgba;
+			}
+		}
+		ecs_query_fini(staticQuery);
+		startupTraceEnd();
+
+		BufferLoadDesc spriteStaticDesc = {};
+		spriteStaticDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+		spriteStaticDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+		spriteStaticDesc.mDesc.mStartState = RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+		spriteStaticDesc.mDesc.mElementCount = gMaxSpriteCount;
+		spriteStaticDesc.mDesc.mStructStride = sizeof(SpriteStaticData);
+		spriteStaticDesc.mDesc.mSize = gMaxSpriteCount * spriteStaticDesc.mDesc.mStructStride;
+		spriteStaticDesc.pData = gSpriteStaticData;
+		spriteStaticDesc.ppBuffer = &pSpriteStaticBuffer;
+		addResource(&spriteStaticDesc, NULL);
 
 		AddCustomInputBindings();
 
 		gFrameIndex = 0;
-		waitForAllResourceLoads();
-		if (pSpriteTexture)
-			LOGF(LogLevel::eINFO, "Loaded sprite texture '%s'", "sprites.tex");
-		else
-			LOGF(LogLevel::eERROR, "Failed to load sprite texture '%s'", "sprites.tex");
+		startupTraceWaitForLoads();
 
+		startupTraceEnd(); // Init
 		return true;
 	}
 
 	void Exit()
 	{
 		ecs_query_fini(gECSAvoidQuery);
-		ecs_query_fini(gECSSpriteQuery);
+		ecs_query_fini(gECSDirtyTintQuery);
+		ecs_query_fini(gECSPositionQuery);
 		ecs_fini(gECSWorld);
+		exitEntityComponentSystem();
+		// Only once flecs is fully torn down: teardown still frees blocks into the pools
+		exitFlecsAllocator();
 
 		exitProfiler();
 
@@ -555,7 +852,8 @@ public:
 		{
 			removeResource(pSpriteVertexBuffers[i]);
 		}
-		removeResource(pSpriteTexture);
+		removeResource(pSpriteStaticBuffer);
+		exitTextureStreamer(&gSpriteStreamer);
 		removeResource(pSpriteVertexBuffer);
 		removeResource(pSpriteIndexBuffer);
 
@@ -564,32 +862,51 @@ public:
 		exitSemaphore(pRenderer, pImageAcquiredSemaphore);
 		exitGpuCmdRing(pRenderer, &gGraphicsCmdRing);
 
+		savePipelineCacheFile(pRenderer, &gPipelineCache);
 		exitResourceLoaderInterface(pRenderer);
 		exitRootSignature(pRenderer);
+		exitFrameTimeStats("_VoECSExample.frametimes.csv");
+		exitPassMetrics();
+		exitFrameTrace();
 		exitQueue(pRenderer, pGraphicsQueue);
 		exitRenderer(pRenderer);
 		pRenderer = NULL;
 
 		exitGPUConfiguration();
+
+		if (!exitAllocationTracker())
+			setShutdownExitCode(EXIT_FAILURE);
 	}
 
 	bool Load(ReloadDesc* pReloadDesc)
 	{
+		startupTraceBegin("Load");
 		if (pReloadDesc->mType & RELOAD_TYPE_SHADER)
 		{
+			startupTraceBegin("Shaders");
 			addShaders();
+			startupTraceEnd();
+			startupTraceBegin("Descriptor sets");
 			addDescriptorSets();
+			startupTraceEnd();
 		}
 
 		if (pReloadDesc->mType & (RELOAD_TYPE_RESIZE | RELOAD_TYPE_RENDERTARGET))
 		{
+			startupTraceBegin("Swap chain");
 			if (!addSwapChain())
 				return false;
+			startupTraceEnd();
 		}
 
 		if (pReloadDesc->mType & (RELOAD_TYPE_SHADER | RELOAD_TYPE_RENDERTARGET))
 		{
+			startupTraceBegin("Pipelines");
+			HiresTimer pipelineTimer;
+			initHiresTimer(&pipelineTimer);
 			addPipelines();
+			logPipelineCreation(&gPipelineCache, "ECS", getHiresTimerUSec(&pipelineTimer, false));
+			startupTraceEnd();
 		}
 
 		loadProfilerUI(mSettings.mWidth, mSettings.mHeight);
@@ -611,6 +928,20 @@ public:
 
 		initScreenshotCapturer(pRenderer, pGraphicsQueue, GetName());
 
+		// After every wait of the first Load(), so the first frame goes out with the placeholder instead of waiting on disk
+		if (!gSpriteStreamer.mTextureCount)
+		{
+			startupTraceBegin("Sprite texture request");
+			requestStreamedTexture(&gSpriteStreamer, "sprites.tex", TEXTURE_CREATION_FLAG_SRGB);
+			startupTraceEnd();
+		}
+
+		allocationTrackerRestartWarmup();
+		frameTimeStatsRestartWarmup();
+		resetPassMetrics();
+
+		startupTraceEnd(); // Load
+		finishStartupTrace("_VoECSExample_StartupTrace.json");
 		return true;
 	}
 
@@ -643,6 +974,17 @@ public:
 
 	void Update(float deltaTime)
 	{
+		allocationTrackerBeginFrame();
+		frameTraceBeginFrame();
+		const uint32_t updateScope = frameTraceBeginCpuScope("Update");
+		if (allocationTrackerFailed())
+			requestShutdown();
+		bformat(&gAllocationStatsText, "%s", getAllocationTrackerSummary());
+		bformat(&gFrameTimesText, "%s", getFrameTimeStatsSummary());
+		bformat(&gPassMetricsText, "%s", getPassMetricsSummary());
+
+		updateTextureStreamer(&gSpriteStreamer);
+
 		static bool oldMultiThread = gMultiThread;
 		if (oldMultiThread != gMultiThread)
 		{
@@ -650,58 +992,67 @@ public:
 			ecs_set_threads(gECSWorld, gMultiThread ? gAvailableCores : 1);
 		}
 
+		if (gRunAvoidanceBenchmark)
+		{
+			gRunAvoidanceBenchmark = false;
+			runAvoidanceBenchmark();
+			allocationTrackerRestartWarmup();
+			frameTimeStatsRestartWarmup();
+		}
+
+		flecsAllocatorNewFrame();
+		const FlecsAllocatorStats* pAllocStats = getFlecsAllocatorStats();
+		bformat(&gFlecsAllocStatsText, "allocs/frame %u (heap %u), frees %u, in use %.1f KB, peak %.1f KB, reserved %.1f KB",
+				pAllocStats->mFrameAllocCount, pAllocStats->mFrameHeapAllocCount, pAllocStats->mFrameFreeCount,
+				pAllocStats->mBytesInUse / 1024.0f, pAllocStats->mPeakBytesInUse / 1024.0f, pAllocStats->mBytesReserved / 1024.0f);
+
 		// Scene Update
+		memset(gAvoidanceStats, 0, sizeof(gAvoidanceStats));
+		++gAvoidanceTick;
+		const uint32_t progressScope = frameTraceBeginCpuScope("ecs_progress");
 		ecs_progress(gECSWorld, deltaTime * 3.0f);
+		frameTraceEndCpuScope(progressScope);
 
-		// Iterate all entities with transform and plane component
-		gDrawSpriteCount = 0;
-		float globalScale = 0.05f;
+		AvoidanceStats frameStats = sumAvoidanceStats();
+		bformat(&gAvoidanceStatsText, "Tested %u / %u sprites, hits %u (late %u)", frameStats.mEvaluated, gSpriteEntityCount,
+				frameStats.mHits, frameStats.mLateHits);
 
-		ecs_iter_t spriteIter = ecs_query_iter(gECSWorld, gECSSpriteQuery);
-		while (ecs_query_next(&spriteIter))
+		// Positions change every tick; tints only where AvoidanceSystem flagged them. Slots are stable, so the
+		// static buffer uploaded at Init stays valid.
+		ecs_iter_t positionIter = ecs_query_iter(gECSWorld, gECSPositionQuery);
+		while (ecs_query_next(&positionIter))
 		{
-			PositionComponent* positions = ecs_field(&spriteIter, PositionComponent, 0);
-			SpriteComponent* sprites = ecs_field(&spriteIter, SpriteComponent, 2);
-			for (int i = 0; i < spriteIter.count; i++)
+			vo::Span<const PositionComponent>   positions = PositionQuery::field<0>(&positionIter);
+			vo::Span<const RenderSlotComponent> slots = PositionQuery::field<1>(&positionIter);
+			for (int i = 0; i < positionIter.count; i++)
 			{
-				const PositionComponent& position = positions[i];
-				const SpriteComponent& sprite = sprites[i];
-				SpriteData& spriteData = gSpriteData[gDrawSpriteCount++];
-				spriteData.posX = position.x * globalScale;
-				spriteData.posY = position.y * globalScale;
-				spriteData.scale = sprite.scale * globalScale;
-				spriteData.colR = sprite.colorR;
-				spriteData.colG = sprite.colorG;
-				spriteData.colB = sprite.colorB;
-				spriteData.sprite = (float)sprite.spriteIndex;
+				SpriteData& spriteData = gSpriteData[slots[i].index];
+				spriteData.posX = positions[i].x * gGlobalScale;
+				spriteData.posY = positions[i].y * gGlobalScale;
 			}
 		}
 
-		ecs_iter_t avoidIter = ecs_query_iter(gECSWorld, gECSAvoidQuery);
-		while (ecs_query_next(&avoidIter))
+		ecs_iter_t tintIter = ecs_query_iter(gECSWorld, gECSDirtyTintQuery);
+		while (ecs_query_next(&tintIter))
 		{
-			PositionComponent* positions = ecs_field(&avoidIter, PositionComponent, 0);
-			SpriteComponent* sprites = ecs_field(&avoidIter, SpriteComponent, 2);
-			for (int i = 0; i < avoidIter.count; i++)
+			vo::Span<const TintComponent>       tints = DirtyTintQuery::field<0>(&tintIter);
+			vo::Span<const RenderSlotComponent> slots = DirtyTintQuery::field<1>(&tintIter);
+			vo::Span<TintDirtyComponent>        tintDirty = DirtyTintQuery::field<2>(&tintIter);
+			for (int i = 0; i < tintIter.count; i++)
 			{
-				const PositionComponent& position = positions[i];
-				const SpriteComponent& sprite = sprites[i];
-
-				SpriteData& spriteData = gSpriteData[gDrawSpriteCount++];
-				spriteData.posX = position.x * globalScale;
-				spriteData.posY = position.y * globalScale;
-				spriteData.scale = sprite.scale * globalScale;
-				spriteData.colR = sprite.colorR;
-				spriteData.colG = sprite.colorG;
-				spriteData.colB = sprite.colorB;
-				spriteData.sprite = (float)sprite.spriteIndex;
+				if (!tintDirty[i].dirty)
+					continue;
+				gSpriteData[slots[i].index].tint = tints[i].rgba;
+				tintDirty[i].dirty = 0;
 			}
 		}
+		frameTraceEndCpuScope(updateScope);
 	}
 
 	void Draw()
 	{
-		const bool swapVsyncEnabled = pSwapChain->mEnableVsync != 0;
+		const uint32_t drawScope = frameTraceBeginCpuScope("Draw");
+		const bool     swapVsyncEnabled = pSwapChain->mEnableVsync != 0;
 		if (swapVsyncEnabled != mSettings.mVSyncEnabled)
 		{
 			waitQueueIdle(pGraphicsQueue);
@@ -721,8 +1072,10 @@ public:
 			requestShutdown();
 		}
 
-		uint32_t swapchainImageIndex;
+		uint32_t       swapchainImageIndex;
+		const uint32_t acquireScope = frameTraceBeginCpuScope("Acquire Image");
 		acquireNextImage(pRenderer, pSwapChain, pImageAcquiredSemaphore, NULL, &swapchainImageIndex);
+		frameTraceEndCpuScope(acquireScope);
 
 		// Update vertex buffer
 		ASSERT(gDrawSpriteCount >= 0 && gDrawSpriteCount <= gMaxSpriteCount);
@@ -734,21 +1087,30 @@ public:
 
 		// Stall if CPU is running "gDataBufferCount" frames ahead of GPU
 		GpuCmdRingElement elem = getNextGpuCmdRingElement(&gGraphicsCmdRing, true, 1);
+		const uint32_t    fenceScope = frameTraceBeginCpuScope("Wait For GPU");
 		FenceStatus       fenceStatus;
 		getFenceStatus(pRenderer, elem.pFence, &fenceStatus);
 		if (fenceStatus == FENCE_STATUS_INCOMPLETE)
 		{
 			waitForFences(pRenderer, 1, &elem.pFence);
 		}
+		frameTraceEndCpuScope(fenceScope);
+
+		// This frame's copy is idle now, point it at the sprite texture once it finished streaming
+		if (gSpriteDescriptorVersions[gFrameIndex] != gSpriteStreamer.mVersion)
+			updateSpriteDescriptorSet(gFrameIndex);
 
 		resetCmdPool(pRenderer, elem.pCmdPool);
 
 		RenderTarget* pRenderTarget = pSwapChain->ppRenderTargets[swapchainImageIndex];
 
 		// simply record the screen cleaning command
-		Cmd* cmd = elem.pCmds[0];
+		Cmd*           cmd = elem.pCmds[0];
+		const uint32_t recordScope = frameTraceBeginCpuScope("Record Commands");
 		beginCmd(cmd);
 		cmdBeginGpuFrameProfile(cmd, gGpuProfileToken);
+		frameTraceBeginGpuFrame(cmd, gFrameIndex);
+		passMetricsBeginFrame(cmd, gFrameIndex);
 
 		RenderTargetBarrier barriers[] = {
 			{ pRenderTarget, RESOURCE_STATE_PRESENT, RESOURCE_STATE_RENDER_TARGET },
@@ -766,17 +1128,23 @@ public:
 		if (gDrawSpriteCount > 0)
 		{
 			cmdBeginDebugMarker(cmd, 1, 0, 1, "Draw Sprites");
+			frameTraceBeginGpuRange(cmd, "Draw Sprites");
+			passMetricsBeginPass(cmd, gSpritesPass);
 			cmdBindPipeline(cmd, pSpritePipeline);
-			cmdBindDescriptorSet(cmd, 0, pDescriptorSetTexture);
+			cmdBindDescriptorSet(cmd, gFrameIndex, pDescriptorSetTexture);
 			cmdBindDescriptorSet(cmd, gFrameIndex, pDescriptorSetUniforms);
 			uint32_t vertexStride = sizeof(float);
 			cmdBindVertexBuffer(cmd, 1, &pSpriteVertexBuffer, &vertexStride, NULL);
 			cmdBindIndexBuffer(cmd, pSpriteIndexBuffer, INDEX_TYPE_UINT16, 0);
 			cmdDrawIndexedInstanced(cmd, 6, 0, gDrawSpriteCount, 0, 0);
+			passMetricsEndPass(cmd, gSpritesPass);
+			frameTraceEndGpuRange(cmd);
 			cmdEndDebugMarker(cmd);
 		}
 
 		cmdBeginDebugMarker(cmd, 0, 1, 0, "Draw UI");
+		frameTraceBeginGpuRange(cmd, "Draw UI");
+		passMetricsBeginPass(cmd, gUIPass);
 
 		FontDrawDesc uiTextDesc; // default
 		uiTextDesc.mFontColor = 0xff00cc00;
@@ -786,14 +1154,20 @@ public:
 		cmdDrawGpuProfile(cmd, float2(8.0f, txtSize.y + 75.f), gGpuProfileToken, &uiTextDesc);
 
 		cmdDrawUserInterface(cmd);
+		// Inside the render pass it was begun in, a query can't span the render pass boundary
+		passMetricsEndPass(cmd, gUIPass);
 		cmdBindRenderTargets(cmd, NULL);
+		frameTraceEndGpuRange(cmd);
 		cmdEndDebugMarker(cmd);
 
 		barriers[0] = { pRenderTarget, RESOURCE_STATE_RENDER_TARGET, RESOURCE_STATE_PRESENT };
 		cmdResourceBarrier(cmd, 0, NULL, 0, NULL, 1, barriers);
 
 		cmdEndGpuFrameProfile(cmd, gGpuProfileToken);
+		passMetricsEndFrame(cmd);
+		frameTraceEndGpuFrame(cmd);
 		endCmd(cmd);
+		frameTraceEndCpuScope(recordScope);
 
 		FlushResourceUpdateDesc flushUpdateDesc = {};
 		flushUpdateDesc.mNodeIndex = 0;
@@ -808,21 +1182,87 @@ public:
 		submitDesc.ppSignalSemaphores = &elem.pSemaphore;
 		submitDesc.ppWaitSemaphores = waitSemaphores;
 		submitDesc.pSignalFence = elem.pFence;
+		const uint32_t submitScope = frameTraceBeginCpuScope("Submit");
 		queueSubmit(pGraphicsQueue, &submitDesc);
+		frameTraceEndCpuScope(submitScope);
 		QueuePresentDesc presentDesc = {};
 		presentDesc.mIndex = (uint8_t)swapchainImageIndex;
 		presentDesc.mWaitSemaphoreCount = 1;
 		presentDesc.ppWaitSemaphores = &elem.pSemaphore;
 		presentDesc.pSwapChain = pSwapChain;
 		presentDesc.mSubmitDone = true;
+		const uint32_t presentScope = frameTraceBeginCpuScope("Present");
 		queuePresent(pGraphicsQueue, &presentDesc);
+		frameTraceEndCpuScope(presentScope);
 		flipProfiler();
 
 		gFrameIndex = (gFrameIndex + 1) % gDataBufferCount;
+
+		frameTraceEndCpuScope(drawScope);
+
+		// GPU frame time is from the frame that last used this command pool
+		addFrameTimeSample(FRAME_TIME_FENCE_WAIT, getFrameTraceScopeMs("Wait For GPU"));
+		addFrameTimeSample(FRAME_TIME_PRESENT, getFrameTraceScopeMs("Present"));
+		if (pRenderer->pGpu->mTimestampQueries)
+			addFrameTimeSample(FRAME_TIME_GPU_FRAME, getGpuProfileTime(gGpuProfileToken));
+		frameTimeStatsEndFrame();
+		allocationTrackerEndFrame();
 	}
 
 	const char* GetName() { return "_VoECSExample"; }
 
+	static AvoidanceStats sumAvoidanceStats()
+	{
+		AvoidanceStats total = {};
+		for (uint32_t i = 0; i < gMaxAvoidanceStages; ++i)
+		{
+			total.mEvaluated += gAvoidanceStats[i].mEvaluated;
+			total.mHits += gAvoidanceStats[i].mHits;
+			total.mLateHits += gAvoidanceStats[i].mLateHits;
+		}
+		return total;
+	}
+
+	// Steps the simulation with a fixed time step for every slice setting and logs CPU cost against quality.
+	// "late hits" are collisions detected on a sprite that had skipped its previous tick, i.e. the sprite already
+	// overlapped an avoider before being tested; with a conservative closing speed this should stay at zero.
+	void runAvoidanceBenchmark()
+	{
+		const uint32_t tickCount = 120;
+		const float    fixedDeltaTime = 3.0f / 60.0f;
+		const uint32_t savedSliceLog2 = gAvoidanceSliceLog2;
+
+		LOGF(LogLevel::eINFO, "Avoidance benchmark: %u sprites, %u avoiders, %u ticks per setting", gSpriteEntityCount,
+			 gAvoidEntityCount, tickCount);
+		LOGF(LogLevel::eINFO, "   K | ms/tick | tested/tick | hits/tick | late hits/tick");
+
+		for (uint32_t sliceLog2 = 0; sliceLog2 <= gMaxAvoidanceSliceLog2; ++sliceLog2)
+		{
+			gAvoidanceSliceLog2 = sliceLog2;
+			AvoidanceStats total = {};
+
+			HiresTimer timer;
+			initHiresTimer(&timer);
+			for (uint32_t tick = 0; tick < tickCount; ++tick)
+			{
+				memset(gAvoidanceStats, 0, sizeof(gAvoidanceStats));
+				++gAvoidanceTick;
+				ecs_progress(gECSWorld, fixedDeltaTime);
+
+				AvoidanceStats tickStats = sumAvoidanceStats();
+				total.mEvaluated += tickStats.mEvaluated;
+				total.mHits += tickStats.mHits;
+				total.mLateHits += tickStats.mLateHits;
+			}
+			float elapsedMs = getHiresTimerUSec(&timer, false) / 1000.0f;
+
+			LOGF(LogLevel::eINFO, "%4u | %7.3f | %11.1f | %9.2f | %14.3f", 1u << sliceLog2, elapsedMs / tickCount,
+				 (float)total.mEvaluated / tickCount, (float)total.mHits / tickCount, (float)total.mLateHits / tickCount);
+		}
+
+		gAvoidanceSliceLog2 = savedSliceLog2;
+	}
+
 	bool addSwapChain()
 	{
 		SwapChainDesc swapChainDesc = {};
@@ -843,7 +1283,7 @@ public:
 
 	void addDescriptorSets()
 	{
-		DescriptorSetDesc setDescPersistent = SRT_SET_DESC(SrtData, Persistent, 1, 0);
+		DescriptorSetDesc setDescPersistent = SRT_SET_DESC(SrtData, Persistent, gDataBufferCount, 0);
 		addDescriptorSet(pRenderer, &setDescPersistent, &pDescriptorSetTexture);
 		DescriptorSetDesc setDescPerFrame = SRT_SET_DESC(SrtData, PerFrame, gDataBufferCount, 0);
 		addDescriptorSet(pRenderer, &setDescPerFrame, &pDescriptorSetUniforms);
@@ -898,6 +1338,7 @@ public:
 		PipelineDesc desc = {};
 		desc.mType = PIPELINE_TYPE_GRAPHICS;
 		PIPELINE_LAYOUT_DESC(desc, SRT_LAYOUT_DESC(SrtData, Persistent), SRT_LAYOUT_DESC(SrtData, PerFrame), NULL, NULL);
+		desc.pCache = gPipelineCache.pCache;
 		GraphicsPipelineDesc& pipelineSettings = desc.mGraphicsDesc;
 		pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
 		pipelineSettings.mRenderTargetCount = 1;
@@ -915,17 +1356,27 @@ public:
 
 	void removePipelines() { removePipeline(pRenderer, pSpritePipeline); }
 
-	void prepareDescriptorSets()
+	// Copy index of pDescriptorSetTexture gets the sprite texture, or the placeholder while it is streaming.
+	void updateSpriteDescriptorSet(uint32_t index)
 	{
-		DescriptorData params[2] = {};
+		Texture*       pTexture = getStreamedTexture(&gSpriteStreamer, 0);
+		DescriptorData params[3] = {};
 		params[0].mIndex = SRT_RES_IDX(SrtData, Persistent, uTexture0);
-		params[0].ppTextures = &pSpriteTexture;
+		params[0].ppTextures = &pTexture;
 		params[1].mIndex = SRT_RES_IDX(SrtData, Persistent, uSampler0);
 		params[1].ppSamplers = &pLinearClampSampler;
-		updateDescriptorSet(pRenderer, 0, pDescriptorSetTexture, TF_ARRAY_COUNT(params), params);
+		params[2].mIndex = SRT_RES_IDX(SrtData, Persistent, staticInstanceBuffer);
+		params[2].ppBuffers = &pSpriteStaticBuffer;
+		updateDescriptorSet(pRenderer, index, pDescriptorSetTexture, TF_ARRAY_COUNT(params), params);
+		gSpriteDescriptorVersions[index] = gSpriteStreamer.mVersion;
+	}
 
+	void prepareDescriptorSets()
+	{
 		for (uint32_t i = 0; i < gDataBufferCount; ++i)
 		{
+			updateSpriteDescriptorSet(i);
+
 			DescriptorData perFrame[1] = {};
 			perFrame[0].mIndex = SRT_RES_IDX(SrtData, PerFrame, instanceBuffer);
 			perFrame[0].ppBuffers = &pSpriteVertexBuffers[i];
@@ -934,4 +1385,13 @@ public:
 	}
 };
 
+#if defined(VO_WRAP_APPLICATION_MAIN)
+// The platform main runs Exit() and tears The Forge down, the shutdown exit code is returned once it has
+#define main platformMain
+DEFINE_APPLICATION_MAIN(EntityComponentSystem)
+#undef main
+
+int main(int argc, char** argv) { return applyShutdownExitCode(platformMain(argc, argv)); }
+#else
 DEFINE_APPLICATION_MAIN(EntityComponentSystem)
+#endif
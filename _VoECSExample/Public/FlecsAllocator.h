@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+// Routes flecs' OS API allocation hooks (malloc_/calloc_/realloc_/free_) through size-class pools carved out of
+// tf_malloc'd slabs, so flecs memory shows up in The Forge memory tracking and steady-state table growth,
+// query caches and command buffers recycle blocks instead of hitting the heap.
+//
+// Call initFlecsAllocator() after initEntityComponentSystem(), which sets up the flecs OS API and would overwrite the
+// hooks, and before ecs_init(), so every block of the world comes from the pools. Call exitFlecsAllocator() after
+// exitEntityComponentSystem() has returned, once flecs is fully torn down.
+
+struct FlecsAllocatorStats
+{
+	// Reset by flecsAllocatorNewFrame()
+	uint32_t mFrameAllocCount;    // malloc/calloc/realloc calls made by flecs
+	uint32_t mFrameFreeCount;
+	uint32_t mFrameHeapAllocCount; // calls that had to go to tf_malloc (new slab or large block)
+
+	// Running totals
+	uint64_t mBytesInUse; // bytes requested by flecs and not freed yet
+	uint64_t mPeakBytesInUse;
+	uint64_t mBytesReserved; // slabs + large blocks held from tf_malloc
+};
+
+void initFlecsAllocator();
+void exitFlecsAllocator();
+
+// Snapshots the per-frame counters into the stats returned by getFlecsAllocatorStats() and resets them.
+void flecsAllocatorNewFrame();
+
+// Counters of the last completed frame plus running totals.
+const FlecsAllocatorStats* getFlecsAllocatorStats();
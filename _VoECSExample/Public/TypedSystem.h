@@ -0,0 +1,235 @@
+#pragma once
+
+// Compile-time typed wrappers over flecs query/system descriptors.
+//
+// A term list such as
+//     vo::System<vo::InOut<PositionComponent>, vo::InOut<MoveComponent>, vo::Out<SpriteComponent>, vo::Not<AvoidComponent>>
+// fills ecs_query_desc_t::terms at compile time and hands the callback one typed span per term, in term order:
+//     void AvoidanceSystem(ecs_iter_t* it, vo::Span<PositionComponent>, vo::Span<MoveComponent>, vo::Span<SpriteComponent>,
+//                          vo::Without<AvoidComponent>);
+// The callback is a template argument, so a field in the wrong order or with the wrong constness fails to compile,
+// and the trampoline calls it directly (no per-field lookup by magic index, body can be inlined and vectorized).
+//
+// Every component used in a term list needs VO_ECS_COMPONENT(T) after its ECS_COMPONENT_DECLARE(T).
+
+#include "Game/ThirdParty/OpenSource/flecs/flecs.h"
+
+namespace vo
+{
+// Maps a component type to the id flecs assigned to it in ECS_COMPONENT_DEFINE.
+template<typename T>
+struct ComponentId;
+
+#define VO_ECS_COMPONENT(T)                                 \
+	namespace vo                                            \
+	{                                                       \
+	template<>                                              \
+	struct ComponentId<T>                                   \
+	{                                                       \
+		static ecs_entity_t get() { return ecs_id(T); }     \
+	};                                                      \
+	}
+
+// Contiguous view of one query field for the current table.
+template<typename T>
+struct Span
+{
+	T*      pData;
+	int32_t mCount;
+
+	T&      operator[](int32_t i) const { return pData[i]; }
+	T*      begin() const { return pData; }
+	T*      end() const { return pData + mCount; }
+	int32_t size() const { return mCount; }
+};
+
+// Placeholders passed for With<T>/Not<T> filter terms, keep callback parameters aligned with term indices.
+template<typename T>
+struct Has
+{
+};
+
+template<typename T>
+struct Without
+{
+};
+
+template<typename T, ecs_inout_kind_t InOutKind, ecs_oper_kind_t OperKind, typename FieldT>
+struct Term
+{
+	typedef T      Component;
+	typedef FieldT Field;
+
+	static void fill(ecs_term_t* pTerm)
+	{
+		pTerm->id = ComponentId<T>::get();
+		pTerm->inout = InOutKind;
+		pTerm->oper = OperKind;
+	}
+};
+
+template<typename T>
+struct In: Term<T, EcsIn, EcsAnd, Span<const T>>
+{
+};
+
+template<typename T>
+struct Out: Term<T, EcsOut, EcsAnd, Span<T>>
+{
+};
+
+template<typename T>
+struct InOut: Term<T, EcsInOut, EcsAnd, Span<T>>
+{
+};
+
+// Filter terms: match on presence (tags) or absence of T without fetching data.
+template<typename T>
+struct With: Term<T, EcsInOutNone, EcsAnd, Has<T>>
+{
+};
+
+template<typename T>
+struct Not: Term<T, EcsInOutNone, EcsNot, Without<T>>
+{
+};
+
+namespace detail
+{
+template<int... I>
+struct IndexList
+{
+};
+
+template<int N, int... I>
+struct MakeIndexList: MakeIndexList<N - 1, N - 1, I...>
+{
+};
+
+template<int... I>
+struct MakeIndexList<0, I...>
+{
+	typedef IndexList<I...> Type;
+};
+
+template<int I, typename... Terms>
+struct TermAt;
+
+template<typename Head, typename... Tail>
+struct TermAt<0, Head, Tail...>
+{
+	typedef Head Type;
+};
+
+template<int I, typename Head, typename... Tail>
+struct TermAt<I, Head, Tail...>: TermAt<I - 1, Tail...>
+{
+};
+
+template<typename FieldT>
+struct FieldFetch;
+
+template<typename T>
+struct FieldFetch<Span<T>>
+{
+	static Span<T> get(ecs_iter_t* it, int8_t index)
+	{
+		Span<T> span = { (T*)ecs_field_w_size(it, sizeof(T), index), it->count };
+		return span;
+	}
+};
+
+template<typename T>
+struct FieldFetch<Has<T>>
+{
+	static Has<T> get(ecs_iter_t*, int8_t) { return Has<T>(); }
+};
+
+template<typename T>
+struct FieldFetch<Without<T>>
+{
+	static Without<T> get(ecs_iter_t*, int8_t) { return Without<T>(); }
+};
+
+template<typename... Terms>
+struct TermList
+{
+	static void fill(ecs_term_t*) {}
+};
+
+template<typename Head, typename... Tail>
+struct TermList<Head, Tail...>
+{
+	static void fill(ecs_term_t* pTerms)
+	{
+		Head::fill(pTerms);
+		TermList<Tail...>::fill(pTerms + 1);
+	}
+};
+} // namespace detail
+
+template<typename... Terms>
+struct Query
+{
+	static const int kTermCount = (int)sizeof...(Terms);
+	static_assert(kTermCount > 0 && kTermCount <= FLECS_TERM_COUNT_MAX, "Term count out of range");
+
+	template<int I>
+	using FieldType = typename detail::TermAt<I, Terms...>::Type::Field;
+
+	typedef void (*Callback)(ecs_iter_t* it, typename Terms::Field...);
+
+	static void fillTerms(ecs_query_desc_t* pDesc) { detail::TermList<Terms...>::fill(pDesc->terms); }
+
+	static ecs_query_t* init(ecs_world_t* pWorld)
+	{
+		ecs_query_desc_t desc = {};
+		fillTerms(&desc);
+		return ecs_query_init(pWorld, &desc);
+	}
+
+	// Typed replacement for ecs_field(it, T, I); index and type come from the term list.
+	template<int I>
+	static FieldType<I> field(ecs_iter_t* it)
+	{
+		return detail::FieldFetch<FieldType<I>>::get(it, (int8_t)I);
+	}
+
+	template<Callback Fn>
+	static void invoke(ecs_iter_t* it)
+	{
+		invokeFields<Fn>(it, typename detail::MakeIndexList<kTermCount>::Type());
+	}
+
+private:
+	template<Callback Fn, int... I>
+	static void invokeFields(ecs_iter_t* it, detail::IndexList<I...>)
+	{
+		Fn(it, field<I>(it)...);
+	}
+};
+
+template<typename... Terms>
+struct System: Query<Terms...>
+{
+	typedef Query<Terms...> QueryType;
+
+	// Registers Fn as a system running in the given pipeline phase (EcsOnUpdate, EcsPostUpdate, ...).
+	template<typename QueryType::Callback Fn>
+	static ecs_entity_t init(ecs_world_t* pWorld, const char* pName, ecs_entity_t phase, bool multiThreaded)
+	{
+		ecs_system_desc_t desc = {};
+		desc.callback = &QueryType::template invoke<Fn>;
+		{
+			ecs_entity_desc_t entDesc = {};
+			entDesc.name = pName;
+			ecs_id_t adds[] = { phase, 0 };
+			entDesc.add = adds;
+			desc.entity = ecs_entity_init(pWorld, &entDesc);
+		}
+		QueryType::fillTerms(&desc.query);
+		desc.multi_threaded = multiThreaded;
+		return ecs_system_init(pWorld, &desc);
+	}
+};
+} // namespace vo
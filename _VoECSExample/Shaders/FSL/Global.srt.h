@@ -4,16 +4,25 @@
  */
 #pragma once
 
+// Rewritten every frame: position and RGBA8 tint.
 STRUCT(InstanceData)
 {
-	DATA(float4, posScale, None);
-	DATA(float4, colorIndex, None);
+	DATA(float2, pos, None);
+	DATA(uint, tint, None);
+	DATA(uint, pad, None);
+};
+
+// Uploaded once after spawn: scale and sprite index.
+STRUCT(StaticInstanceData)
+{
+	DATA(float2, scaleSprite, None);
 };
 
 BEGIN_SRT(SrtData)
 	BEGIN_SRT_SET(Persistent)
 		DECL_TEXTURE(Persistent, Tex2D(float4), uTexture0)
 		DECL_SAMPLER(Persistent, SamplerState, uSampler0)
+		DECL_BUFFER(Persistent, Buffer(StaticInstanceData), staticInstanceBuffer)
 	END_SRT_SET(Persistent)
 	BEGIN_SRT_SET(PerFrame)
 		DECL_BUFFER(PerFrame, Buffer(InstanceData), instanceBuffer)